@@ -1,6 +1,18 @@
 work_group_sizes="1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16"
+max_work_group_invocations=16
 repetition_count=100
-repetition_delay=1000
+
+divisors() {
+	# $1: seed dimension
+	# Prints the work group sizes that divide the seed dimension as a comma separated list
+	local list=""
+	for work_group_size in $work_group_sizes; do
+		if [[ `expr $1 % $work_group_size` -eq 0 ]]; then
+			list="$list${list:+,}$work_group_size"
+		fi
+	done
+	printf "$list"
+}
 
 bench() {
 	# $1: dataset
@@ -9,66 +21,28 @@ bench() {
 	# $4: seed dimension z
 	# $5: steps
 	# $6: delta time
-	for work_group_size_x in $work_group_sizes; do
-		if [[ `expr $2 % $work_group_size_x` -ne 0 ]]; then
-			continue
-		fi
-
-		for work_group_size_y in $work_group_sizes; do
-			if [[ `expr $3 % $work_group_size_y` -ne 0 ]]; then
-				continue
-			fi
-
-			for work_group_size_z in $work_group_sizes; do
-				if [[ `expr $4 % $work_group_size_z` -ne 0 ]]; then
-					continue
-				fi
-
-				if [[ `expr $work_group_size_x "*" $work_group_size_y "*" $work_group_size_z` -le 16 ]]; then
-					printf "$1 ($work_group_size_x,$work_group_size_y,$work_group_size_z) explicit: "
-					if ./build/Release/bc6h-integrator.exe \
-						$1 \
-						--work_group_size_x=$work_group_size_x \
-						--work_group_size_y=$work_group_size_y \
-						--work_group_size_z=$work_group_size_z \
-						--seed_dimension_x=$2 \
-						--seed_dimension_y=$3 \
-						--seed_dimension_z=$4 \
-						--integration_steps=$5 \
-						--batch_size=$5 \
-						--delta_time=$6 \
-						--repetition_delay=$repetition_delay \
-						--repetition_count=$repetition_count \
-						--explicit_interpolation;
-					then
-						printf "SUCCESS\n"
-					else
-						printf "FAILED\n"
-					fi
-						
-					printf "$1 ($work_group_size_x,$work_group_size_y,$work_group_size_z) implicit: "
-					if ./build/Release/bc6h-integrator.exe \
-						$1 \
-						--work_group_size_x=$work_group_size_x \
-						--work_group_size_y=$work_group_size_y \
-						--work_group_size_z=$work_group_size_z \
-						--seed_dimension_x=$2 \
-						--seed_dimension_y=$3 \
-						--seed_dimension_z=$4 \
-						--integration_steps=$5 \
-						--batch_size=$5 \
-						--delta_time=$6 \
-						--repetition_delay=$repetition_delay \
-						--repetition_count=$repetition_count;
-					then
-						printf "SUCCESS\n"
-					else
-						printf "FAILED\n"
-					fi
-				fi
-			done
-		done
-	done
+	# The dataset is loaded once and integrated with every work group size and both interpolations
+	printf "$1: "
+	if ./build/Release/bc6h-integrator.exe \
+		$1 \
+		--sweep \
+		--sweep_work_group_size_x=`divisors $2` \
+		--sweep_work_group_size_y=`divisors $3` \
+		--sweep_work_group_size_z=`divisors $4` \
+		--sweep_max_work_group_invocations=$max_work_group_invocations \
+		--sweep_interpolation=explicit,implicit \
+		--seed_dimension_x=$2 \
+		--seed_dimension_y=$3 \
+		--seed_dimension_z=$4 \
+		--integration_steps=$5 \
+		--batch_size=$5 \
+		--delta_time=$6 \
+		--repetition_count=$repetition_count;
+	then
+		printf "SUCCESS\n"
+	else
+		printf "FAILED\n"
+	fi
 }
 
 bench_single() {
@@ -84,46 +58,30 @@ bench_single() {
 	# $10: explicit: 1, implicit: 0
 	if [[ "${10}" -eq "0" ]];
 	then
-		printf "$1 ($7,$8,$9) implicit: "
-		if ./build/Release/bc6h-integrator.exe \
-			$1 \
-			--work_group_size_x=$7 \
-			--work_group_size_y=$8 \
-			--work_group_size_z=$9 \
-			--seed_dimension_x=$2 \
-			--seed_dimension_y=$3 \
-			--seed_dimension_z=$4 \
-			--integration_steps=$5 \
-			--batch_size=$5 \
-			--delta_time=$6 \
-			--repetition_delay=$repetition_delay \
-			--repetition_count=$repetition_count;
-		then
-			printf "SUCCESS\n"
-		else
-			printf "FAILED\n"
-		fi
+		interpolation=implicit
 	else
-		printf "$1 ($7,$8,$9) explicit: "
-		if ./build/Release/bc6h-integrator.exe \
-			$1 \
-			--work_group_size_x=$7 \
-			--work_group_size_y=$8 \
-			--work_group_size_z=$9 \
-			--seed_dimension_x=$2 \
-			--seed_dimension_y=$3 \
-			--seed_dimension_z=$4 \
-			--integration_steps=$5 \
-			--batch_size=$5 \
-			--delta_time=$6 \
-			--repetition_delay=$repetition_delay \
-			--repetition_count=$repetition_count \
-			--explicit_interpolation;
-		then
-			printf "SUCCESS\n"
-		else
-			printf "FAILED\n"
-		fi
+		interpolation=explicit
+	fi
+
+	printf "$1 ($7,$8,$9) $interpolation: "
+	if ./build/Release/bc6h-integrator.exe \
+		$1 \
+		--sweep \
+		--sweep_interpolation=$interpolation \
+		--work_group_size_x=$7 \
+		--work_group_size_y=$8 \
+		--work_group_size_z=$9 \
+		--seed_dimension_x=$2 \
+		--seed_dimension_y=$3 \
+		--seed_dimension_z=$4 \
+		--integration_steps=$5 \
+		--batch_size=$5 \
+		--delta_time=$6 \
+		--repetition_count=$repetition_count;
+	then
+		printf "SUCCESS\n"
+	else
+		printf "FAILED\n"
 	fi
 }
 
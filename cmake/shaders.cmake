@@ -8,7 +8,7 @@ find_program(
 function(compile_shaders target extern_directories)
     message(STATUS ${target})
     set(shaders_header "${CMAKE_CURRENT_BINARY_DIR}/include/shaders.hpp")
-    file(WRITE ${shaders_header} "#pragma once\n#include <cstdint>\n#include <liblava/core/data.hpp>\n")
+    file(WRITE ${shaders_header} "#pragma once\n#include <cstdint>\n#include <liblava/core/data.hpp>\n#include <string_view>\n")
 
     set(shaders_source "${CMAKE_CURRENT_BINARY_DIR}/shaders.cpp")
     file(WRITE ${shaders_source} "#include \"shaders.hpp\"\n")
@@ -33,9 +33,15 @@ function(compile_shaders target extern_directories)
             set(generated_file "${CMAKE_CURRENT_BINARY_DIR}/${var_name}.spv")
             set(depfile "${CMAKE_CURRENT_BINARY_DIR}/${var_name}.dep")
 
+            # Only the kernels with subgroup operations require Vulkan 1.1, the others run on every device
+            set(target_environment "vulkan1.0")
+            if (source_name MATCHES "_subgroup$")
+                set(target_environment "vulkan1.1")
+            endif ()
+
             add_custom_command(
                 OUTPUT ${generated_file}
-                COMMAND ${GLSL_LANG_VALIDATOR} -I${extern_directories} ${source} "--vn" ${var_name} "-V" "-o" ${generated_file} "--depfile" ${depfile}
+                COMMAND ${GLSL_LANG_VALIDATOR} -I${extern_directories} ${source} "--vn" ${var_name} "-V" "--target-env" ${target_environment} "-o" ${generated_file} "--depfile" ${depfile}
                 MAIN_DEPENDENCY ${source}
                 WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
                 DEPFILE ${depfile}
@@ -46,5 +52,21 @@ function(compile_shaders target extern_directories)
             file(APPEND ${shaders_source} "const lava::cdata ${var_name}_cdata(${var_name}, sizeof(${var_name}));\n")
             target_sources(${target} PRIVATE ${generated_file})
         endif ()
+
+        # The sources of the compute shaders are embedded as well, so that they can be specialized and compiled at runtime
+        if (source_extension STREQUAL ".comp" OR source_extension STREQUAL ".glsl")
+            string(SUBSTRING ${source_extension} 1 -1 source_extension_without_dot)
+            set(var_name "${source_name}_${source_extension_without_dot}_source")
+            get_filename_component(source_path ${source} ABSOLUTE)
+
+            file(READ ${source_path} source_hex HEX)
+            string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," source_bytes "${source_hex}")
+            file(APPEND ${shaders_header} "extern const std::string_view ${var_name};\n")
+            file(APPEND ${shaders_source} "static const unsigned char ${var_name}_data[] = {${source_bytes}};\n")
+            file(APPEND ${shaders_source} "const std::string_view ${var_name}(reinterpret_cast<const char*>(${var_name}_data), sizeof(${var_name}_data));\n")
+
+            # The source is read when the project is configured, which has to be repeated when it changes
+            set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${source_path})
+        endif ()
     endforeach()
 endfunction(compile_shaders)
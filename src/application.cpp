@@ -1,4 +1,5 @@
 #include "application.hpp"
+#include "timeline_semaphore.hpp"
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan_core.h>
 
@@ -16,6 +17,7 @@ bool Application::setup() {
         // device_param.queue_family_infos[0].queues[0].priority = 1.0;
         device_param.add_queue(VK_QUEUE_COMPUTE_BIT, 1.0);
         device_param.add_queue(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT, 1.0);
+        enable_timeline_semaphore(device_param);
     };
 
     if (!this->engine.setup()) {
@@ -94,14 +96,11 @@ bool Application::setup() {
 }
 
 void Application::load_dataset(const std::filesystem::path& path) {
-    if (path.extension() == ".raw") {
-        this->dataset = Dataset::make(this->engine.device, DataSource::open_raw_file(path));
-    } else if (path.extension() == ".ktx") {
-        this->dataset = Dataset::make(this->engine.device, DataSource::open_ktx_file(path));
-    } else {
-        lava::log()->warn("Unknown extension: {}", path.extension().string());
+    DataSource::Ptr data = DataSource::open_file(path);
+    if (!data) {
         return;
     }
+    this->dataset = Dataset::make(this->engine.device, data);
     this->view->set_dataset(this->dataset);
     this->integrator->set_dataset(this->dataset);
 }
@@ -0,0 +1,281 @@
+#include "autotuner.hpp"
+#include "integrator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <liblava/util/log.hpp>
+#include <spdlog/fmt/bundled/core.h>
+#include <spdlog/fmt/bundled/ostream.h>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t AUTOTUNE_STEP_COUNT = 256; // Steps of the integration that is measured
+constexpr std::uint32_t AUTOTUNE_RUN_COUNT = 3;    // The median of the runs is compared
+constexpr std::size_t AUTOTUNE_MAX_EVALUATIONS = 64;
+constexpr std::uint32_t AUTOTUNE_MAX_PARTICLES_PER_INVOCATION = 8;
+
+const char* get_format_name(DataSource::Format format) {
+    switch (format) {
+        case DataSource::Format::Float16:
+            return "Float16";
+        case DataSource::Format::Float32:
+            return "Float32";
+        case DataSource::Format::BC6H:
+            return "BC6H";
+    }
+    return "unknown";
+}
+
+struct WorkGroupSizeLess {
+    bool operator()(const glm::uvec3& a, const glm::uvec3& b) const {
+        return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+    }
+};
+
+bool is_supported(const glm::uvec3& work_group_size, const VkPhysicalDeviceLimits& limits) {
+    return work_group_size.x >= 1 && work_group_size.y >= 1 && work_group_size.z >= 1 &&
+           work_group_size.x <= limits.maxComputeWorkGroupSize[0] &&
+           work_group_size.y <= limits.maxComputeWorkGroupSize[1] &&
+           work_group_size.z <= limits.maxComputeWorkGroupSize[2] &&
+           work_group_size.x * work_group_size.y * work_group_size.z <= limits.maxComputeWorkGroupInvocations;
+}
+
+// Distributes the factors of two of the invocation count round robin over the axes, skipping axes that would become
+// larger than the seed dimension
+glm::uvec3 get_balanced_work_group_size(std::uint32_t invocations, const glm::uvec3& seed_spawn) {
+    glm::uvec3 work_group_size = {1, 1, 1};
+    unsigned next_axis = 0;
+
+    for (std::uint32_t factor = 1; factor < invocations; factor *= 2) {
+        unsigned axis = 0; // If the work group already covers the seeds, the rows become longer
+        for (unsigned attempt = 0; attempt < 3; ++attempt) {
+            if (work_group_size[(next_axis + attempt) % 3] < seed_spawn[(next_axis + attempt) % 3]) {
+                axis = (next_axis + attempt) % 3;
+                break;
+            }
+        }
+        work_group_size[axis] *= 2;
+        next_axis = (axis + 1) % 3;
+    }
+
+    return work_group_size;
+}
+
+// Median GPU time of the integration in ms, or nothing if the integration failed
+std::optional<double> measure(Integrator& integrator, IntegrationSettings settings, const glm::uvec3& work_group_size, std::uint32_t particles_per_invocation) {
+    settings.work_group_size = work_group_size;
+    settings.particles_per_invocation = particles_per_invocation;
+    integrator.set_settings(settings);
+
+    std::vector<double> durations;
+    for (std::uint32_t run = 0; run < AUTOTUNE_RUN_COUNT; ++run) {
+        if (!integrator.run_integration()) {
+            return std::nullopt;
+        }
+        durations.push_back(integrator.get_run_times().value().integration_gpu);
+    }
+
+    std::sort(durations.begin(), durations.end());
+    lava::log()->debug("autotune: work group size {}x{}x{}, {} particles per invocation: {} ms", work_group_size.x, work_group_size.y, work_group_size.z, particles_per_invocation, durations[durations.size() / 2]);
+
+    return durations[durations.size() / 2];
+}
+
+} // namespace
+
+std::uint32_t AutotuneResult::get_batch_size(std::uint32_t seed_count, std::uint32_t integration_steps, double target_duration) const {
+    if (this->step_cost <= 0.0 || seed_count == 0) {
+        return integration_steps;
+    }
+
+    const double batch_size = std::floor(target_duration * 1000.0 * 1000.0 / (this->step_cost * seed_count));
+    return static_cast<std::uint32_t>(std::clamp(batch_size, 1.0, static_cast<double>(integration_steps)));
+}
+
+std::string AutotuneCache::make_key(lava::device_p device, DataSource::Format format, const glm::uvec4& dimensions, bool analytic_dataset, bool explicit_interpolation, bool cubic_interpolation, IntegrationMethod method) {
+    const VkPhysicalDeviceProperties& properties = device->get_properties();
+
+    // Tabs separate the fields of a line in the file and cannot appear in the name of the device. The cubic
+    // interpolation is a suffix of the interpolation field, so that the keys of linear interpolation stay the same.
+    return fmt::format(
+        "{}\t{:x}\t{:x}\t{:x}\t{}\t{}x{}x{}x{}\t{}{}\t{}",
+        properties.deviceName, properties.vendorID, properties.deviceID, properties.driverVersion,
+        analytic_dataset ? "Analytic" : get_format_name(format),
+        dimensions.x, dimensions.y, dimensions.z, dimensions.w,
+        explicit_interpolation ? "Explicit" : "Implicit",
+        cubic_interpolation ? "Cubic" : "",
+        get_integration_method_name(method));
+}
+
+bool AutotuneCache::load(const std::filesystem::path& path) {
+    this->path = path;
+    this->results.clear();
+
+    std::ifstream file(path);
+    if (!file) {
+        return true; // Nothing has been tuned yet
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        // The key consists of the first eight fields, followed by the work group size, the step cost and the particles per
+        // invocation, which files of older versions do not contain
+        std::size_t key_end = std::string::npos;
+        std::size_t position = 0;
+        for (unsigned field = 0; field < 8; ++field) {
+            key_end = line.find('\t', position);
+            if (key_end == std::string::npos) {
+                break;
+            }
+            position = key_end + 1;
+        }
+        if (key_end == std::string::npos) {
+            continue;
+        }
+
+        AutotuneResult result;
+        std::istringstream values(line.substr(key_end + 1));
+        if (!(values >> result.work_group_size.x >> result.work_group_size.y >> result.work_group_size.z >> result.step_cost)) {
+            lava::log()->warn("autotune: ignoring invalid line in '{}'", path.string());
+            continue;
+        }
+        if (!(values >> result.particles_per_invocation) || result.particles_per_invocation == 0 || result.particles_per_invocation > AUTOTUNE_MAX_PARTICLES_PER_INVOCATION) {
+            result.particles_per_invocation = 1;
+        }
+        this->results[line.substr(0, key_end)] = result;
+    }
+
+    lava::log()->debug("autotune: loaded {} results from '{}'", this->results.size(), path.string());
+
+    return true;
+}
+
+bool AutotuneCache::save() const {
+    std::ofstream file(this->path);
+    if (!file) {
+        lava::log()->error("autotune: failed to write '{}'", this->path.string());
+        return false;
+    }
+
+    for (const auto& [key, result] : this->results) {
+        fmt::print(file, "{}\t{}\t{}\t{}\t{}\t{}\n", key, result.work_group_size.x, result.work_group_size.y, result.work_group_size.z, result.step_cost, result.particles_per_invocation);
+    }
+
+    return true;
+}
+
+std::optional<AutotuneResult> AutotuneCache::find(const std::string& key) const {
+    const auto iterator = this->results.find(key);
+    if (iterator == this->results.end()) {
+        return std::nullopt;
+    }
+    return iterator->second;
+}
+
+void AutotuneCache::store(const std::string& key, const AutotuneResult& result) {
+    this->results[key] = result;
+}
+
+bool run_autotune(lava::device_p device, Integrator& integrator, AutotuneCache& cache) {
+    const VkPhysicalDeviceLimits& limits = device->get_properties().limits;
+    const IntegrationSettings original_settings = integrator.get_settings();
+
+    // A single dispatch of a short integration, the work group size is searched with one particle per invocation
+    IntegrationSettings settings = original_settings;
+    settings.integration_steps = std::min(original_settings.integration_steps, AUTOTUNE_STEP_COUNT);
+    settings.batch_size = settings.integration_steps;
+    settings.particles_per_invocation = 1;
+
+    std::map<glm::uvec3, double, WorkGroupSizeLess> durations;
+    glm::uvec3 best_work_group_size = original_settings.work_group_size;
+    double best_duration = std::numeric_limits<double>::max();
+
+    const auto evaluate = [&](const glm::uvec3& work_group_size) {
+        if (!is_supported(work_group_size, limits) || durations.contains(work_group_size) || durations.size() >= AUTOTUNE_MAX_EVALUATIONS || integrator.is_integration_cancelled()) {
+            return false;
+        }
+
+        const std::optional<double> duration = measure(integrator, settings, work_group_size, settings.particles_per_invocation);
+        durations[work_group_size] = duration.value_or(std::numeric_limits<double>::max());
+
+        if (duration.has_value() && duration.value() < best_duration) {
+            best_duration = duration.value();
+            best_work_group_size = work_group_size;
+            return true;
+        }
+        return false;
+    };
+
+    // Coarse grid: every power of two invocation count as a row and as a block shaped like the seeds
+    const std::uint32_t seed_count = settings.seed_spawn.x * settings.seed_spawn.y * settings.seed_spawn.z;
+    for (std::uint32_t invocations = 1; invocations <= limits.maxComputeWorkGroupInvocations && invocations / 2 < seed_count; invocations *= 2) {
+        evaluate(glm::uvec3(invocations, 1, 1));
+        evaluate(get_balanced_work_group_size(invocations, settings.seed_spawn));
+    }
+    evaluate(original_settings.work_group_size);
+
+    // Local refinement: halve, double or move a factor of two between two axes of the best work group size
+    bool improved = true;
+    while (improved && durations.size() < AUTOTUNE_MAX_EVALUATIONS) {
+        improved = false;
+        const glm::uvec3 center = best_work_group_size;
+
+        for (unsigned axis = 0; axis < 3; ++axis) {
+            glm::uvec3 doubled = center;
+            doubled[axis] *= 2;
+            improved |= evaluate(doubled);
+
+            if (center[axis] % 2 == 0) {
+                glm::uvec3 halved = center;
+                halved[axis] /= 2;
+                improved |= evaluate(halved);
+
+                for (unsigned other_axis = 0; other_axis < 3; ++other_axis) {
+                    if (other_axis != axis) {
+                        glm::uvec3 moved = halved;
+                        moved[other_axis] *= 2;
+                        improved |= evaluate(moved);
+                    }
+                }
+            }
+        }
+    }
+
+    // More particles per invocation hide more latency, but need more registers and leave fewer invocations
+    std::uint32_t best_particles_per_invocation = settings.particles_per_invocation;
+    for (std::uint32_t particles_per_invocation = 2; particles_per_invocation <= AUTOTUNE_MAX_PARTICLES_PER_INVOCATION && best_duration != std::numeric_limits<double>::max() && !integrator.is_integration_cancelled(); particles_per_invocation *= 2) {
+        const std::optional<double> duration = measure(integrator, settings, best_work_group_size, particles_per_invocation);
+        if (!duration.has_value() || duration.value() >= best_duration) {
+            break;
+        }
+        best_duration = duration.value();
+        best_particles_per_invocation = particles_per_invocation;
+    }
+
+    integrator.set_settings(original_settings);
+
+    if (integrator.is_integration_cancelled()) {
+        lava::log()->warn("autotune: cancelled, the cache is not updated");
+        return false;
+    }
+
+    if (best_duration == std::numeric_limits<double>::max()) {
+        lava::log()->error("autotune: no work group size could be measured");
+        return false;
+    }
+
+    const AutotuneResult result = {
+        .work_group_size = best_work_group_size,
+        .particles_per_invocation = best_particles_per_invocation,
+        .step_cost = best_duration * 1000.0 * 1000.0 / (double(seed_count) * settings.integration_steps),
+    };
+    lava::log()->info("autotune: work group size {}x{}x{} with {} particles per invocation is the fastest of {} ({} ms for {} steps), batch size {} for {} steps", best_work_group_size.x, best_work_group_size.y, best_work_group_size.z, best_particles_per_invocation, durations.size(), best_duration, settings.integration_steps, result.get_batch_size(seed_count, original_settings.integration_steps, AUTOTUNE_BATCH_DURATION), original_settings.integration_steps);
+
+    cache.store(integrator.get_autotune_key(), result);
+
+    return cache.save();
+}
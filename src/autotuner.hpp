@@ -0,0 +1,51 @@
+#pragma once
+
+#include "data_source.hpp"
+#include "integration_method.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <glm/vec3.hpp>
+#include <liblava/base/device.hpp>
+#include <map>
+#include <optional>
+#include <string>
+
+class Integrator;
+
+constexpr double AUTOTUNE_BATCH_DURATION = 100.0; // Duration of a dispatch in ms, far below the timeouts of the drivers
+
+// Best configuration found by the autotuner for one combination of device, dataset format, dataset dimensions,
+// interpolation mode and integration method
+struct AutotuneResult {
+    glm::uvec3 work_group_size;
+    std::uint32_t particles_per_invocation = 1;
+    double step_cost = 0.0; // GPU time of a single step of a single particle in ns, which determines the batch size
+
+    // The largest batch of steps for seed_count particles whose dispatch is expected to take at most target_duration ms
+    std::uint32_t get_batch_size(std::uint32_t seed_count, std::uint32_t integration_steps, double target_duration) const;
+};
+
+// Autotuning results that are persisted in a local text file, one result per line
+class AutotuneCache {
+  public:
+    static constexpr const char* DEFAULT_PATH = "bc6h-integrator-autotune.txt";
+
+    static std::string make_key(lava::device_p device, DataSource::Format format, const glm::uvec4& dimensions, bool analytic_dataset, bool explicit_interpolation, bool cubic_interpolation, IntegrationMethod method);
+
+    bool load(const std::filesystem::path& path);
+    bool save() const;
+
+    std::optional<AutotuneResult> find(const std::string& key) const;
+    void store(const std::string& key, const AutotuneResult& result);
+
+  private:
+    std::filesystem::path path;
+    std::map<std::string, AutotuneResult> results;
+};
+
+// Searches the work group size that integrates the loaded dataset fastest with a short integration of the configured
+// seeds. The search first measures a coarse grid of work group sizes with power of two invocations and then refines the
+// best one by moving factors of two between its axes until no neighbour is faster. Afterwards, the number of particles
+// per invocation is doubled for the best work group size as long as it gets faster. The GPU time per step of the winner
+// determines the batch size. The result is stored in the cache.
+bool run_autotune(lava::device_p device, Integrator& integrator, AutotuneCache& cache);
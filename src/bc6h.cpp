@@ -0,0 +1,241 @@
+#include "bc6h.hpp"
+#include <array>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+// Endpoint components as they are named in the bit layouts: endpoints 0 and 1 belong to the first region,
+// endpoints 2 and 3 to the second one
+enum Field : std::uint8_t {
+    R0, G0, B0,
+    R1, G1, B1,
+    R2, G2, B2,
+    R3, G3, B3,
+};
+
+// Consecutive bits of an endpoint component in the block, read from first_bit towards last_bit.
+// The 12 and 16 bit modes store the most significant bits in reversed order.
+struct Segment {
+    Field field;
+    std::uint8_t first_bit;
+    std::uint8_t last_bit;
+};
+
+struct Mode {
+    bool valid;
+    bool two_regions;
+    bool transformed;
+    std::uint8_t mode_bits;
+    std::uint8_t endpoint_bits;
+    std::array<std::uint8_t, 3> delta_bits;
+    std::array<Segment, 24> layout;
+    std::uint8_t segment_count;
+};
+
+// The 14 modes in the order of the specification (mode 1 to 14)
+const std::array<Mode, 14> MODES = {{
+    {true, true, true, 2, 10, {5, 5, 5}, {{{G2, 4, 4}, {B2, 4, 4}, {B3, 4, 4}, {R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 4}, {G3, 4, 4}, {G2, 0, 3}, {G1, 0, 4}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 4}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 4}, {B3, 2, 2}, {R3, 0, 4}, {B3, 3, 3}}}, 19},
+    {true, true, true, 2, 7, {6, 6, 6}, {{{G2, 5, 5}, {G3, 4, 4}, {G3, 5, 5}, {R0, 0, 6}, {B3, 0, 0}, {B3, 1, 1}, {B2, 4, 4}, {G0, 0, 6}, {B2, 5, 5}, {B3, 2, 2}, {G2, 4, 4}, {B0, 0, 6}, {B3, 3, 3}, {B3, 5, 5}, {B3, 4, 4}, {R1, 0, 5}, {G2, 0, 3}, {G1, 0, 5}, {G3, 0, 3}, {B1, 0, 5}, {B2, 0, 3}, {R2, 0, 5}, {R3, 0, 5}}}, 23},
+    {true, true, true, 5, 11, {5, 4, 4}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 4}, {R0, 10, 10}, {G2, 0, 3}, {G1, 0, 3}, {G0, 10, 10}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 3}, {B0, 10, 10}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 4}, {B3, 2, 2}, {R3, 0, 4}, {B3, 3, 3}}}, 18},
+    {true, true, true, 5, 11, {4, 5, 4}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 3}, {R0, 10, 10}, {G3, 4, 4}, {G2, 0, 3}, {G1, 0, 4}, {G0, 10, 10}, {G3, 0, 3}, {B1, 0, 3}, {B0, 10, 10}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 3}, {B3, 0, 0}, {B3, 2, 2}, {R3, 0, 3}, {G2, 4, 4}, {B3, 3, 3}}}, 20},
+    {true, true, true, 5, 11, {4, 4, 5}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 3}, {R0, 10, 10}, {B2, 4, 4}, {G2, 0, 3}, {G1, 0, 3}, {G0, 10, 10}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 4}, {B0, 10, 10}, {B2, 0, 3}, {R2, 0, 3}, {B3, 1, 1}, {B3, 2, 2}, {R3, 0, 3}, {B3, 4, 4}, {B3, 3, 3}}}, 20},
+    {true, true, true, 5, 9, {5, 5, 5}, {{{R0, 0, 8}, {B2, 4, 4}, {G0, 0, 8}, {G2, 4, 4}, {B0, 0, 8}, {B3, 4, 4}, {R1, 0, 4}, {G3, 4, 4}, {G2, 0, 3}, {G1, 0, 4}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 4}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 4}, {B3, 2, 2}, {R3, 0, 4}, {B3, 3, 3}}}, 19},
+    {true, true, true, 5, 8, {6, 5, 5}, {{{R0, 0, 7}, {G3, 4, 4}, {B2, 4, 4}, {G0, 0, 7}, {B3, 2, 2}, {G2, 4, 4}, {B0, 0, 7}, {B3, 3, 3}, {B3, 4, 4}, {R1, 0, 5}, {G2, 0, 3}, {G1, 0, 4}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 4}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 5}, {R3, 0, 5}}}, 19},
+    {true, true, true, 5, 8, {5, 6, 5}, {{{R0, 0, 7}, {B3, 0, 0}, {B2, 4, 4}, {G0, 0, 7}, {G2, 5, 5}, {G2, 4, 4}, {B0, 0, 7}, {G3, 5, 5}, {B3, 4, 4}, {R1, 0, 4}, {G3, 4, 4}, {G2, 0, 3}, {G1, 0, 5}, {G3, 0, 3}, {B1, 0, 4}, {B3, 1, 1}, {B2, 0, 3}, {R2, 0, 4}, {B3, 2, 2}, {R3, 0, 4}, {B3, 3, 3}}}, 21},
+    {true, true, true, 5, 8, {5, 5, 6}, {{{R0, 0, 7}, {B3, 1, 1}, {B2, 4, 4}, {G0, 0, 7}, {B2, 5, 5}, {G2, 4, 4}, {B0, 0, 7}, {B3, 5, 5}, {B3, 4, 4}, {R1, 0, 4}, {G3, 4, 4}, {G2, 0, 3}, {G1, 0, 4}, {B3, 0, 0}, {G3, 0, 3}, {B1, 0, 5}, {B2, 0, 3}, {R2, 0, 4}, {B3, 2, 2}, {R3, 0, 4}, {B3, 3, 3}}}, 21},
+    {true, true, false, 5, 6, {6, 6, 6}, {{{R0, 0, 5}, {G3, 4, 4}, {B3, 0, 0}, {B3, 1, 1}, {B2, 4, 4}, {G0, 0, 5}, {G2, 5, 5}, {B2, 5, 5}, {B3, 2, 2}, {G2, 4, 4}, {B0, 0, 5}, {G3, 5, 5}, {B3, 3, 3}, {B3, 5, 5}, {B3, 4, 4}, {R1, 0, 5}, {G2, 0, 3}, {G1, 0, 5}, {G3, 0, 3}, {B1, 0, 5}, {B2, 0, 3}, {R2, 0, 5}, {R3, 0, 5}}}, 23},
+    {true, false, false, 5, 10, {10, 10, 10}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 9}, {G1, 0, 9}, {B1, 0, 9}}}, 6},
+    {true, false, true, 5, 11, {9, 9, 9}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 8}, {R0, 10, 10}, {G1, 0, 8}, {G0, 10, 10}, {B1, 0, 8}, {B0, 10, 10}}}, 9},
+    {true, false, true, 5, 12, {8, 8, 8}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 7}, {R0, 11, 10}, {G1, 0, 7}, {G0, 11, 10}, {B1, 0, 7}, {B0, 11, 10}}}, 9},
+    {true, false, true, 5, 16, {4, 4, 4}, {{{R0, 0, 9}, {G0, 0, 9}, {B0, 0, 9}, {R1, 0, 3}, {R0, 15, 10}, {G1, 0, 3}, {G0, 15, 10}, {B1, 0, 3}, {B0, 15, 10}}}, 9},
+}};
+
+// Texel i belongs to the second region if bit i of the partition is set
+constexpr std::array<std::uint16_t, 32> PARTITIONS = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+};
+
+// Anchor texel of the second region, whose index is stored with one bit less
+constexpr std::array<std::uint8_t, 32> ANCHORS = {
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15,
+    2, 8, 2, 2, 8, 8, 2, 2,
+};
+
+constexpr std::array<int, 8> WEIGHTS_3 = {0, 9, 18, 27, 37, 46, 55, 64};
+constexpr std::array<int, 16> WEIGHTS_4 = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitReader {
+  public:
+    explicit BitReader(const std::uint8_t* block) {
+        std::memcpy(this->bits.data(), block, BC6H_BLOCK_SIZE);
+    }
+
+    unsigned read(unsigned position, unsigned count) const {
+        unsigned value = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            value |= this->read(position + i) << i;
+        }
+        return value;
+    }
+
+    unsigned read(unsigned position) const {
+        return (this->bits[position / 64] >> (position % 64)) & 1;
+    }
+
+  private:
+    std::array<std::uint64_t, 2> bits; // Little endian, as the block
+};
+
+int sign_extend(int value, unsigned bits) {
+    const int sign = 1 << (bits - 1);
+    return (value & (sign - 1)) - (value & sign);
+}
+
+int unquantize(int component, unsigned bits) {
+    if (bits >= 16) {
+        return component;
+    }
+
+    const bool negative = component < 0;
+    if (negative) {
+        component = -component;
+    }
+
+    int unquantized;
+    if (component == 0) {
+        unquantized = 0;
+    } else if (component >= ((1 << (bits - 1)) - 1)) {
+        unquantized = 0x7FFF;
+    } else {
+        unquantized = ((component << 15) + 0x4000) >> (bits - 1);
+    }
+
+    return negative ? -unquantized : unquantized;
+}
+
+float finish_unquantize(int component) {
+    std::uint16_t half;
+    if (component < 0) {
+        half = 0x8000 | std::uint16_t(((-component) * 31) >> 5);
+    } else {
+        half = std::uint16_t((component * 31) >> 5);
+    }
+    return glm::unpackHalf1x16(half);
+}
+
+// Header of a block: unquantized endpoints and where the indices are stored
+struct Block {
+    BitReader bits;
+    const Mode* mode = nullptr;
+    unsigned partition = 0;
+    std::array<std::array<int, 3>, 4> endpoints = {};
+
+    explicit Block(const std::uint8_t* block) : bits(block) {
+        unsigned mode_value = this->bits.read(0, 2);
+        if (mode_value > 1) {
+            mode_value = this->bits.read(0, 5);
+        }
+
+        switch (mode_value) {
+            case 0x00: this->mode = &MODES[0]; break;
+            case 0x01: this->mode = &MODES[1]; break;
+            case 0x02: this->mode = &MODES[2]; break;
+            case 0x06: this->mode = &MODES[3]; break;
+            case 0x0A: this->mode = &MODES[4]; break;
+            case 0x0E: this->mode = &MODES[5]; break;
+            case 0x12: this->mode = &MODES[6]; break;
+            case 0x16: this->mode = &MODES[7]; break;
+            case 0x1A: this->mode = &MODES[8]; break;
+            case 0x1E: this->mode = &MODES[9]; break;
+            case 0x03: this->mode = &MODES[10]; break;
+            case 0x07: this->mode = &MODES[11]; break;
+            case 0x0B: this->mode = &MODES[12]; break;
+            case 0x0F: this->mode = &MODES[13]; break;
+            default: return; // Reserved modes decode to zero
+        }
+
+        std::array<int, 12> fields = {};
+        unsigned position = this->mode->mode_bits;
+        for (unsigned s = 0; s < this->mode->segment_count; ++s) {
+            const Segment& segment = this->mode->layout[s];
+            const int step = segment.first_bit <= segment.last_bit ? 1 : -1;
+            for (int bit = segment.first_bit;; bit += step) {
+                fields[segment.field] |= this->bits.read(position++) << bit;
+                if (bit == segment.last_bit) {
+                    break;
+                }
+            }
+        }
+
+        if (this->mode->two_regions) {
+            this->partition = this->bits.read(position, 5);
+        }
+
+        const unsigned endpoint_count = this->mode->two_regions ? 4 : 2;
+        for (unsigned c = 0; c < 3; ++c) {
+            const unsigned endpoint_bits = this->mode->endpoint_bits;
+            const unsigned delta_bits = this->mode->delta_bits[c];
+
+            // The first endpoint is stored with full precision, the others as deltas to it in transformed modes
+            int base = sign_extend(fields[c], endpoint_bits);
+            this->endpoints[0][c] = unquantize(base, endpoint_bits);
+
+            for (unsigned e = 1; e < endpoint_count; ++e) {
+                int endpoint = sign_extend(fields[e * 3 + c], this->mode->transformed ? delta_bits : endpoint_bits);
+                if (this->mode->transformed) {
+                    endpoint = sign_extend((endpoint + base) & ((1 << endpoint_bits) - 1), endpoint_bits);
+                }
+                this->endpoints[e][c] = unquantize(endpoint, endpoint_bits);
+            }
+        }
+    }
+
+    glm::vec3 decode(unsigned texel) const {
+        if (!this->mode) {
+            return glm::vec3(0.0f);
+        }
+
+        unsigned region = 0;
+        int weight;
+        if (this->mode->two_regions) {
+            // 3 bit indices starting at bit 82, the first texel and the anchor texel of the second region have 2 bits
+            const unsigned anchor = ANCHORS[this->partition];
+            const unsigned position = 82 + 3 * texel - (texel > 0 ? 1 : 0) - (texel > anchor ? 1 : 0);
+            const unsigned bit_count = (texel == 0 || texel == anchor) ? 2 : 3;
+            region = (PARTITIONS[this->partition] >> texel) & 1;
+            weight = WEIGHTS_3[this->bits.read(position, bit_count)];
+        } else {
+            // 4 bit indices starting at bit 65, the first texel has 3 bits
+            const unsigned position = 65 + 4 * texel - (texel > 0 ? 1 : 0);
+            const unsigned bit_count = texel == 0 ? 3 : 4;
+            weight = WEIGHTS_4[this->bits.read(position, bit_count)];
+        }
+
+        const std::array<int, 3>& a = this->endpoints[2 * region];
+        const std::array<int, 3>& b = this->endpoints[2 * region + 1];
+        glm::vec3 color;
+        for (unsigned c = 0; c < 3; ++c) {
+            color[c] = finish_unquantize((a[c] * (64 - weight) + b[c] * weight + 32) >> 6);
+        }
+        return color;
+    }
+};
+
+} // namespace
+
+void decode_bc6h_block(const std::uint8_t* block, glm::vec3* texels) {
+    const Block header(block);
+    for (unsigned texel = 0; texel < BC6H_BLOCK_DIMENSION * BC6H_BLOCK_DIMENSION; ++texel) {
+        texels[texel] = header.decode(texel);
+    }
+}
+
+glm::vec3 decode_bc6h_texel(const std::uint8_t* block, unsigned texel) {
+    return Block(block).decode(texel);
+}
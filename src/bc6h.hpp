@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+// Decoding of signed BC6H blocks (VK_FORMAT_BC6H_SFLOAT_BLOCK) on the CPU following the BC6H format description of
+// the Direct3D 11 functional specification. Every block is 16 bytes large and contains 4x4 texels, where texel i
+// is located at x = i % 4 and y = i / 4 within the block.
+constexpr std::size_t BC6H_BLOCK_SIZE = 16;
+constexpr unsigned BC6H_BLOCK_DIMENSION = 4;
+
+// Decodes all 16 texels of the block
+void decode_bc6h_block(const std::uint8_t* block, glm::vec3* texels);
+// Decodes a single texel, which is cheaper than decoding the whole block if only a few texels are needed
+glm::vec3 decode_bc6h_texel(const std::uint8_t* block, unsigned texel);
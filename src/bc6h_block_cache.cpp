@@ -0,0 +1,92 @@
+#include "bc6h_block_cache.hpp"
+#include <algorithm>
+#include <chrono>
+
+double Bc6hBlockCache::Counters::get_hit_rate() const {
+    const std::uint64_t fetch_count = this->hit_count + this->miss_count;
+    return fetch_count > 0 ? double(this->hit_count) / fetch_count : 0.0;
+}
+
+double Bc6hBlockCache::Counters::get_decode_time() const {
+    return this->miss_count > 0 ? double(this->decode_time) / this->miss_count : 0.0;
+}
+
+Bc6hBlockCache::Bc6hBlockCache(std::size_t memory_size) : shards(std::size_t(1) << SHARD_BITS) {
+    this->set_count = std::max<std::size_t>(memory_size / (sizeof(Entry) * WAY_COUNT * this->shards.size()), 1);
+
+    for (Shard& shard : this->shards) {
+        shard.entries = std::make_unique<Entry[]>(this->set_count * WAY_COUNT);
+    }
+}
+
+void Bc6hBlockCache::add_counters(const Counters& counters) {
+    this->hit_count.fetch_add(counters.hit_count, std::memory_order_relaxed);
+    this->miss_count.fetch_add(counters.miss_count, std::memory_order_relaxed);
+    this->decode_time.fetch_add(counters.decode_time, std::memory_order_relaxed);
+}
+
+Bc6hBlockCache::Counters Bc6hBlockCache::get_counters() const {
+    Counters counters;
+    counters.hit_count = this->hit_count.load(std::memory_order_relaxed);
+    counters.miss_count = this->miss_count.load(std::memory_order_relaxed);
+    counters.decode_time = this->decode_time.load(std::memory_order_relaxed);
+    return counters;
+}
+
+void Bc6hBlockCache::reset_counters() {
+    this->hit_count = 0;
+    this->miss_count = 0;
+    this->decode_time = 0;
+}
+
+glm::vec3 Bc6hBlockCache::decode(std::uint64_t key, const std::uint8_t* block, unsigned texel, Counters& counters) {
+    const auto start = std::chrono::steady_clock::now();
+    std::array<glm::vec3, TEXEL_COUNT> texels;
+    decode_bc6h_block(block, texels.data());
+    const auto end = std::chrono::steady_clock::now();
+
+    counters.miss_count++;
+    counters.decode_time += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    this->insert(key, texels);
+    return texels[texel];
+}
+
+void Bc6hBlockCache::insert(std::uint64_t key, const std::array<glm::vec3, TEXEL_COUNT>& texels) {
+    Shard* shard = nullptr;
+    Entry* set = this->get_set(hash(key), shard);
+    const std::uint32_t clock = shard->clock.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Replaces an empty entry or else the least recently used one
+    Entry* victim = &set[0];
+    std::uint32_t victim_age = 0;
+    for (unsigned way = 0; way < WAY_COUNT; ++way) {
+        if (set[way].key.load(std::memory_order_relaxed) == EMPTY_KEY) {
+            victim = &set[way];
+            break;
+        }
+
+        const std::uint32_t age = clock - set[way].last_use.load(std::memory_order_relaxed);
+        if (age > victim_age) {
+            victim = &set[way];
+            victim_age = age;
+        }
+    }
+
+    // Another thread is writing the entry, the block is simply not cached then
+    std::uint32_t sequence = victim->sequence.load(std::memory_order_relaxed);
+    if ((sequence & 1) != 0 || !victim->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+
+    victim->key.store(key, std::memory_order_relaxed);
+    for (unsigned texel = 0; texel < TEXEL_COUNT; ++texel) {
+        victim->values[3 * texel + 0].store(texels[texel].x, std::memory_order_relaxed);
+        victim->values[3 * texel + 1].store(texels[texel].y, std::memory_order_relaxed);
+        victim->values[3 * texel + 2].store(texels[texel].z, std::memory_order_relaxed);
+    }
+    victim->last_use.store(clock, std::memory_order_relaxed);
+
+    victim->sequence.store(sequence + 2, std::memory_order_release);
+}
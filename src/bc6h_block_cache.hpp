@@ -0,0 +1,128 @@
+#pragma once
+
+#include "bc6h.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <vector>
+
+// Cache of decoded BC6H blocks, so that BC6H datasets can be sampled on the CPU without decompressing whole slices.
+// The dataset stays compressed in memory and only the blocks that are actually sampled get decoded, which requires
+// the compressed size plus the fixed size of the cache.
+// The cache is split into shards, each of which is a set associative cache with 4 entries per set that are replaced
+// in least recently used order. Lookups and insertions are lock free: every entry is guarded by a sequence counter
+// that is odd while the entry is written, readers retry with the next entry if the counter changed while reading.
+// Recency is tracked with a clock per shard that only advances on insertions, so that hits do not contend.
+class Bc6hBlockCache {
+  public:
+    // Counters of a single sampler, which are added to the cache with add_counters() once it is done sampling
+    struct Counters {
+        std::uint64_t hit_count = 0;
+        std::uint64_t miss_count = 0;
+        std::uint64_t decode_time = 0; // In ns
+
+        double get_hit_rate() const;
+        // Average time to decode a block in ns
+        double get_decode_time() const;
+    };
+
+    explicit Bc6hBlockCache(std::size_t memory_size);
+
+    // Key of block block_index of z slice z in time slice t
+    static std::uint64_t make_key(unsigned t, unsigned z, std::size_t block_index, unsigned depth, std::size_t blocks_per_z_slice) {
+        return (std::uint64_t(t) * depth + z) * blocks_per_z_slice + block_index;
+    }
+
+    // Returns the texel of the block, decodes the whole block and inserts it into the cache on a miss
+    glm::vec3 fetch_texel(std::uint64_t key, const std::uint8_t* block, unsigned texel, Counters& counters) {
+        glm::vec3 value;
+        if (this->lookup(key, texel, value)) {
+            counters.hit_count++;
+            return value;
+        }
+        return this->decode(key, block, texel, counters);
+    }
+
+    void add_counters(const Counters& counters);
+    Counters get_counters() const;
+    void reset_counters();
+
+    // Number of blocks that fit into the cache
+    std::size_t get_capacity() const { return this->shards.size() * this->set_count * WAY_COUNT; }
+    std::size_t get_memory_size() const { return this->get_capacity() * sizeof(Entry); }
+
+  private:
+    static constexpr unsigned WAY_COUNT = 4;
+    static constexpr unsigned SHARD_BITS = 4;
+    static constexpr std::uint64_t EMPTY_KEY = ~std::uint64_t(0);
+    static constexpr unsigned TEXEL_COUNT = BC6H_BLOCK_DIMENSION * BC6H_BLOCK_DIMENSION;
+
+    struct alignas(64) Entry {
+        std::atomic<std::uint32_t> sequence = 0;
+        std::atomic<std::uint32_t> last_use = 0;
+        std::atomic<std::uint64_t> key = EMPTY_KEY;
+        std::array<std::atomic<float>, 3 * TEXEL_COUNT> values;
+    };
+
+    struct Shard {
+        std::unique_ptr<Entry[]> entries;
+        alignas(64) std::atomic<std::uint32_t> clock = 0;
+    };
+
+    static std::uint64_t hash(std::uint64_t key) {
+        // Finalizer of SplitMix64, spreads neighbouring blocks across shards and sets
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+        return key ^ (key >> 31);
+    }
+
+    Entry* get_set(std::uint64_t hash, Shard*& shard) {
+        shard = &this->shards[hash >> (64 - SHARD_BITS)];
+        return &shard->entries[(hash % this->set_count) * WAY_COUNT];
+    }
+
+    bool lookup(std::uint64_t key, unsigned texel, glm::vec3& value) {
+        Shard* shard = nullptr;
+        Entry* set = this->get_set(hash(key), shard);
+
+        for (unsigned way = 0; way < WAY_COUNT; ++way) {
+            Entry& entry = set[way];
+            if (entry.key.load(std::memory_order_relaxed) != key) {
+                continue;
+            }
+
+            const std::uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+            if ((sequence & 1) != 0 || entry.key.load(std::memory_order_relaxed) != key) {
+                continue;
+            }
+            value.x = entry.values[3 * texel + 0].load(std::memory_order_relaxed);
+            value.y = entry.values[3 * texel + 1].load(std::memory_order_relaxed);
+            value.z = entry.values[3 * texel + 2].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+
+            const std::uint32_t clock = shard->clock.load(std::memory_order_relaxed);
+            if (entry.last_use.load(std::memory_order_relaxed) != clock) {
+                entry.last_use.store(clock, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    glm::vec3 decode(std::uint64_t key, const std::uint8_t* block, unsigned texel, Counters& counters);
+    void insert(std::uint64_t key, const std::array<glm::vec3, TEXEL_COUNT>& texels);
+
+    std::vector<Shard> shards;
+    std::size_t set_count = 0; // Per shard
+
+    alignas(64) std::atomic<std::uint64_t> hit_count = 0;
+    std::atomic<std::uint64_t> miss_count = 0;
+    std::atomic<std::uint64_t> decode_time = 0;
+};
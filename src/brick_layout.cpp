@@ -0,0 +1,81 @@
+#include "brick_layout.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace {
+
+template <typename Value>
+void interleave_z_slice(const BrickLayout& layout, const glm::uvec3& dimensions, unsigned z, const std::array<const void*, 3>& channel_slices, void* bricked_slice) {
+    Value* destination = static_cast<Value*>(bricked_slice);
+    std::size_t planar_offset = std::size_t(dimensions.x) * dimensions.y * z;
+
+    for (unsigned y = 0; y < dimensions.y; ++y) {
+        for (unsigned x = 0; x < dimensions.x; ++x, ++planar_offset) {
+            const std::size_t offset = 3 * layout.get_offset(x, y, z);
+
+            for (unsigned c = 0; c < 3; ++c) {
+                destination[offset + c] = static_cast<const Value*>(channel_slices[c])[planar_offset];
+            }
+        }
+    }
+}
+
+} // namespace
+
+BrickLayout::BrickLayout(const glm::uvec3& dimensions, unsigned brick_size) : dimensions(dimensions), brick_size(brick_size) {
+    const unsigned brick_bits = std::countr_zero(brick_size);
+    const unsigned max_tile_bits = 3; // Tiles of up to 8^3 bricks
+
+    // Number of bits of the coordinate within a tile along every axis
+    std::array<unsigned, 3> tile_bits;
+    std::array<std::size_t, 3> tile_counts;
+    for (unsigned a = 0; a < 3; ++a) {
+        const unsigned brick_count = (dimensions[a] + brick_size - 1) / brick_size;
+        tile_bits[a] = brick_bits + std::min<unsigned>(std::bit_width(std::max(brick_count, 1u) - 1), max_tile_bits);
+        tile_counts[a] = (dimensions[a] + (1u << tile_bits[a]) - 1) >> tile_bits[a];
+    }
+
+    // Position of every coordinate bit in the Morton code, axes that run out of bits are skipped
+    std::array<std::array<unsigned, 32>, 3> bit_positions;
+    unsigned position = 0;
+    for (unsigned level = 0; level < *std::max_element(tile_bits.begin(), tile_bits.end()); ++level) {
+        for (unsigned a = 0; a < 3; ++a) {
+            if (level < tile_bits[a]) {
+                bit_positions[a][level] = position++;
+            }
+        }
+    }
+
+    const std::size_t tile_size = std::size_t(1) << position;
+    const std::array<std::size_t, 3> tile_strides = {
+        tile_size,
+        tile_size * tile_counts[0],
+        tile_size * tile_counts[0] * tile_counts[1],
+    };
+    this->texel_count = tile_size * tile_counts[0] * tile_counts[1] * tile_counts[2];
+
+    for (unsigned a = 0; a < 3; ++a) {
+        this->axis_offsets[a].resize(dimensions[a]);
+
+        for (unsigned v = 0; v < dimensions[a]; ++v) {
+            std::size_t offset = (v >> tile_bits[a]) * tile_strides[a];
+            for (unsigned level = 0; level < tile_bits[a]; ++level) {
+                offset |= std::size_t((v >> level) & 1) << bit_positions[a][level];
+            }
+            this->axis_offsets[a][v] = offset;
+        }
+    }
+}
+
+void BrickLayout::relayout(const std::array<const void*, 3>& channel_slices, std::size_t value_size, void* bricked_slice, ThreadPool& thread_pool) const {
+    thread_pool.parallel_for(this->dimensions.z, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t z = begin; z < end; ++z) {
+            if (value_size == sizeof(std::uint16_t)) {
+                interleave_z_slice<std::uint16_t>(*this, this->dimensions, z, channel_slices, bricked_slice);
+            } else {
+                interleave_z_slice<float>(*this, this->dimensions, z, channel_slices, bricked_slice);
+            }
+        }
+    });
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <array>
+#include <cstddef>
+#include <glm/vec3.hpp>
+#include <vector>
+
+// Bricked layout of a time slice for sampling on the CPU.
+// In the planar layout, the 8 corners of a trilinear interpolation lie in up to 4 cache lines per channel. The bricked
+// layout stores the 3 channels of a voxel next to each other and orders the voxels along a Morton curve, so that the
+// voxels of every aligned brick of brick_size^3 voxels are contiguous and most interpolations only touch 1 or 2 cache
+// lines. The bricks themselves are in Morton order within tiles of up to 8^3 bricks, which are in x fastest order.
+// Along every axis, the curve only interleaves as many bits as the dataset needs, so that little padding is required.
+// The offset of a voxel is the sum of a per axis offset, so that sampling only needs three small table lookups.
+class BrickLayout {
+  public:
+    BrickLayout(const glm::uvec3& dimensions, unsigned brick_size);
+
+    // Offset of the voxel in texels, multiply by 3 and add the channel to get the offset of a value
+    std::size_t get_offset(unsigned x, unsigned y, unsigned z) const {
+        return this->axis_offsets[0][x] + this->axis_offsets[1][y] + this->axis_offsets[2][z];
+    }
+
+    const std::size_t* get_axis_offsets(unsigned axis) const { return this->axis_offsets[axis].data(); }
+    // Number of voxels of a bricked slice including padding
+    std::size_t get_texel_count() const { return this->texel_count; }
+    unsigned get_brick_size() const { return this->brick_size; }
+
+    // Interleaves the planar slices of the 3 channels into bricked_slice, which has to hold 3 * get_texel_count()
+    // values. The z slices are distributed across the threads of the pool.
+    void relayout(const std::array<const void*, 3>& channel_slices, std::size_t value_size, void* bricked_slice, ThreadPool& thread_pool) const;
+
+    static bool is_valid_brick_size(unsigned brick_size) { return brick_size == 4 || brick_size == 8; }
+
+  private:
+    glm::uvec3 dimensions;
+    unsigned brick_size;
+    std::size_t texel_count = 0;
+    std::array<std::vector<std::size_t>, 3> axis_offsets;
+};
@@ -1,4 +1,5 @@
 #include "command_parser.hpp"
+#include "brick_layout.hpp"
 
 bool CommandParser::parse_commands(const argh::parser& cmd_line) {
     for (const std::string& flag : cmd_line.flags()) {
@@ -6,9 +7,41 @@ bool CommandParser::parse_commands(const argh::parser& cmd_line) {
             this->explicit_interpolation = true;
         }
 
+        if (flag == "cubic_interpolation") {
+            this->cubic_interpolation = true;
+        }
+
         if (flag == "analytic_dataset") {
             this->analytic_dataset = true;
         }
+
+        if (flag == "specialize_kernels") {
+            this->kernel_specialization = true;
+        }
+
+        if (flag == "single_submission") {
+            this->single_submission = true;
+        }
+
+        if (flag == "headless") {
+            this->headless = true;
+        }
+
+        if (flag == "cpu_integration") {
+            this->cpu_integration = true;
+        }
+
+        if (flag == "cpu_kernel_validation") {
+            this->cpu_kernel_validation = true;
+        }
+
+        if (flag == "cpu_benchmark") {
+            this->cpu_benchmark = true;
+        }
+
+        if (flag == "out_of_core") {
+            this->out_of_core = true;
+        }
     }
 
     for (const std::pair<std::string, std::string>& parameter : cmd_line.params()) {
@@ -72,6 +105,19 @@ bool CommandParser::parse_commands(const argh::parser& cmd_line) {
             this->work_group_size_z = work_group_size_z;
         }
 
+        else if (parameter.first == "particles_per_invocation") {
+            int32_t particles_per_invocation = atoi(parameter.second.c_str());
+
+            // The states of all particles of an invocation are kept in registers
+            if (particles_per_invocation <= 0 || particles_per_invocation > 8) {
+                lava::log()->error("Parameter 'particles_per_invocation' must be between 1 and 8!");
+
+                return false;
+            }
+
+            this->particles_per_invocation = particles_per_invocation;
+        }
+
         else if (parameter.first == "seed_dimension_x") {
             int32_t seed_dimension_x = atoi(parameter.second.c_str());
 
@@ -132,6 +178,18 @@ bool CommandParser::parse_commands(const argh::parser& cmd_line) {
             this->batch_size = batch_size;
         }
 
+        else if (parameter.first == "batch_duration") {
+            float batch_duration = atof(parameter.second.c_str());
+
+            if (batch_duration <= 0.0) {
+                lava::log()->error("Parameter 'batch_duration' smaller or equal to 0!");
+
+                return false;
+            }
+
+            this->batch_duration = batch_duration;
+        }
+
        else if (parameter.first == "delta_time") {
             float delta_time = atof(parameter.second.c_str());
 
@@ -144,6 +202,208 @@ bool CommandParser::parse_commands(const argh::parser& cmd_line) {
             this->delta_time = delta_time;
         }
 
+        else if (parameter.first == "method") {
+            std::optional<IntegrationMethod> integration_method = parse_integration_method(parameter.second);
+
+            if (!integration_method.has_value()) {
+                lava::log()->error("Parameter 'method' must be 'euler', 'midpoint', 'rk4', 'rk45' or 'abm4'!");
+
+                return false;
+            }
+
+            this->integration_method = integration_method;
+        }
+
+        else if (parameter.first == "counters") {
+            if (parameter.second != "atomic" && parameter.second != "subgroup") {
+                lava::log()->error("Parameter 'counters' must be 'atomic' or 'subgroup'!");
+
+                return false;
+            }
+
+            this->subgroup_counters = parameter.second == "subgroup";
+        }
+
+        else if (parameter.first == "scheduling") {
+            if (parameter.second != "grid" && parameter.second != "queue") {
+                lava::log()->error("Parameter 'scheduling' must be 'grid' or 'queue'!");
+
+                return false;
+            }
+
+            this->work_queue = parameter.second == "queue";
+        }
+
+        else if (parameter.first == "persistent_work_groups") {
+            int32_t persistent_work_groups = atoi(parameter.second.c_str());
+
+            if (persistent_work_groups <= 0) {
+                lava::log()->error("Parameter 'persistent_work_groups' smaller or equal to 0!");
+
+                return false;
+            }
+
+            this->persistent_work_groups = persistent_work_groups;
+        }
+
+        else if (parameter.first == "tolerance") {
+            float absolute_tolerance = atof(parameter.second.c_str());
+
+            if (absolute_tolerance <= 0.0) {
+                lava::log()->error("Parameter 'tolerance' smaller or equal to 0!");
+
+                return false;
+            }
+
+            this->absolute_tolerance = absolute_tolerance;
+        }
+
+        else if (parameter.first == "relative_tolerance") {
+            float relative_tolerance = atof(parameter.second.c_str());
+
+            if (relative_tolerance < 0.0) {
+                lava::log()->error("Parameter 'relative_tolerance' smaller than 0!");
+
+                return false;
+            }
+
+            this->relative_tolerance = relative_tolerance;
+        }
+
+        else if (parameter.first == "thread_count") {
+            int32_t thread_count = atoi(parameter.second.c_str());
+
+            if (thread_count <= 0) {
+                lava::log()->error("Parameter 'thread_count' smaller or equal to 0!");
+
+                return false;
+            }
+
+            this->thread_count = thread_count;
+        }
+
+        else if (parameter.first == "trajectory_file") {
+            if (parameter.second.empty()) {
+                lava::log()->error("Parameter 'trajectory_file' is empty!");
+
+                return false;
+            }
+
+            this->trajectory_file = parameter.second;
+        }
+
+        else if (parameter.first == "autotune_cache") {
+            if (parameter.second.empty()) {
+                lava::log()->error("Parameter 'autotune_cache' is empty!");
+
+                return false;
+            }
+
+            this->autotune_cache = parameter.second;
+        }
+
+        else if (parameter.first == "pipeline_cache") {
+            if (parameter.second.empty()) {
+                lava::log()->error("Parameter 'pipeline_cache' is empty!");
+
+                return false;
+            }
+
+            this->pipeline_cache = parameter.second;
+        }
+
+        else if (parameter.first == "kernel_cache") {
+            if (parameter.second.empty()) {
+                lava::log()->error("Parameter 'kernel_cache' is empty!");
+
+                return false;
+            }
+
+            this->kernel_cache = parameter.second;
+        }
+
+        else if (parameter.first == "cpu_kernel") {
+            std::optional<CpuKernel> cpu_kernel = parse_cpu_kernel(parameter.second);
+
+            if (!cpu_kernel.has_value()) {
+                lava::log()->error("Parameter 'cpu_kernel' must be 'scalar', 'avx2' or 'avx512'!");
+
+                return false;
+            }
+
+            this->cpu_kernel = cpu_kernel;
+        }
+
+        else if (parameter.first == "brick_size") {
+            int32_t brick_size = atoi(parameter.second.c_str());
+
+            if (!BrickLayout::is_valid_brick_size(brick_size)) {
+                lava::log()->error("Parameter 'brick_size' must be 4 or 8!");
+
+                return false;
+            }
+
+            this->brick_size = brick_size;
+        }
+
+        else if (parameter.first == "bc6h_cache_size") {
+            int32_t bc6h_cache_size = atoi(parameter.second.c_str());
+
+            if (bc6h_cache_size < 0) {
+                lava::log()->error("Parameter 'bc6h_cache_size' smaller than 0!");
+
+                return false;
+            }
+
+            this->bc6h_cache_size = bc6h_cache_size;
+        }
+
+        else if (parameter.first == "time_blending") {
+            std::optional<TimeBlending> time_blending = parse_time_blending(parameter.second);
+
+            if (!time_blending.has_value()) {
+                lava::log()->error("Parameter 'time_blending' must be 'off', 'on' or 'auto'!");
+
+                return false;
+            }
+
+            this->time_blending = time_blending;
+        }
+
+        else if (parameter.first == "numa") {
+            std::optional<NumaPlacement> numa_placement = parse_numa_placement(parameter.second);
+
+            if (!numa_placement.has_value()) {
+                lava::log()->error("Parameter 'numa' must be 'off', 'interleave' or 'replicate'!");
+
+                return false;
+            }
+
+            this->numa_placement = numa_placement;
+        }
+
+        else if (parameter.first == "numa_node_count") {
+            int32_t numa_node_count = atoi(parameter.second.c_str());
+
+            if (numa_node_count <= 0) {
+                lava::log()->error("Parameter 'numa_node_count' smaller or equal to 0!");
+
+                return false;
+            }
+
+            this->numa_node_count = numa_node_count;
+        }
+
+        else if (parameter.first.rfind("sweep_", 0) == 0) {
+            if (!this->sweep_grid.has_value()) {
+                this->sweep_grid.emplace();
+            }
+
+            if (!this->sweep_grid->set(parameter.first.substr(6), parameter.second)) {
+                return false;
+            }
+        }
+
         else {
             lava::log()->warn("Unkown parameter '" + parameter.first + "' !");
 
@@ -174,6 +434,10 @@ std::optional<uint32_t> CommandParser::get_work_group_size_z() const {
     return this->work_group_size_z;
 }
 
+std::optional<uint32_t> CommandParser::get_particles_per_invocation() const {
+    return this->particles_per_invocation;
+}
+
 std::optional<uint32_t> CommandParser::get_seed_dimensions_x() const {
     return this->seed_dimension_x;
 }
@@ -194,14 +458,122 @@ std::optional<uint32_t> CommandParser::get_batch_size() const {
     return this->batch_size;
 }
 
+std::optional<float> CommandParser::get_batch_duration() const {
+    return this->batch_duration;
+}
+
+std::optional<bool> CommandParser::use_single_submission() const {
+    return this->single_submission;
+}
+
 std::optional<float> CommandParser::get_delta_time() const {
     return this->delta_time;
 }
 
+std::optional<IntegrationMethod> CommandParser::get_integration_method() const {
+    return this->integration_method;
+}
+
+std::optional<float> CommandParser::get_absolute_tolerance() const {
+    return this->absolute_tolerance;
+}
+
+std::optional<float> CommandParser::get_relative_tolerance() const {
+    return this->relative_tolerance;
+}
+
 std::optional<bool> CommandParser::use_explicit_interpolation() const {
     return this->explicit_interpolation;
 }
 
+std::optional<bool> CommandParser::use_cubic_interpolation() const {
+    return this->cubic_interpolation;
+}
+
+std::optional<bool> CommandParser::use_subgroup_counters() const {
+    return this->subgroup_counters;
+}
+
+std::optional<bool> CommandParser::use_work_queue() const {
+    return this->work_queue;
+}
+
+std::optional<uint32_t> CommandParser::get_persistent_work_groups() const {
+    return this->persistent_work_groups;
+}
+
+std::optional<bool> CommandParser::use_kernel_specialization() const {
+    return this->kernel_specialization;
+}
+
 std::optional<bool> CommandParser::use_analytic_dataset() const {
     return this->analytic_dataset;
+}
+
+std::optional<bool> CommandParser::use_headless() const {
+    return this->headless;
+}
+
+std::optional<SweepGrid> CommandParser::get_sweep_grid() const {
+    return this->sweep_grid;
+}
+
+std::optional<std::string> CommandParser::get_autotune_cache() const {
+    return this->autotune_cache;
+}
+
+std::optional<std::string> CommandParser::get_pipeline_cache() const {
+    return this->pipeline_cache;
+}
+
+std::optional<std::string> CommandParser::get_kernel_cache() const {
+    return this->kernel_cache;
+}
+
+std::optional<bool> CommandParser::use_cpu_integration() const {
+    return this->cpu_integration;
+}
+
+std::optional<uint32_t> CommandParser::get_thread_count() const {
+    return this->thread_count;
+}
+
+std::optional<std::string> CommandParser::get_trajectory_file() const {
+    return this->trajectory_file;
+}
+
+std::optional<CpuKernel> CommandParser::get_cpu_kernel() const {
+    return this->cpu_kernel;
+}
+
+std::optional<bool> CommandParser::use_cpu_kernel_validation() const {
+    return this->cpu_kernel_validation;
+}
+
+std::optional<uint32_t> CommandParser::get_brick_size() const {
+    return this->brick_size;
+}
+
+std::optional<uint32_t> CommandParser::get_bc6h_cache_size() const {
+    return this->bc6h_cache_size;
+}
+
+std::optional<TimeBlending> CommandParser::get_time_blending() const {
+    return this->time_blending;
+}
+
+std::optional<bool> CommandParser::use_out_of_core() const {
+    return this->out_of_core;
+}
+
+std::optional<NumaPlacement> CommandParser::get_numa_placement() const {
+    return this->numa_placement;
+}
+
+std::optional<uint32_t> CommandParser::get_numa_node_count() const {
+    return this->numa_node_count;
+}
+
+std::optional<bool> CommandParser::use_cpu_benchmark() const {
+    return this->cpu_benchmark;
 }
\ No newline at end of file
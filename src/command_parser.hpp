@@ -1,5 +1,10 @@
 #pragma once
 
+#include "cpu_kernels.hpp"
+#include "integration_method.hpp"
+#include "numa.hpp"
+#include "parameter_sweep.hpp"
+#include "time_blending.hpp"
 #include <liblava/lava.hpp>
 #include <optional>
 
@@ -15,6 +20,7 @@ public:
     std::optional<uint32_t> get_work_group_size_x() const;
     std::optional<uint32_t> get_work_group_size_y() const;
     std::optional<uint32_t> get_work_group_size_z() const;
+    std::optional<uint32_t> get_particles_per_invocation() const;
 
     std::optional<uint32_t> get_seed_dimensions_x() const;
     std::optional<uint32_t> get_seed_dimensions_y() const;
@@ -22,11 +28,39 @@ public:
 
     std::optional<uint32_t> get_integration_steps() const;
     std::optional<uint32_t> get_batch_size() const;
+    std::optional<float> get_batch_duration() const;
+    std::optional<bool> use_single_submission() const;
     std::optional<float> get_delta_time() const;
 
+    std::optional<IntegrationMethod> get_integration_method() const;
+    std::optional<float> get_absolute_tolerance() const;
+    std::optional<float> get_relative_tolerance() const;
     std::optional<bool> use_explicit_interpolation() const;
+    std::optional<bool> use_cubic_interpolation() const;
+    std::optional<bool> use_subgroup_counters() const;
+    std::optional<bool> use_work_queue() const;
+    std::optional<uint32_t> get_persistent_work_groups() const;
+    std::optional<bool> use_kernel_specialization() const;
     std::optional<bool> use_analytic_dataset() const;
 
+    std::optional<bool> use_headless() const;
+    std::optional<SweepGrid> get_sweep_grid() const;
+    std::optional<std::string> get_autotune_cache() const;
+    std::optional<std::string> get_pipeline_cache() const;
+    std::optional<std::string> get_kernel_cache() const;
+    std::optional<bool> use_cpu_integration() const;
+    std::optional<uint32_t> get_thread_count() const;
+    std::optional<std::string> get_trajectory_file() const;
+    std::optional<CpuKernel> get_cpu_kernel() const;
+    std::optional<bool> use_cpu_kernel_validation() const;
+    std::optional<uint32_t> get_brick_size() const;
+    std::optional<uint32_t> get_bc6h_cache_size() const;
+    std::optional<TimeBlending> get_time_blending() const;
+    std::optional<bool> use_out_of_core() const;
+    std::optional<NumaPlacement> get_numa_placement() const;
+    std::optional<uint32_t> get_numa_node_count() const;
+    std::optional<bool> use_cpu_benchmark() const;
+
   private:
     std::optional<uint32_t> repetition_count;
     std::optional<float> repetition_delay; //In ms
@@ -34,6 +68,7 @@ public:
     std::optional<uint32_t> work_group_size_x;
     std::optional<uint32_t> work_group_size_y;
     std::optional<uint32_t> work_group_size_z;
+    std::optional<uint32_t> particles_per_invocation;
 
     std::optional<uint32_t> seed_dimension_x;
     std::optional<uint32_t> seed_dimension_y;
@@ -41,8 +76,36 @@ public:
 
     std::optional<uint32_t> integration_steps;
     std::optional<uint32_t> batch_size;
+    std::optional<float> batch_duration; //In ms
+    std::optional<bool> single_submission;
     std::optional<float> delta_time;
 
+    std::optional<IntegrationMethod> integration_method;
+    std::optional<float> absolute_tolerance; //In voxels
+    std::optional<float> relative_tolerance;
     std::optional<bool> explicit_interpolation;
+    std::optional<bool> cubic_interpolation;
+    std::optional<bool> subgroup_counters;
+    std::optional<bool> work_queue;
+    std::optional<uint32_t> persistent_work_groups;
+    std::optional<bool> kernel_specialization;
     std::optional<bool> analytic_dataset;
+
+    std::optional<bool> headless;
+    std::optional<SweepGrid> sweep_grid;
+    std::optional<std::string> autotune_cache;
+    std::optional<std::string> pipeline_cache;
+    std::optional<std::string> kernel_cache;
+    std::optional<bool> cpu_integration;
+    std::optional<uint32_t> thread_count;
+    std::optional<std::string> trajectory_file;
+    std::optional<CpuKernel> cpu_kernel;
+    std::optional<bool> cpu_kernel_validation;
+    std::optional<uint32_t> brick_size;
+    std::optional<uint32_t> bc6h_cache_size; //In MB
+    std::optional<TimeBlending> time_blending;
+    std::optional<bool> out_of_core;
+    std::optional<NumaPlacement> numa_placement;
+    std::optional<uint32_t> numa_node_count;
+    std::optional<bool> cpu_benchmark;
 };
\ No newline at end of file
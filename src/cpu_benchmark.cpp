@@ -0,0 +1,486 @@
+#include "cpu_benchmark.hpp"
+#include "bc6h_block_cache.hpp"
+#include "brick_layout.hpp"
+#include "cpu_sampling.hpp"
+#include "numa.hpp"
+#include "perf_counter.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <liblava/util/log.hpp>
+#include <memory>
+#include <optional>
+#include <random>
+#include <spdlog/fmt/bundled/core.h>
+#include <spdlog/fmt/bundled/ostream.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const glm::uvec4 BENCHMARK_DIMENSIONS = {128, 128, 128, 4};
+constexpr std::size_t BENCHMARK_STEP_COUNT = 1 << 16; // Random positions evaluated per pass
+constexpr double BENCHMARK_DURATION = 200.0;          // Minimal duration of the measurement in ms
+constexpr float BENCHMARK_DELTA_TIME = 0.1f;
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+constexpr std::size_t BENCHMARK_BLOCK_CACHE_SIZE = 64 * 1024 * 1024;
+constexpr std::size_t NUMA_BENCHMARK_STEP_BATCH = 1024; // Steps between two checks of the duration
+
+// Synthetic time slices of one format with the same layout as the slices of a HostDataset
+struct BenchmarkDataset {
+    CpuSampler sampler;
+    CpuLayout layout = CpuLayout::Planar;
+    std::vector<std::vector<std::uint8_t>> slices;
+    std::vector<const void*> slice_pointers;
+    std::size_t value_size = 0;
+    std::size_t z_slice_size = 0;
+    std::optional<BrickLayout> brick_layout;
+    std::unique_ptr<Bc6hBlockCache> block_cache;
+
+    CpuIntegrationContext create_context(bool explicit_interpolation) const {
+        const bool bricked = this->brick_layout.has_value();
+
+        return CpuIntegrationContext{
+            .slices = this->slice_pointers.data(),
+            .z_slice_size = this->z_slice_size,
+            .brick_offsets = {
+                bricked ? this->brick_layout->get_axis_offsets(0) : nullptr,
+                bricked ? this->brick_layout->get_axis_offsets(1) : nullptr,
+                bricked ? this->brick_layout->get_axis_offsets(2) : nullptr,
+            },
+            .bc6h_block_cache = this->block_cache.get(),
+            .dimensions = {BENCHMARK_DIMENSIONS.x, BENCHMARK_DIMENSIONS.y, BENCHMARK_DIMENSIONS.z, BENCHMARK_DIMENSIONS.w},
+            .seed_spawn = {1, 1, 1},
+            .integration_steps = 1,
+            .batch_size = 1,
+            .delta_time = BENCHMARK_DELTA_TIME,
+            .explicit_interpolation = explicit_interpolation,
+            .line_buffer = nullptr,
+            .indirect_buffer = nullptr,
+            .first_buffer_seed = 0,
+        };
+    }
+
+    // Number of distinct cache lines read by sampling the dataset at a position, i.e. by the trilinear interpolation
+    // of all channels in both time slices
+    std::size_t count_cache_lines(const glm::vec4& position) const {
+        if (this->sampler == CpuSampler::Analytic) {
+            return 0;
+        }
+
+        const unsigned x0 = unsigned(position.x), y0 = unsigned(position.y), z0 = unsigned(position.z);
+        const std::array<unsigned, 2> xs = {x0, std::min(x0 + 1, BENCHMARK_DIMENSIONS.x - 1)};
+        const std::array<unsigned, 2> ys = {y0, std::min(y0 + 1, BENCHMARK_DIMENSIONS.y - 1)};
+        const std::array<unsigned, 2> zs = {z0, std::min(z0 + 1, BENCHMARK_DIMENSIONS.z - 1)};
+        const std::array<unsigned, 2> ts = {unsigned(std::floor(position.w)), unsigned(std::ceil(position.w))};
+
+        std::vector<std::uintptr_t> lines;
+        const auto add_bytes = [&](const void* slice, std::size_t offset, std::size_t size) {
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(slice) + offset;
+            lines.push_back(address / CACHE_LINE_SIZE);
+            lines.push_back((address + size - 1) / CACHE_LINE_SIZE);
+        };
+
+        for (unsigned t : ts) {
+            for (unsigned z : zs) {
+                for (unsigned y : ys) {
+                    for (unsigned x : xs) {
+                        if (this->sampler == CpuSampler::BC6H) {
+                            const std::size_t blocks_x = (BENCHMARK_DIMENSIONS.x + BC6H_BLOCK_DIMENSION - 1) / BC6H_BLOCK_DIMENSION;
+                            const std::size_t block_index = (y / BC6H_BLOCK_DIMENSION) * blocks_x + x / BC6H_BLOCK_DIMENSION;
+                            add_bytes(this->slice_pointers[t], z * this->z_slice_size + block_index * BC6H_BLOCK_SIZE, BC6H_BLOCK_SIZE);
+                        } else if (this->brick_layout.has_value()) {
+                            add_bytes(this->slice_pointers[t], 3 * this->brick_layout->get_offset(x, y, z) * this->value_size, 3 * this->value_size);
+                        } else {
+                            const std::size_t offset = x + BENCHMARK_DIMENSIONS.x * (y + std::size_t(BENCHMARK_DIMENSIONS.y) * z);
+                            for (unsigned c = 0; c < 3; ++c) {
+                                add_bytes(this->slice_pointers[c * BENCHMARK_DIMENSIONS.w + t], offset * this->value_size, this->value_size);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::sort(lines.begin(), lines.end());
+        return std::unique(lines.begin(), lines.end()) - lines.begin();
+    }
+};
+
+struct BenchmarkResult {
+    double step_time = 0.0; // In ns
+    Bc6hBlockCache::Counters block_cache_counters;
+    std::optional<double> l1_misses;  // Per step
+    std::optional<double> llc_misses; // Per step
+};
+
+// Float32 and Float16 datasets contain the analytic field, so that the particles move like in real data
+BenchmarkDataset create_planar_dataset(CpuSampler sampler) {
+    BenchmarkDataset dataset;
+    dataset.sampler = sampler;
+    dataset.value_size = sampler == CpuSampler::Float32 ? sizeof(float) : sizeof(std::uint16_t);
+
+    const CpuIntegrationContext analytic_context = {};
+    const AnalyticSampler analytic_field(analytic_context);
+    const std::size_t voxel_count = std::size_t(BENCHMARK_DIMENSIONS.x) * BENCHMARK_DIMENSIONS.y * BENCHMARK_DIMENSIONS.z;
+
+    for (unsigned c = 0; c < 3; ++c) {
+        for (unsigned t = 0; t < BENCHMARK_DIMENSIONS.w; ++t) {
+            std::vector<std::uint8_t>& slice = dataset.slices.emplace_back(voxel_count * dataset.value_size);
+            std::size_t index = 0;
+
+            for (unsigned z = 0; z < BENCHMARK_DIMENSIONS.z; ++z) {
+                for (unsigned y = 0; y < BENCHMARK_DIMENSIONS.y; ++y) {
+                    for (unsigned x = 0; x < BENCHMARK_DIMENSIONS.x; ++x, ++index) {
+                        const float value = analytic_field.sample_dataset(glm::vec4(x, y, z, t))[c];
+
+                        if (sampler == CpuSampler::Float32) {
+                            reinterpret_cast<float*>(slice.data())[index] = value;
+                        } else {
+                            reinterpret_cast<std::uint16_t*>(slice.data())[index] = glm::packHalf1x16(value);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return dataset;
+}
+
+BenchmarkDataset create_bricked_dataset(const BenchmarkDataset& planar_dataset, unsigned brick_size, ThreadPool& thread_pool) {
+    BenchmarkDataset dataset;
+    dataset.sampler = planar_dataset.sampler;
+    dataset.layout = CpuLayout::Bricked;
+    dataset.value_size = planar_dataset.value_size;
+    dataset.brick_layout = BrickLayout(glm::uvec3(BENCHMARK_DIMENSIONS), brick_size);
+
+    for (unsigned t = 0; t < BENCHMARK_DIMENSIONS.w; ++t) {
+        const std::array<const void*, 3> channel_slices = {
+            planar_dataset.slices[0 * BENCHMARK_DIMENSIONS.w + t].data(),
+            planar_dataset.slices[1 * BENCHMARK_DIMENSIONS.w + t].data(),
+            planar_dataset.slices[2 * BENCHMARK_DIMENSIONS.w + t].data(),
+        };
+        std::vector<std::uint8_t>& slice = dataset.slices.emplace_back(3 * dataset.brick_layout->get_texel_count() * dataset.value_size);
+        dataset.brick_layout->relayout(channel_slices, dataset.value_size, slice.data(), thread_pool);
+    }
+
+    return dataset;
+}
+
+// BC6H datasets contain random blocks of all 14 modes, since the cost of decoding does not depend on the endpoints
+BenchmarkDataset create_bc6h_dataset() {
+    constexpr std::array<std::uint8_t, 14> mode_values = {0x00, 0x01, 0x02, 0x06, 0x0A, 0x0E, 0x12, 0x16, 0x1A, 0x1E, 0x03, 0x07, 0x0B, 0x0F};
+
+    BenchmarkDataset dataset;
+    dataset.sampler = CpuSampler::BC6H;
+
+    const std::size_t blocks_x = (BENCHMARK_DIMENSIONS.x + BC6H_BLOCK_DIMENSION - 1) / BC6H_BLOCK_DIMENSION;
+    const std::size_t blocks_y = (BENCHMARK_DIMENSIONS.y + BC6H_BLOCK_DIMENSION - 1) / BC6H_BLOCK_DIMENSION;
+    dataset.z_slice_size = blocks_x * blocks_y * BC6H_BLOCK_SIZE;
+
+    std::mt19937 generator(42);
+    for (unsigned t = 0; t < BENCHMARK_DIMENSIONS.w; ++t) {
+        std::vector<std::uint8_t>& slice = dataset.slices.emplace_back(dataset.z_slice_size * BENCHMARK_DIMENSIONS.z);
+
+        for (std::size_t i = 0; i < slice.size(); ++i) {
+            slice[i] = std::uint8_t(generator());
+        }
+
+        for (std::size_t block = 0; block < slice.size() / BC6H_BLOCK_SIZE; ++block) {
+            const std::uint8_t mode_value = mode_values[block % mode_values.size()];
+            const std::uint8_t mode_mask = mode_value < 2 ? 0x03 : 0x1F;
+            std::uint8_t& first_byte = slice[block * BC6H_BLOCK_SIZE];
+            first_byte = (first_byte & ~mode_mask) | mode_value;
+        }
+    }
+
+    return dataset;
+}
+
+template <typename Sampler, typename Method>
+BenchmarkResult measure_step(const CpuIntegrationContext& context, const std::vector<glm::vec4>& positions, PerfCounter& l1_counter, PerfCounter& llc_counter, float& checksum) {
+    glm::vec3 velocity_sum = glm::vec3(0.0f);
+    std::size_t step_count = 0;
+    if (context.bc6h_block_cache != nullptr) {
+        context.bc6h_block_cache->reset_counters();
+    }
+
+    // The sampler adds its block cache counters when it is destroyed
+    std::optional<Sampler> sampler;
+    sampler.emplace(context);
+
+    l1_counter.start();
+    llc_counter.start();
+    const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed;
+    do {
+        for (const glm::vec4& position : positions) {
+            velocity_sum += Method::velocity(*sampler, position, context.delta_time);
+        }
+        step_count += positions.size();
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < BENCHMARK_DURATION);
+    const std::optional<std::uint64_t> l1_misses = l1_counter.stop();
+    const std::optional<std::uint64_t> llc_misses = llc_counter.stop();
+    sampler.reset();
+
+    // Keeps the compiler from removing the samples
+    checksum += velocity_sum.x + velocity_sum.y + velocity_sum.z;
+
+    BenchmarkResult result;
+    result.step_time = elapsed.count() * 1e6 / step_count;
+    if (context.bc6h_block_cache != nullptr) {
+        result.block_cache_counters = context.bc6h_block_cache->get_counters();
+    }
+    if (l1_misses.has_value()) {
+        result.l1_misses = double(l1_misses.value()) / step_count;
+    }
+    if (llc_misses.has_value()) {
+        result.llc_misses = double(llc_misses.value()) / step_count;
+    }
+    return result;
+}
+
+struct NumaBenchmarkResult {
+    unsigned thread_count = 0;
+    double steps_per_second = 0.0;
+    HostBuffer::Pages pages = HostBuffer::Pages::Small;
+};
+
+// Throughput of RK4 steps taken by one thread per CPU of the first node_count nodes, which are pinned to their node.
+// The slices are copied into buffers placed like by HostDataset::place(), without placement they are written by the
+// calling thread and therefore end up on its node.
+NumaBenchmarkResult measure_numa_throughput(const BenchmarkDataset& dataset, NumaPlacement placement, const NumaTopology& topology, unsigned node_count, const std::vector<glm::vec4>& positions, float& checksum) {
+    NumaBenchmarkResult result;
+    for (unsigned node = 0; node < node_count; ++node) {
+        result.thread_count += static_cast<unsigned>(topology.get_cpus(node).size());
+    }
+    const std::vector<unsigned> worker_nodes = topology.assign_workers(result.thread_count, node_count);
+
+    const unsigned replica_count = placement == NumaPlacement::Replicate ? node_count : 1;
+    std::vector<std::vector<HostBuffer>> replicas(replica_count);
+    std::vector<std::vector<const void*>> slice_pointers(replica_count);
+    std::vector<CpuIntegrationContext> contexts;
+    bool bound = true;
+
+    for (unsigned replica = 0; replica < replica_count; ++replica) {
+        for (const std::vector<std::uint8_t>& slice : dataset.slices) {
+            HostBuffer& placed_slice = replicas[replica].emplace_back(slice.size());
+            if (placement == NumaPlacement::Replicate) {
+                bound &= placed_slice.bind(topology, replica);
+            } else if (placement == NumaPlacement::Interleave) {
+                bound &= placed_slice.interleave(topology, node_count);
+            }
+
+            std::memcpy(placed_slice.data(), slice.data(), slice.size());
+            slice_pointers[replica].push_back(placed_slice.data());
+        }
+
+        CpuIntegrationContext& context = contexts.emplace_back(dataset.create_context(false));
+        context.slices = slice_pointers[replica].data();
+    }
+    if (!bound) {
+        lava::log()->warn("cpu benchmark: failed to bind slices to NUMA nodes, using first touch placement");
+    }
+    result.pages = replicas.front().front().get_pages();
+
+    ThreadPool thread_pool(result.thread_count, [&](unsigned worker) {
+        topology.pin_current_thread(worker_nodes[worker]);
+    });
+
+    std::atomic<std::size_t> step_count = 0;
+    std::vector<float> velocity_sums(result.thread_count, 0.0f);
+    const auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < result.thread_count; ++i) {
+        thread_pool.submit([&]() {
+            const unsigned worker = ThreadPool::get_worker_index().value();
+            const CpuIntegrationContext& context = contexts[replica_count == 1 ? 0 : worker_nodes[worker]];
+            const PlanarSampler<Float32Texels, false> sampler(context);
+
+            // The workers start at different positions, so that they do not sample the same cache lines at once
+            std::size_t position_index = std::size_t(worker) * positions.size() / result.thread_count;
+            std::size_t worker_step_count = 0;
+            glm::vec3 velocity_sum = glm::vec3(0.0f);
+
+            do {
+                for (std::size_t step = 0; step < NUMA_BENCHMARK_STEP_BATCH; ++step) {
+                    velocity_sum += RungeKutta4Method::velocity(sampler, positions[position_index], BENCHMARK_DELTA_TIME);
+                    position_index = (position_index + 1) % positions.size();
+                }
+                worker_step_count += NUMA_BENCHMARK_STEP_BATCH;
+            } while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < BENCHMARK_DURATION);
+
+            step_count += worker_step_count;
+            velocity_sums[worker] = velocity_sum.x + velocity_sum.y + velocity_sum.z;
+        });
+    }
+    thread_pool.wait();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    for (float velocity_sum : velocity_sums) {
+        checksum += velocity_sum;
+    }
+
+    result.steps_per_second = step_count / elapsed.count();
+    return result;
+}
+
+std::string format_optional(const std::optional<double>& value) {
+    return value.has_value() ? fmt::format("{:.2f}", value.value()) : "n/a";
+}
+
+} // namespace
+
+bool run_cpu_benchmark() {
+    lava::log()->info("cpu benchmark: creating {}x{}x{}x{} datasets", BENCHMARK_DIMENSIONS.x, BENCHMARK_DIMENSIONS.y, BENCHMARK_DIMENSIONS.z, BENCHMARK_DIMENSIONS.w);
+
+    ThreadPool thread_pool(std::max(std::thread::hardware_concurrency(), 1u));
+    std::vector<BenchmarkDataset> datasets;
+    for (CpuSampler sampler : {CpuSampler::Float32, CpuSampler::Float16}) {
+        BenchmarkDataset planar_dataset = create_planar_dataset(sampler);
+        for (unsigned brick_size : {4, 8}) {
+            datasets.push_back(create_bricked_dataset(planar_dataset, brick_size, thread_pool));
+        }
+        datasets.push_back(std::move(planar_dataset));
+    }
+    datasets.push_back(create_bc6h_dataset());
+    BenchmarkDataset cached_bc6h_dataset = create_bc6h_dataset();
+    cached_bc6h_dataset.block_cache = std::make_unique<Bc6hBlockCache>(BENCHMARK_BLOCK_CACHE_SIZE);
+    datasets.push_back(std::move(cached_bc6h_dataset));
+    BenchmarkDataset analytic_dataset; // Evaluated without any slices
+    analytic_dataset.sampler = CpuSampler::Analytic;
+    datasets.push_back(std::move(analytic_dataset));
+
+    for (BenchmarkDataset& dataset : datasets) {
+        for (const std::vector<std::uint8_t>& slice : dataset.slices) {
+            dataset.slice_pointers.push_back(slice.data());
+        }
+    }
+
+    // Positions in the interior, so that the later stages of the integration methods stay inside as well
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    std::vector<glm::vec4> positions(BENCHMARK_STEP_COUNT);
+    for (glm::vec4& position : positions) {
+        for (unsigned i = 0; i < 4; ++i) {
+            position[i] = distribution(generator) * (BENCHMARK_DIMENSIONS[i] - 2.0f);
+        }
+    }
+
+    PerfCounter l1_counter(PerfCounter::Event::L1DataCacheMisses);
+    PerfCounter llc_counter(PerfCounter::Event::LastLevelCacheMisses);
+    if (!l1_counter.is_available() || !llc_counter.is_available()) {
+        lava::log()->warn("cpu benchmark: hardware cache miss counters are not available, only the cache lines touched per sample are reported");
+    }
+
+    std::time_t t = std::time(0); // get time now
+    std::tm* now = std::localtime(&t);
+    const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-cpu-benchmark.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
+    std::ofstream log_file(filename);
+    if (!log_file) {
+        lava::log()->error("cpu benchmark: failed to create '{}'", filename);
+        return false;
+    }
+    fmt::print(log_file, "method,sampler,layout,brick_size,block_cache,explicit_interpolation,samples_per_step,step_ns,steps_per_second,cache_lines_per_sample,l1_misses_per_sample,llc_misses_per_sample,block_cache_hit_rate,block_decode_ns\n");
+
+    std::vector<double> cache_lines_per_sample;
+    for (const BenchmarkDataset& dataset : datasets) {
+        std::size_t cache_lines = 0;
+        for (const glm::vec4& position : positions) {
+            cache_lines += dataset.count_cache_lines(position);
+        }
+        cache_lines_per_sample.push_back(double(cache_lines) / positions.size());
+    }
+
+    float checksum = 0.0f;
+    for (IntegrationMethod method : {IntegrationMethod::Euler, IntegrationMethod::Midpoint, IntegrationMethod::RungeKutta4}) {
+        for (std::size_t d = 0; d < datasets.size(); ++d) {
+            const BenchmarkDataset& dataset = datasets[d];
+            const unsigned brick_size = dataset.brick_layout.has_value() ? dataset.brick_layout->get_brick_size() : 0;
+
+            for (bool explicit_interpolation : {false, true}) {
+                // The analytic field is not interpolated
+                if (dataset.sampler == CpuSampler::Analytic && explicit_interpolation) {
+                    continue;
+                }
+
+                const CpuKernelSpecialization specialization = {
+                    .sampler = dataset.sampler,
+                    .layout = dataset.layout,
+                    .explicit_interpolation = explicit_interpolation,
+                    .method = method,
+                };
+                const CpuIntegrationContext context = dataset.create_context(explicit_interpolation);
+                unsigned samples_per_step = 0;
+                BenchmarkResult result;
+
+                visit_cpu_sampler(specialization, [&]<typename Sampler>() {
+                    visit_integration_method(method, [&]<typename Method>() {
+                        samples_per_step = Method::SAMPLES_PER_STEP;
+                        result = measure_step<Sampler, Method>(context, positions, l1_counter, llc_counter, checksum);
+                    });
+                });
+
+                std::optional<double> l1_misses_per_sample;
+                std::optional<double> llc_misses_per_sample;
+                if (result.l1_misses.has_value()) {
+                    l1_misses_per_sample = result.l1_misses.value() / samples_per_step;
+                }
+                if (result.llc_misses.has_value()) {
+                    llc_misses_per_sample = result.llc_misses.value() / samples_per_step;
+                }
+
+                const bool block_cache = dataset.block_cache != nullptr;
+                const Bc6hBlockCache::Counters& cache_counters = result.block_cache_counters;
+                const std::string layout_name = fmt::format("{}{}{}", get_cpu_layout_name(dataset.layout), brick_size > 0 ? std::to_string(brick_size) : "", block_cache ? "+cache" : "");
+
+                lava::log()->info("cpu benchmark: {:>8} {:>8} {:>13} {:>8}: {:8.1f} ns/step, {:6.1f} ns/sample, {:5.2f} cache lines/sample, {} L1 misses/sample, {} LLC misses/sample{}",
+                    get_integration_method_name(method), get_cpu_sampler_name(dataset.sampler), layout_name,
+                    explicit_interpolation ? "explicit" : "implicit", result.step_time, result.step_time / samples_per_step, cache_lines_per_sample[d],
+                    format_optional(l1_misses_per_sample), format_optional(llc_misses_per_sample),
+                    block_cache ? fmt::format(", {:.2f}% block cache hits, {:.0f} ns/block decode", cache_counters.get_hit_rate() * 100.0, cache_counters.get_decode_time()) : "");
+                fmt::print(log_file, "{},{},{},{},{},{},{},{},{},{},{},{},{},{}\n", get_integration_method_name(method), get_cpu_sampler_name(dataset.sampler), get_cpu_layout_name(dataset.layout), brick_size, block_cache,
+                    explicit_interpolation, samples_per_step, result.step_time, 1e9 / result.step_time, cache_lines_per_sample[d],
+                    format_optional(l1_misses_per_sample), format_optional(llc_misses_per_sample), cache_counters.get_hit_rate(), cache_counters.get_decode_time());
+            }
+        }
+    }
+
+    // Every placement with every number of nodes, the planar Float32 dataset is sampled by all threads
+    const NumaTopology topology = NumaTopology::detect();
+    const std::string numa_filename = fmt::format("{}-{}-{}-{}-{}-{}-cpu-numa-benchmark.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
+    std::ofstream numa_log_file(numa_filename);
+    if (!numa_log_file) {
+        lava::log()->error("cpu benchmark: failed to create '{}'", numa_filename);
+        return false;
+    }
+    fmt::print(numa_log_file, "placement,node_count,thread_count,pages,steps_per_second,steps_per_second_per_thread\n");
+
+    const auto planar_dataset = std::find_if(datasets.begin(), datasets.end(), [](const BenchmarkDataset& dataset) {
+        return dataset.sampler == CpuSampler::Float32 && dataset.layout == CpuLayout::Planar;
+    });
+    for (unsigned node_count = 1; node_count <= topology.get_node_count(); ++node_count) {
+        for (NumaPlacement placement : {NumaPlacement::Off, NumaPlacement::Interleave, NumaPlacement::Replicate}) {
+            const NumaBenchmarkResult result = measure_numa_throughput(*planar_dataset, placement, topology, node_count, positions, checksum);
+
+            lava::log()->info("cpu benchmark: {:>10} placement on {} of {} NUMA nodes: {:.0f} steps/s with {} threads ({:.0f} steps/s per thread, {} pages)",
+                get_numa_placement_name(placement), node_count, topology.get_node_count(), result.steps_per_second, result.thread_count,
+                result.steps_per_second / result.thread_count, get_host_buffer_pages_name(result.pages));
+            fmt::print(numa_log_file, "{},{},{},{},{},{}\n", get_numa_placement_name(placement), node_count, result.thread_count, get_host_buffer_pages_name(result.pages),
+                result.steps_per_second, result.steps_per_second / result.thread_count);
+        }
+    }
+
+    lava::log()->debug("cpu benchmark: checksum {}", checksum);
+    lava::log()->info("cpu benchmark: results written to '{}' and '{}'", filename, numa_filename);
+
+    return true;
+}
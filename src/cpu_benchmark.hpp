@@ -0,0 +1,8 @@
+#pragma once
+
+// Measures the cost of a single integration step for every combination of sampler policy, interpolation mode and
+// integration method on one thread (--cpu_benchmark). The steps are evaluated at random positions in synthetic
+// datasets, so that the result does not depend on how long the path lines of a particular dataset are.
+// Afterwards, the throughput of all threads is measured for every NUMA placement of the dataset and number of nodes.
+// The results are logged and written to csv files.
+bool run_cpu_benchmark();
@@ -0,0 +1,535 @@
+#include "cpu_integrator.hpp"
+#include "trajectory_file.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <glm/glm.hpp>
+#include <limits>
+#include <liblava/core/time.hpp>
+#include <liblava/util/log.hpp>
+#include <spdlog/fmt/bundled/core.h>
+#include <spdlog/fmt/bundled/ostream.h>
+
+bool CpuIntegrator::create(const argh::parser& cmd_line) {
+    if (!this->command_parser.parse_commands(cmd_line)) {
+        return false;
+    }
+
+    this->seed_spawn.x = this->command_parser.get_seed_dimensions_x().value_or(this->seed_spawn.x);
+    this->seed_spawn.y = this->command_parser.get_seed_dimensions_y().value_or(this->seed_spawn.y);
+    this->seed_spawn.z = this->command_parser.get_seed_dimensions_z().value_or(this->seed_spawn.z);
+    this->integration_steps = this->command_parser.get_integration_steps().value_or(this->integration_steps);
+    this->batch_size = this->command_parser.get_batch_size().value_or(this->batch_size);
+    this->delta_time = this->command_parser.get_delta_time().value_or(this->delta_time);
+    this->integration_method = this->command_parser.get_integration_method().value_or(this->integration_method);
+    this->explicit_interpolation = this->command_parser.use_explicit_interpolation().value_or(this->explicit_interpolation);
+    this->cubic_interpolation = this->command_parser.use_cubic_interpolation().value_or(this->cubic_interpolation);
+    this->analytic_dataset = this->command_parser.use_analytic_dataset().value_or(this->analytic_dataset);
+    this->brick_size = this->command_parser.get_brick_size().value_or(this->brick_size);
+    this->time_blending = this->command_parser.get_time_blending().value_or(this->time_blending);
+    this->out_of_core = this->command_parser.use_out_of_core().value_or(this->out_of_core);
+    this->bc6h_cache_size = this->command_parser.get_bc6h_cache_size().value_or(this->bc6h_cache_size);
+    this->thread_count = this->command_parser.get_thread_count().value_or(this->thread_count);
+    this->numa_placement = this->command_parser.get_numa_placement().value_or(this->numa_placement);
+    this->numa_node_count = this->command_parser.get_numa_node_count().value_or(this->numa_node_count);
+    this->kernel_validation = this->command_parser.use_cpu_kernel_validation().value_or(this->kernel_validation);
+
+    if (is_gpu_only_integration_method(this->integration_method)) {
+        lava::log()->error("cpu integration: {} method is only supported on the GPU", get_integration_method_name(this->integration_method));
+        return false;
+    }
+
+    this->preferred_kernel = this->command_parser.get_cpu_kernel().value_or(get_best_cpu_kernel());
+    if (!is_cpu_kernel_supported(this->preferred_kernel)) {
+        lava::log()->warn("cpu integration: {} kernel is not supported by this processor or build, falling back to {} kernel", get_cpu_kernel_name(this->preferred_kernel), get_cpu_kernel_name(get_best_cpu_kernel()));
+        this->preferred_kernel = get_best_cpu_kernel();
+    }
+    this->kernel = this->preferred_kernel;
+
+    // Without NUMA placement, the threads are not pinned and all of them sample the only replica of the dataset
+    this->numa_topology = NumaTopology::detect();
+    this->worker_nodes.assign(std::max(this->thread_count, 1u), 0);
+    std::function<void(unsigned)> initialize_worker;
+    if (this->numa_placement != NumaPlacement::Off) {
+        const unsigned node_count = this->numa_topology.get_node_count();
+        this->numa_node_count = this->numa_node_count > 0 ? std::min(this->numa_node_count, node_count) : node_count;
+        this->worker_nodes = this->numa_topology.assign_workers(std::max(this->thread_count, 1u), this->numa_node_count);
+
+        initialize_worker = [this](unsigned worker) {
+            if (!this->numa_topology.pin_current_thread(this->worker_nodes[worker])) {
+                lava::log()->warn("cpu integration: failed to pin thread {} to NUMA node {}", worker, this->numa_topology.get_node_id(this->worker_nodes[worker]));
+            }
+        };
+        lava::log()->info("cpu integration threads pinned to {} of {} NUMA nodes", this->numa_node_count, node_count);
+    }
+
+    this->thread_pool = std::make_unique<ThreadPool>(this->thread_count, initialize_worker);
+    this->scheduler = std::make_unique<WorkStealingScheduler>(*this->thread_pool);
+    lava::log()->info("cpu integration with {} threads and {} method", this->thread_pool->get_thread_count(), get_integration_method_name(this->integration_method));
+
+    return true;
+}
+
+bool CpuIntegrator::set_dataset(DataSource::Ptr data) {
+    this->log_file.close();
+    this->run = 0;
+    this->line_buffer.clear();
+    this->indirect_buffer.clear();
+    this->slices.clear();
+    this->bc6h_block_cache = nullptr;
+    this->prefetcher = nullptr;
+    this->dataset = nullptr;
+
+    if (!data) {
+        return false;
+    }
+
+    // Like the GPU integration, the analytic field uses the dimensions of the loaded dataset but none of its data
+    if (this->analytic_dataset) {
+        this->dataset = std::make_shared<HostDataset>(data);
+        this->sampler = CpuSampler::Analytic;
+    } else {
+        this->dataset = HostDataset::make(data, this->out_of_core);
+        if (!this->dataset) {
+            return false;
+        }
+
+        switch (data->format) {
+            case DataSource::Format::Float32:
+                this->sampler = CpuSampler::Float32;
+                break;
+            case DataSource::Format::Float16:
+                this->sampler = CpuSampler::Float16;
+                break;
+            case DataSource::Format::BC6H:
+                this->sampler = CpuSampler::BC6H;
+                break;
+        }
+
+        this->layout = CpuLayout::Planar;
+        if (this->brick_size > 0) {
+            if (this->sampler == CpuSampler::BC6H) {
+                lava::log()->warn("cpu integration: BC6H datasets are not bricked, their slices already consist of blocks");
+            } else if (this->out_of_core) {
+                lava::log()->warn("cpu integration: mapped datasets are not bricked, the slices are sampled in the layout of the file");
+            } else if (!this->dataset->make_bricked(this->brick_size, *this->thread_pool)) {
+                return false;
+            } else {
+                this->layout = CpuLayout::Bricked;
+            }
+        }
+
+        if (this->out_of_core) {
+            if (this->numa_placement != NumaPlacement::Off) {
+                lava::log()->warn("cpu integration: mapped datasets are not placed on NUMA nodes, only the threads are pinned");
+            }
+            this->prefetcher = std::make_unique<SlicePrefetcher>(this->dataset);
+        } else if (!this->dataset->place(this->numa_placement, this->numa_topology, this->numa_node_count, *this->thread_pool)) {
+            return false;
+        }
+
+        if (this->sampler == CpuSampler::BC6H && this->bc6h_cache_size > 0) {
+            this->bc6h_block_cache = std::make_unique<Bc6hBlockCache>(std::size_t(this->bc6h_cache_size) * 1024 * 1024);
+            lava::log()->info("bc6h block cache created ({} MB, {} blocks)", static_cast<double>(this->bc6h_block_cache->get_memory_size()) / 1024.0 / 1024.0, this->bc6h_block_cache->get_capacity());
+        }
+
+        this->slices.resize(this->dataset->get_replica_count());
+        for (unsigned replica = 0; replica < this->dataset->get_replica_count(); ++replica) {
+            for (unsigned c = 0; c < this->dataset->get_slice_channel_count(); ++c) {
+                for (unsigned t = 0; t < data->dimensions.w; ++t) {
+                    this->slices[replica].push_back(this->dataset->get_slice(c, t, replica));
+                }
+            }
+        }
+    }
+
+    this->kernel = this->preferred_kernel;
+    if (!is_cpu_kernel_applicable(this->kernel, this->get_specialization())) {
+        lava::log()->info("cpu integration: {} kernel does not support {} {} datasets with {} method and {} interpolation, using scalar kernel", get_cpu_kernel_name(this->kernel), get_cpu_layout_name(this->layout), get_cpu_sampler_name(this->sampler), get_integration_method_name(this->integration_method), this->cubic_interpolation ? "cubic" : "linear");
+        this->kernel = CpuKernel::Scalar;
+    }
+
+    // The vectorized kernels gather with 32 bit offsets
+    const std::size_t voxel_count = std::size_t(data->dimensions.x) * data->dimensions.y * data->dimensions.z;
+    if (this->kernel != CpuKernel::Scalar && voxel_count > std::size_t(std::numeric_limits<std::int32_t>::max())) {
+        lava::log()->warn("cpu integration: time slices too large for {} kernel, falling back to scalar kernel", get_cpu_kernel_name(this->kernel));
+        this->kernel = CpuKernel::Scalar;
+    }
+
+    this->blended_volumes = nullptr;
+    if (this->time_blending != TimeBlending::Off) {
+        const std::size_t seed_count = std::size_t(this->seed_spawn.x) * this->seed_spawn.y * this->seed_spawn.z;
+        bool blend = this->time_blending == TimeBlending::On;
+
+        if (this->sampler == CpuSampler::Analytic) {
+            lava::log()->info("cpu integration: time blending is not applicable to the analytic dataset");
+            blend = false;
+        } else if (this->cubic_interpolation) {
+            // The blended volumes are interpolated linearly
+            lava::log()->info("cpu integration: time blending is not applicable to cubic interpolation");
+            blend = false;
+        } else if (this->time_blending == TimeBlending::Auto) {
+            // The vectorized kernels sample the dataset directly
+            blend = this->kernel == CpuKernel::Scalar && is_time_blending_profitable(this->integration_method, seed_count, voxel_count);
+            lava::log()->info("cpu integration: time blending {} ({} seeds, {} voxels)", blend ? "pays off" : "does not pay off", seed_count, voxel_count);
+        }
+
+        if (blend) {
+            this->kernel = CpuKernel::Scalar;
+            this->blended_volumes = std::make_unique<BlendedVolumes>(voxel_count);
+        }
+    }
+
+    // Only the scalar kernel can advance all particles batch by batch
+    if (this->prefetcher && this->kernel != CpuKernel::Scalar) {
+        lava::log()->info("cpu integration: {} kernel does not support out-of-core integration, using scalar kernel", get_cpu_kernel_name(this->kernel));
+        this->kernel = CpuKernel::Scalar;
+    }
+    lava::log()->info("cpu integration of {} {} dataset with {} kernel{}{}", get_cpu_layout_name(this->layout), get_cpu_sampler_name(this->sampler), get_cpu_kernel_name(this->kernel), this->blended_volumes ? " and time blending" : "", this->prefetcher ? " out of core" : "");
+
+    if (this->command_parser.get_delta_time().has_value()) {
+        this->delta_time = this->command_parser.get_delta_time().value();
+    }
+
+    else {
+        this->delta_time = (float)data->dimensions.w / (float)this->integration_steps;
+    }
+
+    return true;
+}
+
+bool CpuIntegrator::integrate() {
+    if (!this->dataset) {
+        lava::log()->error("cpu integration: no dataset loaded");
+        return false;
+    }
+
+    this->open_log_file();
+
+    const std::size_t seed_count = std::size_t(this->seed_spawn.x) * this->seed_spawn.y * this->seed_spawn.z;
+    const std::size_t line_buffer_size = seed_count * (this->integration_steps + 1); // Increase integration steps by one for seeding position
+
+    lava::timer sw;
+    this->line_buffer.resize(line_buffer_size);
+    this->indirect_buffer.resize(seed_count);
+    lava::log()->debug("integration buffers created ({} ms, {} MB)", sw.elapsed().count(), static_cast<double>(line_buffer_size * sizeof(glm::vec4)) / 1024.0 / 1024.0);
+
+    if (this->bc6h_block_cache) {
+        this->bc6h_block_cache->reset_counters();
+    }
+
+    const std::vector<CpuIntegrationContext> contexts = this->create_contexts();
+    this->scheduler->reset_statistics();
+
+    lava::timer integration_timer;
+
+    if (this->blended_volumes || this->prefetcher) {
+        this->integrate_time_major(contexts);
+    } else {
+        const CpuKernelFunction kernel_function = get_cpu_kernel_function(this->kernel, this->get_specialization());
+        const std::size_t kernel_width = get_cpu_kernel_width(this->kernel);
+
+        // Chunks are a multiple of the kernel width, so that only the very last packet is partially filled
+        this->scheduler->run(seed_count, kernel_width, [&](std::size_t begin, std::size_t end) {
+            kernel_function(this->get_worker_context(contexts), begin, end - begin);
+        });
+    }
+
+    this->cpu_time = integration_timer.elapsed().count();
+
+    std::size_t step_count = 0;
+    for (const VkDrawIndirectCommand& indirect_command : this->indirect_buffer) {
+        step_count += indirect_command.vertexCount - 1;
+    }
+    this->steps_per_second = step_count / std::max(this->cpu_time / 1000.0, 1e-6);
+    lava::log()->info("cpu integration finished ({} ms, {} steps, {:.0f} steps/s)", this->cpu_time, step_count, this->steps_per_second);
+    this->update_thread_utilization();
+    this->log_block_cache();
+    if (this->prefetcher) {
+        lava::log()->info("cpu integration out of core: at most {:.1f} MB of the dataset resident ({:.1f} time slices)", static_cast<double>(this->prefetcher->get_peak_resident_size()) / 1024.0 / 1024.0, static_cast<double>(this->prefetcher->get_peak_resident_size()) / this->prefetcher->get_time_slice_size());
+    }
+
+    if (this->kernel_validation) {
+        this->validate_kernel(contexts.front());
+    }
+
+    const Bc6hBlockCache::Counters cache_counters = this->bc6h_block_cache ? this->bc6h_block_cache->get_counters() : Bc6hBlockCache::Counters();
+    const double peak_resident_size = this->prefetcher ? static_cast<double>(this->prefetcher->get_peak_resident_size()) / 1024.0 / 1024.0 : 0.0;
+    fmt::print(this->log_file, "{},{},{},{},{},{},{},{},{}\n", this->run, this->cpu_time, this->steps_per_second, this->mean_thread_utilization, this->min_thread_utilization, this->steal_count, cache_counters.get_hit_rate(), cache_counters.get_decode_time(), peak_resident_size);
+    this->log_file.flush();
+    this->run++;
+
+    return true;
+}
+
+bool CpuIntegrator::download_trajectories(const std::string& file_name) {
+    if (this->indirect_buffer.empty()) {
+        lava::log()->error("cpu integration: nothing to download, integrate first");
+        return false;
+    }
+
+    return write_trajectories(file_name, this->line_buffer, this->indirect_buffer);
+}
+
+// Advances all particles batch by batch, so that the integration only samples the dataset around the current time.
+// With time blending, the batches are advanced step by step, sampling the volumes blended at the stage times of each step.
+void CpuIntegrator::integrate_time_major(std::vector<CpuIntegrationContext> contexts) {
+    const bool blended = this->blended_volumes != nullptr;
+    const CpuBlendFunction blend_function = blended ? get_cpu_blend_function(this->get_specialization()) : nullptr;
+    const CpuStepFunction step_function = blended ? get_blended_cpu_step_function(this->get_specialization()) : get_cpu_step_function(this->get_specialization());
+    const std::size_t seed_count = this->indirect_buffer.size();
+    const std::size_t depth = contexts.front().dimensions[2];
+
+    // Every step costs about the same for all particles, so there is no need for small chunks
+    const std::size_t chunk_size = std::max<std::size_t>(seed_count / (this->thread_pool->get_thread_count() * 16), 1);
+
+    this->scheduler->run(seed_count, chunk_size, [&](std::size_t begin, std::size_t end) {
+        seed_cpu_particles(contexts.front(), begin, end - begin);
+    });
+
+    if (this->prefetcher) {
+        this->prefetcher->reset();
+    }
+
+    const std::size_t initial_blend_count = blended ? this->blended_volumes->get_blend_count() : 0;
+    const std::size_t initial_reuse_count = blended ? this->blended_volumes->get_reuse_count() : 0;
+    std::array<float, BLENDED_VOLUME_COUNT> stage_times;
+    double blend_time = 0.0;
+    bool finished = false;
+
+    for (unsigned first_step = 0; first_step < this->integration_steps && !finished; first_step += this->batch_size) {
+        const unsigned step_count = std::min(this->integration_steps - first_step, this->batch_size);
+        float t = first_step * this->delta_time;
+
+        // The last step samples the dataset up to its end time
+        if (this->prefetcher) {
+            this->prefetcher->advance(t, (first_step + step_count) * this->delta_time);
+        }
+
+        if (!blended) {
+            std::atomic<std::size_t> advanced_count = 0;
+            this->scheduler->run(seed_count, chunk_size, [&](std::size_t begin, std::size_t end) {
+                advanced_count += step_function(this->get_worker_context(contexts), begin, end - begin, first_step, step_count, t);
+            });
+
+            // Particles that left the dataset never come back, not even when the time is reset for the next batch
+            finished = advanced_count == 0;
+            continue;
+        }
+
+        for (unsigned s = 0; s < step_count && !finished; ++s) {
+            const unsigned stage_count = get_stage_times(this->integration_method, t, this->delta_time, stage_times);
+
+            const auto blend_start = std::chrono::steady_clock::now();
+            this->blended_volumes->prepare(stage_times, stage_count, [&](float time, float* volume) {
+                this->thread_pool->parallel_for(depth, 1, [&](std::size_t begin, std::size_t end) {
+                    blend_function(this->get_worker_context(contexts), time, volume, begin, end);
+                });
+            });
+            for (CpuIntegrationContext& context : contexts) {
+                this->blended_volumes->apply(context);
+            }
+            blend_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - blend_start).count();
+
+            std::atomic<std::size_t> advanced_count = 0;
+            this->scheduler->run(seed_count, chunk_size, [&](std::size_t begin, std::size_t end) {
+                advanced_count += step_function(this->get_worker_context(contexts), begin, end - begin, first_step + s, 1, t);
+            });
+
+            finished = advanced_count == 0;
+            t += this->delta_time;
+        }
+    }
+
+    if (blended) {
+        lava::log()->info("cpu integration time blending: {} volumes blended, {} reused ({:.0f} ms)", this->blended_volumes->get_blend_count() - initial_blend_count, this->blended_volumes->get_reuse_count() - initial_reuse_count, blend_time);
+    }
+}
+
+CpuKernelSpecialization CpuIntegrator::get_specialization() const {
+    return CpuKernelSpecialization{
+        .sampler = this->sampler,
+        .layout = this->layout,
+        .explicit_interpolation = this->explicit_interpolation,
+        .cubic_interpolation = this->cubic_interpolation,
+        .method = this->integration_method,
+    };
+}
+
+// One context per replica of the dataset, the analytic dataset has no slices at all
+std::vector<CpuIntegrationContext> CpuIntegrator::create_contexts() {
+    const glm::uvec4 dimensions = this->dataset->data->dimensions;
+    const std::optional<BrickLayout>& brick_layout = this->dataset->brick_layout;
+    std::vector<CpuIntegrationContext> contexts;
+
+    for (std::size_t replica = 0; replica < std::max<std::size_t>(this->slices.size(), 1); ++replica) {
+        contexts.push_back(CpuIntegrationContext{
+            .slices = replica < this->slices.size() ? this->slices[replica].data() : nullptr,
+            .z_slice_size = std::size_t(this->dataset->data->z_slice_size),
+            .brick_offsets = {
+                brick_layout.has_value() ? brick_layout->get_axis_offsets(0) : nullptr,
+                brick_layout.has_value() ? brick_layout->get_axis_offsets(1) : nullptr,
+                brick_layout.has_value() ? brick_layout->get_axis_offsets(2) : nullptr,
+            },
+            .bc6h_block_cache = this->bc6h_block_cache.get(),
+            .blended_volumes = {nullptr, nullptr, nullptr},
+            .blended_times = {0.0f, 0.0f, 0.0f},
+            .dimensions = {dimensions.x, dimensions.y, dimensions.z, dimensions.w},
+            .seed_spawn = {this->seed_spawn.x, this->seed_spawn.y, this->seed_spawn.z},
+            .integration_steps = this->integration_steps,
+            .batch_size = this->batch_size,
+            .delta_time = this->delta_time,
+            .explicit_interpolation = this->explicit_interpolation,
+            .line_buffer = reinterpret_cast<float*>(this->line_buffer.data()),
+            .indirect_buffer = this->indirect_buffer.data(),
+            .first_buffer_seed = 0,
+        });
+    }
+
+    return contexts;
+}
+
+const CpuIntegrationContext& CpuIntegrator::get_worker_context(const std::vector<CpuIntegrationContext>& contexts) const {
+    const std::optional<unsigned> worker = ThreadPool::get_worker_index();
+
+    // With replication, the replica of every node is the one at the index of the node
+    if (!worker.has_value() || contexts.size() == 1) {
+        return contexts.front();
+    }
+    return contexts[this->worker_nodes[worker.value()]];
+}
+
+// Integrates a few seeds again with the scalar kernel and compares them to the result of the selected kernel
+void CpuIntegrator::validate_kernel(const CpuIntegrationContext& context) {
+    const std::size_t seed_count = this->indirect_buffer.size();
+    const std::size_t validation_seed_count = std::min<std::size_t>(seed_count, 64);
+
+    std::vector<glm::vec4> validation_line_buffer(this->integration_steps + 1);
+    VkDrawIndirectCommand validation_indirect_command;
+    const CpuKernelFunction scalar_kernel_function = get_scalar_cpu_kernel_function(this->get_specialization());
+    CpuIntegrationContext validation_context = context;
+    validation_context.line_buffer = reinterpret_cast<float*>(validation_line_buffer.data());
+    validation_context.indirect_buffer = &validation_indirect_command;
+
+    const char* kernel_name = this->blended_volumes ? "time blended" : get_cpu_kernel_name(this->kernel);
+    float max_deviation = 0.0f;
+    std::size_t length_mismatches = 0;
+
+    for (std::size_t i = 0; i < validation_seed_count; ++i) {
+        const std::size_t seed_id = i * seed_count / validation_seed_count;
+        validation_context.first_buffer_seed = seed_id;
+        scalar_kernel_function(validation_context, seed_id, 1);
+
+        const VkDrawIndirectCommand& indirect_command = this->indirect_buffer[seed_id];
+        if (indirect_command.vertexCount != validation_indirect_command.vertexCount) {
+            length_mismatches++;
+        }
+
+        const std::size_t vertex_count = std::min(indirect_command.vertexCount, validation_indirect_command.vertexCount);
+        for (std::size_t v = 0; v < vertex_count; ++v) {
+            const glm::vec4 vertex = this->line_buffer[indirect_command.firstVertex + v];
+            const glm::vec4 reference = validation_line_buffer[v];
+            max_deviation = std::max(max_deviation, glm::distance(glm::vec3(vertex.x, vertex.y, vertex.z), glm::vec3(reference.x, reference.y, reference.z)));
+        }
+    }
+
+    if (max_deviation > CPU_KERNEL_TOLERANCE || length_mismatches > 0) {
+        lava::log()->warn("cpu kernel validation: {} kernel deviates from scalar kernel (max deviation {} voxels, {} of {} path lines differ in length)", kernel_name, max_deviation, length_mismatches, validation_seed_count);
+    } else {
+        lava::log()->info("cpu kernel validation: {} kernel matches scalar kernel (max deviation {} voxels)", kernel_name, max_deviation);
+    }
+}
+
+void CpuIntegrator::update_thread_utilization() {
+    const std::vector<WorkStealingScheduler::WorkerStatistics>& statistics = this->scheduler->get_statistics();
+
+    double max_utilization = 0.0;
+    std::size_t chunk_count = 0;
+    this->min_thread_utilization = 1.0;
+    this->mean_thread_utilization = 0.0;
+    this->steal_count = 0;
+
+    for (unsigned i = 0; i < statistics.size(); ++i) {
+        const double utilization = this->scheduler->get_utilization(i);
+        this->min_thread_utilization = std::min(this->min_thread_utilization, utilization);
+        this->mean_thread_utilization += utilization / statistics.size();
+        max_utilization = std::max(max_utilization, utilization);
+        chunk_count += statistics[i].chunk_count;
+        this->steal_count += statistics[i].steal_count;
+
+        lava::log()->debug("cpu integration thread {}: {:.1f}% utilization, {} seeds, {} chunks, {} steals", i, utilization * 100.0, statistics[i].item_count, statistics[i].chunk_count, statistics[i].steal_count);
+    }
+
+    lava::log()->info("cpu integration thread utilization {:.1f}% to {:.1f}% ({} chunks, {} steals)", this->min_thread_utilization * 100.0, max_utilization * 100.0, chunk_count, this->steal_count);
+}
+
+void CpuIntegrator::log_block_cache() {
+    if (!this->bc6h_block_cache) {
+        return;
+    }
+
+    const Bc6hBlockCache::Counters counters = this->bc6h_block_cache->get_counters();
+    lava::log()->info("bc6h block cache: {:.2f}% hit rate, {} blocks decoded, {:.0f} ns per block", counters.get_hit_rate() * 100.0, counters.miss_count, counters.get_decode_time());
+}
+
+void CpuIntegrator::open_log_file() {
+    if (this->log_file.is_open()) {
+        return;
+    }
+
+    const auto absolute_dataset_path = std::filesystem::absolute(this->dataset->data->filename);
+    const auto dataset_filename = absolute_dataset_path.filename().string();
+    std::time_t t = std::time(0); // get time now
+    std::tm* now = std::localtime(&t);
+
+    std::array<std::string_view, 7> weekdays = {
+        "Sunday",
+        "Monday",
+        "Tuesday",
+        "Wednesday",
+        "Thursday",
+        "Friday",
+        "Saturday",
+    };
+
+    const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-{}-{}-{}-{}-{}-{}-{}-({}-{}-{})-{}-{}-{}-{}-{}-cpu-integration.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, weekdays[now->tm_wday], now->tm_hour, now->tm_min, now->tm_sec, dataset_filename,
+        get_cpu_sampler_name(this->sampler),
+        get_cpu_layout_name(this->layout),
+        get_integration_method_name(this->integration_method),
+        get_cpu_kernel_name(this->kernel),
+        this->thread_pool->get_thread_count(),
+        this->seed_spawn.x, this->seed_spawn.y, this->seed_spawn.z,
+        this->integration_steps,
+        this->batch_size,
+        this->delta_time,
+        (this->explicit_interpolation) ? "Explicit" : "Implicit",
+        (this->cubic_interpolation) ? "Cubic" : "Linear"
+    );
+    this->log_file = std::ofstream(filename);
+    fmt::print(this->log_file, "run,integration_cpu,steps_per_second,mean_thread_utilization,min_thread_utilization,steal_count,bc6h_cache_hit_rate,bc6h_decode_ns,peak_resident_mb,dataset_path,dataset_dimensions,sampler,layout,brick_size,bc6h_cache_size,time_blending,out_of_core,numa_placement,numa_node_count,method,kernel,thread_count,seed_spawn,timestep,integration_steps,batch_size,explicit_interpolation,cubic_interpolation\n");
+    fmt::print(
+        this->log_file, ",,,,,,,,,{},{}x{}x{}x{},{},{},{},{},{},{},{},{},{},{},{},{}x{}x{},{},{},{},{},{}\n",
+        absolute_dataset_path.string(),
+        this->dataset->data->dimensions.x, this->dataset->data->dimensions.y, this->dataset->data->dimensions.z, this->dataset->data->dimensions.w,
+        get_cpu_sampler_name(this->sampler),
+        get_cpu_layout_name(this->layout),
+        this->layout == CpuLayout::Bricked ? this->brick_size : 0,
+        this->bc6h_block_cache ? this->bc6h_cache_size : 0,
+        this->blended_volumes != nullptr,
+        this->prefetcher != nullptr,
+        get_numa_placement_name(this->numa_placement),
+        this->numa_placement != NumaPlacement::Off ? this->numa_node_count : 1,
+        get_integration_method_name(this->integration_method),
+        get_cpu_kernel_name(this->kernel),
+        this->thread_pool->get_thread_count(),
+        this->seed_spawn.x, this->seed_spawn.y, this->seed_spawn.z,
+        this->delta_time,
+        this->integration_steps,
+        this->batch_size,
+        this->explicit_interpolation,
+        this->cubic_interpolation);
+}
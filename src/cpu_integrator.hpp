@@ -0,0 +1,99 @@
+#pragma once
+
+#include "bc6h_block_cache.hpp"
+#include "command_parser.hpp"
+#include "cpu_kernels.hpp"
+#include "host_dataset.hpp"
+#include "numa.hpp"
+#include "slice_prefetcher.hpp"
+#include "thread_pool.hpp"
+#include "time_blending.hpp"
+#include "work_stealing_scheduler.hpp"
+#include <fstream>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+// Integration of path lines on the CPU which does not require a Vulkan device.
+// It mirrors integration.glsl (same seeding, batching and bounds checks) and fills line and indirect buffers
+// with the same layout as the GPU integration, so that the results of both can be written and compared the same way.
+// The seeds are integrated by the scalar kernel of the dataset format and integration method (see cpu_sampling.hpp)
+// or, for Float32 datasets and RK4, by one of the vectorized kernels, see cpu_kernels.hpp.
+// Since seeds that leave the dataset are much cheaper than others, the seeds are distributed by a work stealing
+// scheduler and the utilization of every thread is reported after the integration. With time blending, all particles
+// are advanced step by step instead, see time_blending.hpp. Datasets that do not fit into memory can be mapped instead
+// of loaded (out of core), then all particles are advanced batch by batch while a SlicePrefetcher keeps the slices
+// around the current time resident.
+// On NUMA machines, the threads can be pinned to the nodes, which then either share an interleaved copy of the dataset
+// or sample their own replica.
+class CpuIntegrator {
+  public:
+    using Ptr = std::shared_ptr<CpuIntegrator>;
+
+    static Ptr make() { return std::make_shared<CpuIntegrator>(); }
+
+    bool create(const argh::parser& cmd_line);
+    bool set_dataset(DataSource::Ptr data);
+    bool integrate();
+    bool download_trajectories(const std::string& file_name);
+
+    std::optional<std::string> get_trajectory_file() const { return this->command_parser.get_trajectory_file(); }
+    uint32_t get_repetition_count() const { return this->command_parser.get_repetition_count().value_or(1); }
+
+  private:
+    CpuKernelSpecialization get_specialization() const;
+    std::vector<CpuIntegrationContext> create_contexts();
+    // Context with the replica of the dataset on the node of the calling worker
+    const CpuIntegrationContext& get_worker_context(const std::vector<CpuIntegrationContext>& contexts) const;
+    void integrate_time_major(std::vector<CpuIntegrationContext> contexts);
+    void validate_kernel(const CpuIntegrationContext& context);
+    void update_thread_utilization();
+    void log_block_cache();
+    void open_log_file();
+
+    HostDataset::Ptr dataset;
+    std::vector<std::vector<const void*>> slices; // Slices of every replica of the dataset
+    std::unique_ptr<Bc6hBlockCache> bc6h_block_cache;
+    std::unique_ptr<BlendedVolumes> blended_volumes; // Only with time blending
+    std::unique_ptr<SlicePrefetcher> prefetcher;     // Only for out-of-core integration
+    NumaTopology numa_topology;
+    std::vector<unsigned> worker_nodes; // NUMA node of every thread of the pool
+    std::unique_ptr<ThreadPool> thread_pool;
+    std::unique_ptr<WorkStealingScheduler> scheduler;
+    CpuSampler sampler = CpuSampler::Float32;
+    CpuLayout layout = CpuLayout::Planar;
+    CpuKernel preferred_kernel = CpuKernel::Scalar;
+    CpuKernel kernel = CpuKernel::Scalar;
+
+    std::vector<glm::vec4> line_buffer;
+    std::vector<VkDrawIndirectCommand> indirect_buffer;
+    double cpu_time = 0.0;
+    double steps_per_second = 0.0;
+    double mean_thread_utilization = 0.0;
+    double min_thread_utilization = 0.0;
+    std::size_t steal_count = 0;
+
+    std::ofstream log_file;
+    unsigned int run = 0;
+
+    // Integration settings
+    CommandParser command_parser;
+    glm::uvec3 seed_spawn = {20, 20, 20};
+    float delta_time = 0.1;
+    unsigned int integration_steps = 10000;
+    unsigned int batch_size = 100;
+    IntegrationMethod integration_method = IntegrationMethod::RungeKutta4;
+    bool explicit_interpolation = false;
+    bool cubic_interpolation = false;
+    bool analytic_dataset = false;
+    unsigned int brick_size = 0; // Planar layout if 0
+    unsigned int bc6h_cache_size = 64; // In MB, single texels are decoded if 0
+    TimeBlending time_blending = TimeBlending::Off;
+    bool out_of_core = false;
+    NumaPlacement numa_placement = NumaPlacement::Off;
+    unsigned int numa_node_count = 0; // All nodes if 0
+    bool kernel_validation = false;
+    unsigned int thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+};
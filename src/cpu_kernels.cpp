@@ -0,0 +1,197 @@
+#include "cpu_kernels.hpp"
+#include "cpu_sampling.hpp"
+#include <array>
+#include <type_traits>
+
+#if defined(CPU_KERNELS_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(CPU_KERNELS_X86)
+bool processor_supports(CpuKernel kernel) {
+#if defined(_MSC_VER)
+    std::array<int, 4> info;
+    __cpuid(info.data(), 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuid(info.data(), 1);
+    const bool os_saves_avx = (info[2] & (1 << 27)) != 0; // OSXSAVE
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!os_saves_avx) {
+        return false;
+    }
+    const unsigned long long xcr0 = _xgetbv(0);
+
+    __cpuidex(info.data(), 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    switch (kernel) {
+        case CpuKernel::AVX2:
+            return avx2 && fma && (xcr0 & 0x06) == 0x06;
+        case CpuKernel::AVX512:
+            return avx512f && (xcr0 & 0xe6) == 0xe6;
+        default:
+            return true;
+    }
+#else
+    switch (kernel) {
+        case CpuKernel::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case CpuKernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            return true;
+    }
+#endif
+}
+#endif
+
+} // namespace
+
+std::size_t get_cpu_kernel_width(CpuKernel kernel) {
+    switch (kernel) {
+        case CpuKernel::Scalar:
+            return 1;
+        case CpuKernel::AVX2:
+            return 8;
+        case CpuKernel::AVX512:
+            return 16;
+    }
+    return 1;
+}
+
+const char* get_cpu_kernel_name(CpuKernel kernel) {
+    switch (kernel) {
+        case CpuKernel::Scalar:
+            return "scalar";
+        case CpuKernel::AVX2:
+            return "avx2";
+        case CpuKernel::AVX512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+const char* get_cpu_sampler_name(CpuSampler sampler) {
+    switch (sampler) {
+        case CpuSampler::Float32:
+            return "float32";
+        case CpuSampler::Float16:
+            return "float16";
+        case CpuSampler::BC6H:
+            return "bc6h";
+        case CpuSampler::Analytic:
+            return "analytic";
+    }
+    return "unknown";
+}
+
+const char* get_cpu_layout_name(CpuLayout layout) {
+    switch (layout) {
+        case CpuLayout::Planar:
+            return "planar";
+        case CpuLayout::Bricked:
+            return "bricked";
+    }
+    return "unknown";
+}
+
+std::optional<CpuKernel> parse_cpu_kernel(std::string_view name) {
+    for (CpuKernel kernel : {CpuKernel::Scalar, CpuKernel::AVX2, CpuKernel::AVX512}) {
+        if (name == get_cpu_kernel_name(kernel)) {
+            return kernel;
+        }
+    }
+    return std::nullopt;
+}
+
+bool is_cpu_kernel_supported(CpuKernel kernel) {
+    if (kernel == CpuKernel::Scalar) {
+        return true;
+    }
+
+#if defined(CPU_KERNELS_X86)
+    return processor_supports(kernel);
+#else
+    return false;
+#endif
+}
+
+CpuKernel get_best_cpu_kernel() {
+    for (CpuKernel kernel : {CpuKernel::AVX512, CpuKernel::AVX2}) {
+        if (is_cpu_kernel_supported(kernel)) {
+            return kernel;
+        }
+    }
+    return CpuKernel::Scalar;
+}
+
+bool is_cpu_kernel_applicable(CpuKernel kernel, const CpuKernelSpecialization& specialization) {
+    return kernel == CpuKernel::Scalar || (specialization.sampler == CpuSampler::Float32 && specialization.layout == CpuLayout::Planar && !specialization.cubic_interpolation && specialization.method == IntegrationMethod::RungeKutta4);
+}
+
+CpuKernelFunction get_scalar_cpu_kernel_function(const CpuKernelSpecialization& specialization) {
+    return visit_cpu_sampler(specialization, [&]<typename Sampler>() {
+        return visit_integration_method(specialization.method, []<typename Method>() -> CpuKernelFunction {
+            return &integrate_seeds<Sampler, Method>;
+        });
+    });
+}
+
+CpuKernelFunction get_cpu_kernel_function(CpuKernel kernel, const CpuKernelSpecialization& specialization) {
+    if (!is_cpu_kernel_applicable(kernel, specialization)) {
+        return get_scalar_cpu_kernel_function(specialization);
+    }
+
+    switch (kernel) {
+#if defined(CPU_KERNELS_X86)
+        case CpuKernel::AVX2:
+            return &integrate_seeds_avx2;
+        case CpuKernel::AVX512:
+            return &integrate_seeds_avx512;
+#endif
+        default:
+            return get_scalar_cpu_kernel_function(specialization);
+    }
+}
+
+void seed_cpu_particles(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count) {
+    for (std::size_t seed_id = first_seed; seed_id < first_seed + seed_count; ++seed_id) {
+        seed_particle(context, seed_id);
+    }
+}
+
+CpuStepFunction get_cpu_step_function(const CpuKernelSpecialization& specialization) {
+    return visit_cpu_sampler(specialization, [&]<typename Sampler>() {
+        return visit_integration_method(specialization.method, []<typename Method>() -> CpuStepFunction {
+            return &advance_seeds<Sampler, Method>;
+        });
+    });
+}
+
+CpuBlendFunction get_cpu_blend_function(const CpuKernelSpecialization& specialization) {
+    return visit_cpu_sampler(specialization, []<typename Sampler>() -> CpuBlendFunction {
+        if constexpr (std::is_same_v<Sampler, AnalyticSampler>) {
+            return nullptr;
+        } else {
+            return &blend_time_slices<Sampler>;
+        }
+    });
+}
+
+CpuStepFunction get_blended_cpu_step_function(const CpuKernelSpecialization& specialization) {
+    if (specialization.sampler == CpuSampler::Analytic) {
+        return nullptr;
+    }
+
+    return visit_blended_sampler(specialization, [&]<typename Sampler>() {
+        return visit_integration_method(specialization.method, []<typename Method>() -> CpuStepFunction {
+            return &advance_seeds<Sampler, Method>;
+        });
+    });
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "integration_method.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vulkan/vulkan_core.h>
+
+class Bc6hBlockCache;
+
+// Stage times of a step of the integration methods: t, t + dt / 2 and t + dt
+constexpr unsigned BLENDED_VOLUME_COUNT = 3;
+
+// Everything a CPU integration kernel needs to integrate a range of seeds.
+// The vectorized kernels live in translation units that are compiled with AVX2/AVX-512 flags. The context therefore
+// only consists of plain data, so that no inline functions of shared types get instantiated in these translation units
+// and picked by the linker for the rest of the program, which has to run on processors without these extensions.
+struct CpuIntegrationContext {
+    // Indexed by channel * dimensions[3] + t. Float32 and Float16 slices use the planar layout with x fastest,
+    // BC6H slices (one channel) contain dimensions[2] slices of z_slice_size bytes with the blocks in row major order.
+    // Bricked slices (one channel) contain all 3 channels, see BrickLayout.
+    const void* const* slices;
+    std::size_t z_slice_size;
+    const std::size_t* brick_offsets[3]; // BrickLayout::get_axis_offsets() of the bricked layout
+    Bc6hBlockCache* bc6h_block_cache;    // Decoded blocks of BC6H slices, single texels are decoded if nullptr
+    // Volumes of 3 interleaved channels with x fastest, which contain the dataset blended between the time slices at
+    // the stage times of the current step, see TimeBlending. Only used by the blended step functions.
+    const float* blended_volumes[BLENDED_VOLUME_COUNT];
+    float blended_times[BLENDED_VOLUME_COUNT];
+    std::uint32_t dimensions[4];
+    std::uint32_t seed_spawn[3];
+    std::uint32_t integration_steps;
+    std::uint32_t batch_size;
+    float delta_time;
+    bool explicit_interpolation;
+
+    // The line buffer contains (integration_steps + 1) vertices of 4 floats per seed, starting with first_buffer_seed
+    float* line_buffer;
+    VkDrawIndirectCommand* indirect_buffer;
+    std::size_t first_buffer_seed;
+};
+
+// Dataset formats, see the sampler policies in cpu_sampling.hpp
+enum class CpuSampler {
+    Float32,
+    Float16,
+    BC6H,
+    Analytic,
+};
+
+// Memory layout of Float32 and Float16 datasets
+enum class CpuLayout {
+    Planar,
+    Bricked,
+};
+
+// Selects the instantiation of the scalar kernel, see cpu_sampling.hpp
+struct CpuKernelSpecialization {
+    CpuSampler sampler = CpuSampler::Float32;
+    CpuLayout layout = CpuLayout::Planar;
+    bool explicit_interpolation = false;
+    bool cubic_interpolation = false;
+    IntegrationMethod method = IntegrationMethod::RungeKutta4;
+};
+
+enum class CpuKernel {
+    Scalar,
+    AVX2,
+    AVX512,
+};
+
+using CpuKernelFunction = void (*)(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count);
+// Blends the z slices [z_begin, z_end) of the dataset at time t into volume, see blended_volumes
+using CpuBlendFunction = void (*)(const CpuIntegrationContext& context, float t, float* volume, std::size_t z_begin, std::size_t z_end);
+// Advances the seeds that are still inside the dataset by step_count steps starting at time t, returns the number of
+// seeds that have taken all of them
+using CpuStepFunction = std::size_t (*)(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count, unsigned first_step, unsigned step_count, float t);
+
+// All kernels produce the same trajectories as the scalar one: they perform the same floating point operations in the
+// same order (the vectorized ones are compiled without contraction into FMAs). The validation reports deviations larger
+// than this tolerance in voxels, e.g. when the compiler reorders operations.
+constexpr float CPU_KERNEL_TOLERANCE = 1e-4f;
+
+#if defined(CPU_KERNELS_X86)
+void integrate_seeds_avx2(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count);
+void integrate_seeds_avx512(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count);
+#endif
+
+// Number of particles a kernel advances at once
+std::size_t get_cpu_kernel_width(CpuKernel kernel);
+const char* get_cpu_kernel_name(CpuKernel kernel);
+const char* get_cpu_sampler_name(CpuSampler sampler);
+const char* get_cpu_layout_name(CpuLayout layout);
+std::optional<CpuKernel> parse_cpu_kernel(std::string_view name);
+
+// Checks whether the kernel has been built and the processor supports the required instruction set extensions
+bool is_cpu_kernel_supported(CpuKernel kernel);
+CpuKernel get_best_cpu_kernel();
+// The vectorized kernels only integrate planar Float32 datasets with RK4, everything else is handled by the scalar kernel
+bool is_cpu_kernel_applicable(CpuKernel kernel, const CpuKernelSpecialization& specialization);
+
+CpuKernelFunction get_scalar_cpu_kernel_function(const CpuKernelSpecialization& specialization);
+CpuKernelFunction get_cpu_kernel_function(CpuKernel kernel, const CpuKernelSpecialization& specialization);
+// Writes the seed positions as first vertices of the path lines, integrate_seeds() does this itself
+void seed_cpu_particles(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count);
+// Step functions advance all particles together, which is only supported by the scalar kernel
+CpuStepFunction get_cpu_step_function(const CpuKernelSpecialization& specialization);
+// Time blending is not supported for the analytic dataset, which has no time slices
+CpuBlendFunction get_cpu_blend_function(const CpuKernelSpecialization& specialization);
+CpuStepFunction get_blended_cpu_step_function(const CpuKernelSpecialization& specialization);
@@ -0,0 +1,48 @@
+#include "cpu_kernels_simd.hpp"
+
+namespace {
+
+struct Avx2 {
+    static constexpr std::size_t width = 8;
+    using Float = __m256;
+    using Int = __m256i;
+    using Mask = __m256;
+
+    static Float set(float value) { return _mm256_set1_ps(value); }
+    static Int set_int(int value) { return _mm256_set1_epi32(value); }
+    static Float load(const float* values) { return _mm256_load_ps(values); }
+    static void store(float* values, Float value) { _mm256_store_ps(values, value); }
+
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    static Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+    static Float floor(Float a) { return _mm256_floor_ps(a); }
+    static Float select(Mask mask, Float if_true, Float if_false) { return _mm256_blendv_ps(if_false, if_true, mask); }
+
+    static Int to_int(Float a) { return _mm256_cvttps_epi32(a); }
+    static Int add_int(Int a, Int b) { return _mm256_add_epi32(a, b); }
+    static Int mul_int(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+    static Int min_int(Int a, Int b) { return _mm256_min_epi32(a, b); }
+    static Int max_int(Int a, Int b) { return _mm256_max_epi32(a, b); }
+
+    static Mask less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask greater(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static Mask mask_or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static Mask mask_and_not(Mask a, Mask b) { return _mm256_andnot_ps(b, a); }
+    static unsigned bits(Mask mask) { return unsigned(_mm256_movemask_ps(mask)); }
+    static Mask first_lanes(std::size_t count) {
+        return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(int(count)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    }
+
+    static Float gather(const float* base, Int offsets, Mask mask) {
+        return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, offsets, mask, sizeof(float));
+    }
+};
+
+} // namespace
+
+void integrate_seeds_avx2(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count) {
+    integrate_seeds_packet<Avx2>(context, first_seed, seed_count);
+}
@@ -0,0 +1,46 @@
+#include "cpu_kernels_simd.hpp"
+
+namespace {
+
+struct Avx512 {
+    static constexpr std::size_t width = 16;
+    using Float = __m512;
+    using Int = __m512i;
+    using Mask = __mmask16;
+
+    static Float set(float value) { return _mm512_set1_ps(value); }
+    static Int set_int(int value) { return _mm512_set1_epi32(value); }
+    static Float load(const float* values) { return _mm512_load_ps(values); }
+    static void store(float* values, Float value) { _mm512_store_ps(values, value); }
+
+    static Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm512_div_ps(a, b); }
+    static Float sqrt(Float a) { return _mm512_sqrt_ps(a); }
+    static Float floor(Float a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    static Float select(Mask mask, Float if_true, Float if_false) { return _mm512_mask_blend_ps(mask, if_false, if_true); }
+
+    static Int to_int(Float a) { return _mm512_cvttps_epi32(a); }
+    static Int add_int(Int a, Int b) { return _mm512_add_epi32(a, b); }
+    static Int mul_int(Int a, Int b) { return _mm512_mullo_epi32(a, b); }
+    static Int min_int(Int a, Int b) { return _mm512_min_epi32(a, b); }
+    static Int max_int(Int a, Int b) { return _mm512_max_epi32(a, b); }
+
+    static Mask less(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static Mask greater(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static Mask mask_or(Mask a, Mask b) { return Mask(a | b); }
+    static Mask mask_and_not(Mask a, Mask b) { return Mask(a & ~b); }
+    static unsigned bits(Mask mask) { return unsigned(mask); }
+    static Mask first_lanes(std::size_t count) { return Mask((1u << count) - 1u); }
+
+    static Float gather(const float* base, Int offsets, Mask mask) {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, offsets, base, sizeof(float));
+    }
+};
+
+} // namespace
+
+void integrate_seeds_avx512(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count) {
+    integrate_seeds_packet<Avx512>(context, first_seed, seed_count);
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+// Packet kernel shared by the AVX2 and AVX-512 translation units.
+// A packet advances Simd::width particles at once, with positions and velocities kept in structure of arrays registers.
+// All particles of a packet share the same time, so the time slices are selected once and only the trilinear
+// interpolation is vectorized: texel offsets and filter weights are computed once per RK4 stage and used to gather the
+// 8 corners of all 3 channels of both time slices. Lanes whose particle left the dataset are masked off and skipped by
+// the gathers. The operations mirror integrate_seed() in cpu_kernels.cpp one by one, so that the results match.
+//
+// Only include this from translation units that are compiled for the respective extension. Everything in here has
+// internal linkage and avoids the standard library, see CpuIntegrationContext.
+
+#include "cpu_kernels.hpp"
+#include <immintrin.h>
+
+namespace {
+
+inline float floor_scalar(float value) {
+    return _mm_cvtss_f32(_mm_floor_ps(_mm_set_ss(value)));
+}
+
+inline float ceil_scalar(float value) {
+    return _mm_cvtss_f32(_mm_ceil_ps(_mm_set_ss(value)));
+}
+
+template <typename Simd>
+struct Vector {
+    typename Simd::Float x;
+    typename Simd::Float y;
+    typename Simd::Float z;
+};
+
+// Texel offsets of the 8 corners and filter weights of a trilinear interpolation, shared by all slices.
+template <typename Simd>
+struct TrilinearFootprint {
+    typename Simd::Int offsets[8];
+    typename Simd::Float weights[3];
+};
+
+template <typename Simd>
+TrilinearFootprint<Simd> compute_footprint(const CpuIntegrationContext& context, const Vector<Simd>& coordinates) {
+    using Float = typename Simd::Float;
+    using Int = typename Simd::Int;
+
+    const Float coordinate[3] = {coordinates.x, coordinates.y, coordinates.z};
+    Int lower[3];
+    Int upper[3];
+    TrilinearFootprint<Simd> footprint;
+
+    for (int i = 0; i < 3; ++i) {
+        const Float base_coordinate = Simd::floor(coordinate[i]);
+        Float filter_weight = Simd::sub(coordinate[i], base_coordinate);
+
+        if (!context.explicit_interpolation) {
+            filter_weight = Simd::div(Simd::floor(Simd::add(Simd::mul(filter_weight, Simd::set(256.0f)), Simd::set(0.5f))), Simd::set(256.0f));
+        }
+
+        const Int last = Simd::set_int(int(context.dimensions[i]) - 1);
+        lower[i] = Simd::min_int(Simd::max_int(Simd::to_int(base_coordinate), Simd::set_int(0)), last);
+        upper[i] = Simd::min_int(Simd::add_int(lower[i], Simd::set_int(1)), last);
+        footprint.weights[i] = filter_weight;
+    }
+
+    const Int row_size = Simd::set_int(int(context.dimensions[0]));
+    const Int slab_size = Simd::set_int(int(context.dimensions[0] * context.dimensions[1]));
+    const Int rows[2] = {Simd::mul_int(lower[1], row_size), Simd::mul_int(upper[1], row_size)};
+    const Int slabs[2] = {Simd::mul_int(lower[2], slab_size), Simd::mul_int(upper[2], slab_size)};
+
+    for (int corner = 0; corner < 8; ++corner) {
+        const Int x = (corner & 1) ? upper[0] : lower[0];
+        footprint.offsets[corner] = Simd::add_int(x, Simd::add_int(rows[(corner >> 1) & 1], slabs[(corner >> 2) & 1]));
+    }
+
+    return footprint;
+}
+
+template <typename Simd>
+typename Simd::Float mix(typename Simd::Float x, typename Simd::Float y, typename Simd::Float a) {
+    return Simd::add(Simd::mul(x, Simd::sub(Simd::set(1.0f), a)), Simd::mul(y, a));
+}
+
+template <typename Simd>
+typename Simd::Float sample_slice(const float* slice, const TrilinearFootprint<Simd>& footprint, typename Simd::Mask active) {
+    using Float = typename Simd::Float;
+
+    Float corners[8];
+    for (int corner = 0; corner < 8; ++corner) {
+        corners[corner] = Simd::gather(slice, footprint.offsets[corner], active);
+    }
+
+    const Float sample_w00 = mix<Simd>(corners[0], corners[1], footprint.weights[0]);
+    const Float sample_w10 = mix<Simd>(corners[2], corners[3], footprint.weights[0]);
+    const Float sample_ww0 = mix<Simd>(sample_w00, sample_w10, footprint.weights[1]);
+
+    const Float sample_w01 = mix<Simd>(corners[4], corners[5], footprint.weights[0]);
+    const Float sample_w11 = mix<Simd>(corners[6], corners[7], footprint.weights[0]);
+    const Float sample_ww1 = mix<Simd>(sample_w01, sample_w11, footprint.weights[1]);
+
+    return mix<Simd>(sample_ww0, sample_ww1, footprint.weights[2]);
+}
+
+template <typename Simd>
+Vector<Simd> sample_dataset(const CpuIntegrationContext& context, const Vector<Simd>& coordinates, float t, typename Simd::Mask active) {
+    using Float = typename Simd::Float;
+
+    const float last_time_slice = (float)context.dimensions[3] - 1.0f;
+    const float sampler_index = t < last_time_slice ? t : last_time_slice;
+    const unsigned sampler_index_floored = unsigned(floor_scalar(sampler_index));
+    const unsigned sampler_index_ceiled = unsigned(ceil_scalar(sampler_index));
+    const float time_weight = t - floor_scalar(t);
+
+    const TrilinearFootprint<Simd> footprint = compute_footprint<Simd>(context, coordinates);
+    const Float weight0 = Simd::set(1.0f - time_weight);
+    const Float weight1 = Simd::set(time_weight);
+
+    Float velocity[3];
+    for (unsigned c = 0; c < 3; ++c) {
+        const Float sample_www0 = sample_slice<Simd>(static_cast<const float*>(context.slices[c * context.dimensions[3] + sampler_index_floored]), footprint, active);
+        const Float sample_www1 = sample_slice<Simd>(static_cast<const float*>(context.slices[c * context.dimensions[3] + sampler_index_ceiled]), footprint, active);
+        velocity[c] = Simd::add(Simd::mul(sample_www0, weight0), Simd::mul(sample_www1, weight1));
+    }
+
+    return {velocity[0], velocity[1], velocity[2]};
+}
+
+// Computes coordinates + v * scale * dt component-wise in the same order as the scalar kernel
+template <typename Simd>
+Vector<Simd> offset(const Vector<Simd>& coordinates, const Vector<Simd>& v, typename Simd::Float scale, typename Simd::Float dt) {
+    return {
+        Simd::add(coordinates.x, Simd::mul(Simd::mul(v.x, scale), dt)),
+        Simd::add(coordinates.y, Simd::mul(Simd::mul(v.y, scale), dt)),
+        Simd::add(coordinates.z, Simd::mul(Simd::mul(v.z, scale), dt)),
+    };
+}
+
+// Runge Kutta 4th Order Method
+template <typename Simd>
+Vector<Simd> rungekutta4(const CpuIntegrationContext& context, const Vector<Simd>& coordinates, float t, typename Simd::Mask active) {
+    using Float = typename Simd::Float;
+
+    const float dt = context.delta_time;
+    const Float dt_vector = Simd::set(dt);
+    const Float half = Simd::set(0.5f);
+    const Float one = Simd::set(1.0f);
+    const Float two = Simd::set(2.0f);
+
+    const Vector<Simd> v1 = sample_dataset<Simd>(context, coordinates, t, active);
+    const Vector<Simd> v2 = sample_dataset<Simd>(context, offset<Simd>(coordinates, v1, half, dt_vector), t + 0.5f * dt, active);
+    const Vector<Simd> v3 = sample_dataset<Simd>(context, offset<Simd>(coordinates, v2, half, dt_vector), t + 0.5f * dt, active);
+    // v3 * dt equals v3 * 1.0 * dt
+    const Vector<Simd> v4 = sample_dataset<Simd>(context, offset<Simd>(coordinates, v3, one, dt_vector), t + dt, active);
+
+    const Float six = Simd::set(6.0f);
+    return {
+        Simd::div(Simd::add(Simd::add(Simd::add(v1.x, Simd::mul(two, v2.x)), Simd::mul(two, v3.x)), v4.x), six),
+        Simd::div(Simd::add(Simd::add(Simd::add(v1.y, Simd::mul(two, v2.y)), Simd::mul(two, v3.y)), v4.y), six),
+        Simd::div(Simd::add(Simd::add(Simd::add(v1.z, Simd::mul(two, v2.z)), Simd::mul(two, v3.z)), v4.z), six),
+    };
+}
+
+template <typename Simd>
+void integrate_packet(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t lane_count) {
+    using Float = typename Simd::Float;
+    using Mask = typename Simd::Mask;
+    constexpr std::size_t width = Simd::width;
+
+    alignas(64) float position_x[width] = {};
+    alignas(64) float position_y[width] = {};
+    alignas(64) float position_z[width] = {};
+    alignas(64) float velocity_magnitude[width];
+    float* lines[width] = {};
+    VkDrawIndirectCommand* indirect_commands[width] = {};
+
+    // Seeding, see seeding.comp
+    for (std::size_t lane = 0; lane < lane_count; ++lane) {
+        const std::size_t seed_id = first_seed + lane;
+        const std::size_t seed_index[3] = {
+            seed_id % context.seed_spawn[0],
+            (seed_id / context.seed_spawn[0]) % context.seed_spawn[1],
+            seed_id / (context.seed_spawn[0] * context.seed_spawn[1]),
+        };
+        const std::size_t line_buffer_offset = (seed_id - context.first_buffer_seed) * (context.integration_steps + 1);
+
+        position_x[lane] = (float)context.dimensions[0] * ((float)seed_index[0] / (float)context.seed_spawn[0]);
+        position_y[lane] = (float)context.dimensions[1] * ((float)seed_index[1] / (float)context.seed_spawn[1]);
+        position_z[lane] = (float)context.dimensions[2] * ((float)seed_index[2] / (float)context.seed_spawn[2]);
+
+        lines[lane] = context.line_buffer + line_buffer_offset * 4;
+        lines[lane][0] = position_x[lane];
+        lines[lane][1] = position_y[lane];
+        lines[lane][2] = position_z[lane];
+        lines[lane][3] = 0.0f;
+
+        indirect_commands[lane] = context.indirect_buffer + (seed_id - context.first_buffer_seed);
+        indirect_commands[lane]->vertexCount = 1;
+        indirect_commands[lane]->instanceCount = 1;
+        indirect_commands[lane]->firstVertex = line_buffer_offset;
+        indirect_commands[lane]->firstInstance = 0;
+    }
+
+    Vector<Simd> position = {Simd::load(position_x), Simd::load(position_y), Simd::load(position_z)};
+    Mask alive = Simd::first_lanes(lane_count);
+
+    const Float zero = Simd::set(0.0f);
+    const Float last_x = Simd::set((float)context.dimensions[0] - 1.0f);
+    const Float last_y = Simd::set((float)context.dimensions[1] - 1.0f);
+    const Float last_z = Simd::set((float)context.dimensions[2] - 1.0f);
+    const float last_t = (float)context.dimensions[3] - 1.0f;
+    const Float dt = Simd::set(context.delta_time);
+
+    for (unsigned first_step = 0; first_step < context.integration_steps; first_step += context.batch_size) {
+        const unsigned remaining_steps = context.integration_steps - first_step;
+        const unsigned step_count = remaining_steps < context.batch_size ? remaining_steps : context.batch_size;
+        float t = first_step * context.delta_time;
+
+        for (unsigned s = 0; s < step_count; ++s) {
+            if (t < 0.0f || t > last_t) {
+                return;
+            }
+
+            const Mask outside = Simd::mask_or(
+                Simd::mask_or(Simd::mask_or(Simd::less(position.x, zero), Simd::greater(position.x, last_x)), Simd::mask_or(Simd::less(position.y, zero), Simd::greater(position.y, last_y))),
+                Simd::mask_or(Simd::less(position.z, zero), Simd::greater(position.z, last_z))
+            );
+            alive = Simd::mask_and_not(alive, outside);
+
+            const unsigned alive_lanes = Simd::bits(alive);
+            if (alive_lanes == 0) {
+                return;
+            }
+
+            const Vector<Simd> velocity = rungekutta4<Simd>(context, position, t, alive);
+            const Float magnitude = Simd::sqrt(Simd::add(Simd::add(Simd::mul(velocity.x, velocity.x), Simd::mul(velocity.y, velocity.y)), Simd::mul(velocity.z, velocity.z)));
+
+            position.x = Simd::select(alive, Simd::add(position.x, Simd::mul(dt, velocity.x)), position.x);
+            position.y = Simd::select(alive, Simd::add(position.y, Simd::mul(dt, velocity.y)), position.y);
+            position.z = Simd::select(alive, Simd::add(position.z, Simd::mul(dt, velocity.z)), position.z);
+
+            Simd::store(position_x, position.x);
+            Simd::store(position_y, position.y);
+            Simd::store(position_z, position.z);
+            Simd::store(velocity_magnitude, magnitude);
+
+            for (std::size_t lane = 0; lane < width; ++lane) {
+                if ((alive_lanes >> lane) & 1u) {
+                    float* vertex = lines[lane] + std::size_t(first_step + s + 1) * 4;
+                    vertex[0] = position_x[lane];
+                    vertex[1] = position_y[lane];
+                    vertex[2] = position_z[lane];
+                    vertex[3] = velocity_magnitude[lane];
+                    indirect_commands[lane]->vertexCount++;
+                }
+            }
+
+            t += context.delta_time;
+        }
+    }
+}
+
+template <typename Simd>
+void integrate_seeds_packet(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count) {
+    for (std::size_t packet = 0; packet < seed_count; packet += Simd::width) {
+        const std::size_t remaining_seeds = seed_count - packet;
+        integrate_packet<Simd>(context, first_seed + packet, remaining_seeds < Simd::width ? remaining_seeds : Simd::width);
+    }
+}
+
+} // namespace
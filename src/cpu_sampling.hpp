@@ -0,0 +1,695 @@
+#pragma once
+
+#include "bc6h.hpp"
+#include "bc6h_block_cache.hpp"
+#include "cpu_kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define CPU_SAMPLING_F16C
+#endif
+
+// Sampler policies and integration methods of the scalar CPU kernels.
+// integration.glsl selects the dataset format with the DATA_* defines and the interpolation with the
+// EXPLICIT_INTERPOLATION specialization constant. Here every combination of sampler, memory layout, interpolation mode
+// and integration method is a separate instantiation of integrate_seeds(), so that the inner loop contains no virtual
+// calls and no branches on these settings. The instantiations are selected by get_scalar_cpu_kernel_function().
+
+// Filter weights of the trilinear interpolation.
+// Hardware filtering (implicit interpolation) only has 8 bits of subtexel precision, which is emulated by
+// quantizing the weights, so that CPU results are comparable to both GPU interpolation modes.
+template <bool ExplicitInterpolation>
+glm::vec3 get_filter_weight(const glm::vec3& coordinates, const glm::vec3& base_coordinate) {
+    const glm::vec3 filter_weight = coordinates - base_coordinate;
+
+    if constexpr (ExplicitInterpolation) {
+        return filter_weight;
+    } else {
+        return glm::floor(filter_weight * 256.0f + 0.5f) / 256.0f;
+    }
+}
+
+// Catmull-Rom weights of the four voxels around the coordinates along every axis, the first at floor(coordinates) - 1,
+// see get_catmull_rom_weights() in integration.glsl
+inline std::array<glm::vec3, 4> get_catmull_rom_weights(const glm::vec3& filter_weight) {
+    const glm::vec3& f = filter_weight;
+
+    return {
+        f * (-0.5f + f * (1.0f - 0.5f * f)),
+        1.0f + f * f * (-2.5f + 1.5f * f),
+        f * (0.5f + f * (2.0f - 1.5f * f)),
+        f * f * (-0.5f + 0.5f * f),
+    };
+}
+
+// Time slices enclosing a time, see sample_dataset() in integration.glsl
+struct TimeSlices {
+    unsigned floored;
+    unsigned ceiled;
+    float weight;
+};
+
+inline TimeSlices select_time_slices(const CpuIntegrationContext& context, float t) {
+    const float sampler_index = std::min(t, (float)context.dimensions[3] - 1.0f);
+    return TimeSlices{unsigned(std::floor(sampler_index)), unsigned(std::ceil(sampler_index)), glm::fract(t)};
+}
+
+inline float half_to_float(std::uint16_t value) {
+#if defined(CPU_SAMPLING_F16C)
+    return _cvtsh_ss(value);
+#else
+    return glm::unpackHalf1x16(value);
+#endif
+}
+
+struct Float32Texels {
+    using Texel = float;
+    static float load(Texel texel) { return texel; }
+};
+
+// Converted with F16C if the build targets processors supporting it (e.g. -march=native or /arch:AVX2)
+struct Float16Texels {
+    using Texel = std::uint16_t;
+    static float load(Texel texel) { return half_to_float(texel); }
+};
+
+// Float32 and Float16 datasets with one 3D texture per channel and time slice, see DATA_RAW_TEXTURES.
+// Texel coordinates are clamped to the border like the CLAMP_TO_EDGE sampler of the dataset images instead of being
+// fetched out of bounds.
+template <typename Texels, bool ExplicitInterpolation>
+class PlanarSampler {
+  public:
+    explicit PlanarSampler(const CpuIntegrationContext& context) : context(context) {}
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const TimeSlices time_slices = select_time_slices(this->context, coordinates.w);
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z);
+
+        glm::vec3 sample_www0;
+        glm::vec3 sample_www1;
+        for (unsigned c = 0; c < 3; ++c) {
+            sample_www0[c] = this->sample_slice(this->get_slice(c, time_slices.floored), position);
+            sample_www1[c] = this->sample_slice(this->get_slice(c, time_slices.ceiled), position);
+        }
+
+        return glm::mix(sample_www0, sample_www1, time_slices.weight);
+    }
+
+    // Voxel blended between the time slices, equals sample_dataset() at the voxel coordinates
+    glm::vec3 sample_voxel(const TimeSlices& time_slices, unsigned x, unsigned y, unsigned z) const {
+        const std::size_t offset = x + this->context.dimensions[0] * (y + std::size_t(this->context.dimensions[1]) * z);
+
+        glm::vec3 voxel_www0;
+        glm::vec3 voxel_www1;
+        for (unsigned c = 0; c < 3; ++c) {
+            voxel_www0[c] = Texels::load(this->get_slice(c, time_slices.floored)[offset]);
+            voxel_www1[c] = Texels::load(this->get_slice(c, time_slices.ceiled)[offset]);
+        }
+
+        return glm::mix(voxel_www0, voxel_www1, time_slices.weight);
+    }
+
+  private:
+    using Texel = typename Texels::Texel;
+
+    const Texel* get_slice(unsigned channel, unsigned t) const {
+        return static_cast<const Texel*>(this->context.slices[channel * this->context.dimensions[3] + t]);
+    }
+
+    float sample_slice(const Texel* slice, const glm::vec3& coordinates) const {
+        const int width = this->context.dimensions[0];
+        const int height = this->context.dimensions[1];
+        const int depth = this->context.dimensions[2];
+
+        const glm::vec3 base_coordinate = glm::floor(coordinates);
+        const glm::vec3 filter_weight = get_filter_weight<ExplicitInterpolation>(coordinates, base_coordinate);
+
+        const int x0 = std::clamp(int(base_coordinate.x), 0, width - 1);
+        const int y0 = std::clamp(int(base_coordinate.y), 0, height - 1);
+        const int z0 = std::clamp(int(base_coordinate.z), 0, depth - 1);
+        const int x1 = std::min(x0 + 1, width - 1);
+        const int y1 = std::min(y0 + 1, height - 1);
+        const int z1 = std::min(z0 + 1, depth - 1);
+
+        const auto fetch = [&](int x, int y, int z) {
+            return Texels::load(slice[x + width * (y + std::size_t(height) * z)]);
+        };
+
+        const float sample_w00 = glm::mix(fetch(x0, y0, z0), fetch(x1, y0, z0), filter_weight.x);
+        const float sample_w10 = glm::mix(fetch(x0, y1, z0), fetch(x1, y1, z0), filter_weight.x);
+        const float sample_ww0 = glm::mix(sample_w00, sample_w10, filter_weight.y);
+
+        const float sample_w01 = glm::mix(fetch(x0, y0, z1), fetch(x1, y0, z1), filter_weight.x);
+        const float sample_w11 = glm::mix(fetch(x0, y1, z1), fetch(x1, y1, z1), filter_weight.x);
+        const float sample_ww1 = glm::mix(sample_w01, sample_w11, filter_weight.y);
+
+        return glm::mix(sample_ww0, sample_ww1, filter_weight.z);
+    }
+
+    const CpuIntegrationContext& context;
+};
+
+// Float32 and Float16 datasets in the bricked layout, where the 3 channels of a voxel are stored next to each other.
+// Performs exactly the same operations as the PlanarSampler, only the addressing differs.
+template <typename Texels, bool ExplicitInterpolation>
+class BrickedSampler {
+  public:
+    explicit BrickedSampler(const CpuIntegrationContext& context) : context(context) {}
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const TimeSlices time_slices = select_time_slices(this->context, coordinates.w);
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z);
+
+        const glm::vec3 sample_www0 = this->sample_slice(this->get_slice(time_slices.floored), position);
+        const glm::vec3 sample_www1 = this->sample_slice(this->get_slice(time_slices.ceiled), position);
+
+        return glm::mix(sample_www0, sample_www1, time_slices.weight);
+    }
+
+    // Voxel blended between the time slices, equals sample_dataset() at the voxel coordinates
+    glm::vec3 sample_voxel(const TimeSlices& time_slices, unsigned x, unsigned y, unsigned z) const {
+        const std::size_t offset = this->context.brick_offsets[0][x] + this->context.brick_offsets[1][y] + this->context.brick_offsets[2][z];
+        return glm::mix(this->fetch(this->get_slice(time_slices.floored), offset), this->fetch(this->get_slice(time_slices.ceiled), offset), time_slices.weight);
+    }
+
+  private:
+    using Texel = typename Texels::Texel;
+
+    const Texel* get_slice(unsigned t) const {
+        return static_cast<const Texel*>(this->context.slices[t]);
+    }
+
+    static glm::vec3 fetch(const Texel* slice, std::size_t offset) {
+        const Texel* texel = slice + 3 * offset;
+        return glm::vec3(Texels::load(texel[0]), Texels::load(texel[1]), Texels::load(texel[2]));
+    }
+
+    glm::vec3 sample_slice(const Texel* slice, const glm::vec3& coordinates) const {
+        const int width = this->context.dimensions[0];
+        const int height = this->context.dimensions[1];
+        const int depth = this->context.dimensions[2];
+
+        const glm::vec3 base_coordinate = glm::floor(coordinates);
+        const glm::vec3 filter_weight = get_filter_weight<ExplicitInterpolation>(coordinates, base_coordinate);
+
+        const int x0 = std::clamp(int(base_coordinate.x), 0, width - 1);
+        const int y0 = std::clamp(int(base_coordinate.y), 0, height - 1);
+        const int z0 = std::clamp(int(base_coordinate.z), 0, depth - 1);
+        const int x1 = std::min(x0 + 1, width - 1);
+        const int y1 = std::min(y0 + 1, height - 1);
+        const int z1 = std::min(z0 + 1, depth - 1);
+
+        const std::size_t* const* offsets = this->context.brick_offsets;
+        const std::size_t offset_x0 = offsets[0][x0];
+        const std::size_t offset_x1 = offsets[0][x1];
+        const std::size_t offset_y0 = offsets[1][y0];
+        const std::size_t offset_y1 = offsets[1][y1];
+        const std::size_t offset_z0 = offsets[2][z0];
+        const std::size_t offset_z1 = offsets[2][z1];
+
+        const auto fetch = [&](std::size_t offset) {
+            return BrickedSampler::fetch(slice, offset);
+        };
+
+        const glm::vec3 sample_w00 = glm::mix(fetch(offset_x0 + offset_y0 + offset_z0), fetch(offset_x1 + offset_y0 + offset_z0), filter_weight.x);
+        const glm::vec3 sample_w10 = glm::mix(fetch(offset_x0 + offset_y1 + offset_z0), fetch(offset_x1 + offset_y1 + offset_z0), filter_weight.x);
+        const glm::vec3 sample_ww0 = glm::mix(sample_w00, sample_w10, filter_weight.y);
+
+        const glm::vec3 sample_w01 = glm::mix(fetch(offset_x0 + offset_y0 + offset_z1), fetch(offset_x1 + offset_y0 + offset_z1), filter_weight.x);
+        const glm::vec3 sample_w11 = glm::mix(fetch(offset_x0 + offset_y1 + offset_z1), fetch(offset_x1 + offset_y1 + offset_z1), filter_weight.x);
+        const glm::vec3 sample_ww1 = glm::mix(sample_w01, sample_w11, filter_weight.y);
+
+        return glm::mix(sample_ww0, sample_ww1, filter_weight.z);
+    }
+
+    const CpuIntegrationContext& context;
+};
+
+// BC6H datasets with one 2D array texture per time slice, whose layers are the z slices, see DATA_BC6H_TEXTURE.
+// Texels are decoded when they are fetched, either one at a time or, if the context has a block cache, a whole block
+// at a time, which the neighbouring fetches of the interpolation and of other particles reuse. Like the texture unit,
+// implicit interpolation only filters within a layer and the layers are blended with full precision.
+template <bool ExplicitInterpolation>
+class Bc6hSampler {
+  public:
+    explicit Bc6hSampler(const CpuIntegrationContext& context) : context(context) {}
+    ~Bc6hSampler() {
+        if (this->context.bc6h_block_cache != nullptr) {
+            this->context.bc6h_block_cache->add_counters(this->cache_counters);
+        }
+    }
+
+    Bc6hSampler(const Bc6hSampler&) = delete;
+    Bc6hSampler& operator=(const Bc6hSampler&) = delete;
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const TimeSlices time_slices = select_time_slices(this->context, coordinates.w);
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z);
+
+        const glm::vec3 sample_www0 = this->sample_slice(time_slices.floored, position);
+        const glm::vec3 sample_www1 = this->sample_slice(time_slices.ceiled, position);
+
+        return glm::mix(sample_www0, sample_www1, time_slices.weight);
+    }
+
+    // Voxel blended between the time slices, equals sample_dataset() at the voxel coordinates
+    glm::vec3 sample_voxel(const TimeSlices& time_slices, unsigned x, unsigned y, unsigned z) const {
+        return glm::mix(this->fetch(time_slices.floored, x, y, z), this->fetch(time_slices.ceiled, x, y, z), time_slices.weight);
+    }
+
+  private:
+    glm::vec3 fetch(unsigned t, int x, int y, int z) const {
+        const std::size_t blocks_x = (this->context.dimensions[0] + BC6H_BLOCK_DIMENSION - 1) / BC6H_BLOCK_DIMENSION;
+        const std::size_t block_index = (y / BC6H_BLOCK_DIMENSION) * blocks_x + x / BC6H_BLOCK_DIMENSION;
+        const std::uint8_t* block = static_cast<const std::uint8_t*>(this->context.slices[t]) + z * this->context.z_slice_size + block_index * BC6H_BLOCK_SIZE;
+        const unsigned texel = (x % BC6H_BLOCK_DIMENSION) + (y % BC6H_BLOCK_DIMENSION) * BC6H_BLOCK_DIMENSION;
+
+        if (this->context.bc6h_block_cache != nullptr) {
+            const std::uint64_t key = Bc6hBlockCache::make_key(t, z, block_index, this->context.dimensions[2], this->context.z_slice_size / BC6H_BLOCK_SIZE);
+            return this->context.bc6h_block_cache->fetch_texel(key, block, texel, this->cache_counters);
+        }
+        return decode_bc6h_texel(block, texel);
+    }
+
+    glm::vec3 sample_slice(unsigned t, const glm::vec3& coordinates) const {
+        const int width = this->context.dimensions[0];
+        const int height = this->context.dimensions[1];
+        const int depth = this->context.dimensions[2];
+
+        const glm::vec3 base_coordinate = glm::floor(coordinates);
+        glm::vec3 filter_weight = get_filter_weight<ExplicitInterpolation>(coordinates, base_coordinate);
+        if constexpr (!ExplicitInterpolation) {
+            filter_weight.z = glm::fract(coordinates.z);
+        }
+
+        const int x0 = std::clamp(int(base_coordinate.x), 0, width - 1);
+        const int y0 = std::clamp(int(base_coordinate.y), 0, height - 1);
+        const int z0 = std::clamp(int(base_coordinate.z), 0, depth - 1);
+        const int x1 = std::min(x0 + 1, width - 1);
+        const int y1 = std::min(y0 + 1, height - 1);
+        const int z1 = std::min(z0 + 1, depth - 1);
+
+        const glm::vec3 sample_w00 = glm::mix(this->fetch(t, x0, y0, z0), this->fetch(t, x1, y0, z0), filter_weight.x);
+        const glm::vec3 sample_w10 = glm::mix(this->fetch(t, x0, y1, z0), this->fetch(t, x1, y1, z0), filter_weight.x);
+        const glm::vec3 sample_ww0 = glm::mix(sample_w00, sample_w10, filter_weight.y);
+
+        const glm::vec3 sample_w01 = glm::mix(this->fetch(t, x0, y0, z1), this->fetch(t, x1, y0, z1), filter_weight.x);
+        const glm::vec3 sample_w11 = glm::mix(this->fetch(t, x0, y1, z1), this->fetch(t, x1, y1, z1), filter_weight.x);
+        const glm::vec3 sample_ww1 = glm::mix(sample_w01, sample_w11, filter_weight.y);
+
+        return glm::mix(sample_ww0, sample_ww1, filter_weight.z);
+    }
+
+    const CpuIntegrationContext& context;
+    mutable Bc6hBlockCache::Counters cache_counters; // Added to the cache when the sampler is destroyed
+};
+
+// Analytic ABC flow, see analytic_vector_field.glsl
+class AnalyticSampler {
+  public:
+    explicit AnalyticSampler(const CpuIntegrationContext&) {}
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const float pi = 3.14159265359f;
+        const float a_param = std::sqrt(3.0f);
+        const float b_param = std::sqrt(2.0f);
+        const float c_param = 1.0f;
+
+        const float t = coordinates.w;
+        const float c_pos = 0.05f;
+        const float c_t1 = 0.05f;
+        const float c_t2 = 0.01f;
+        const float a_coeff = a_param + c_t1 * t * std::sin(pi * t * c_t2);
+
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z) - glm::vec3(100.0f, 0.0f, 100.0f);
+
+        return glm::vec3(a_coeff * std::sin(position.z * c_pos) + b_param * std::cos(position.y * c_pos),
+                         b_param * std::sin(position.x * c_pos) + c_param * std::cos(position.z * c_pos),
+                         c_param * std::sin(position.y * c_pos) + a_coeff * std::cos(position.x * c_pos));
+    }
+};
+
+// Catmull-Rom interpolation of the voxels of another sampler, see CUBIC_INTERPOLATION in integration.glsl.
+// The 64 voxels are weighted with full precision like the explicit interpolation on the GPU. The implicit interpolation
+// on the GPU combines the inner voxels into linearly filtered taps, whose positions are quantized by the texture unit,
+// which is not emulated here.
+template <typename Sampler>
+class CatmullRomSampler {
+  public:
+    explicit CatmullRomSampler(const CpuIntegrationContext& context) : context(context), sampler(context) {}
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const TimeSlices time_slices = select_time_slices(this->context, coordinates.w);
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z);
+        const glm::vec3 base_coordinate = glm::floor(position);
+        const std::array<glm::vec3, 4> weights = get_catmull_rom_weights(position - base_coordinate);
+
+        const glm::ivec3 first_coordinate = glm::ivec3(base_coordinate) - glm::ivec3(1);
+        const glm::ivec3 max_coordinate = glm::ivec3(this->context.dimensions[0], this->context.dimensions[1], this->context.dimensions[2]) - glm::ivec3(1);
+
+        glm::vec3 interpolated = glm::vec3(0.0f);
+        for (int z = 0; z < 4; ++z) {
+            const unsigned voxel_z = std::clamp(first_coordinate.z + z, 0, max_coordinate.z);
+
+            for (int y = 0; y < 4; ++y) {
+                const unsigned voxel_y = std::clamp(first_coordinate.y + y, 0, max_coordinate.y);
+
+                for (int x = 0; x < 4; ++x) {
+                    const unsigned voxel_x = std::clamp(first_coordinate.x + x, 0, max_coordinate.x);
+                    interpolated += weights[x].x * weights[y].y * weights[z].z * this->sampler.sample_voxel(time_slices, voxel_x, voxel_y, voxel_z);
+                }
+            }
+        }
+
+        return interpolated;
+    }
+
+    glm::vec3 sample_voxel(const TimeSlices& time_slices, unsigned x, unsigned y, unsigned z) const {
+        return this->sampler.sample_voxel(time_slices, x, y, z);
+    }
+
+  private:
+    const CpuIntegrationContext& context;
+    Sampler sampler;
+};
+
+// Volumes blended between the time slices at the stage times of the current step, see TimeBlending.
+// The volumes contain the voxels of the dataset, so that the trilinear interpolation of a volume only differs from
+// sample_dataset() of the dataset sampler by rounding. LayeredInterpolation replicates the filtering of BC6H datasets,
+// which interpolate between the layers with full precision.
+template <bool ExplicitInterpolation, bool LayeredInterpolation>
+class BlendedSampler {
+  public:
+    explicit BlendedSampler(const CpuIntegrationContext& context) : context(context) {}
+
+    glm::vec3 sample_dataset(const glm::vec4& coordinates) const {
+        const int width = this->context.dimensions[0];
+        const int height = this->context.dimensions[1];
+        const int depth = this->context.dimensions[2];
+
+        const float* volume = this->get_volume(coordinates.w);
+        const glm::vec3 position = glm::vec3(coordinates.x, coordinates.y, coordinates.z);
+        const glm::vec3 base_coordinate = glm::floor(position);
+        glm::vec3 filter_weight = get_filter_weight<ExplicitInterpolation>(position, base_coordinate);
+        if constexpr (LayeredInterpolation && !ExplicitInterpolation) {
+            filter_weight.z = glm::fract(position.z);
+        }
+
+        const int x0 = std::clamp(int(base_coordinate.x), 0, width - 1);
+        const int y0 = std::clamp(int(base_coordinate.y), 0, height - 1);
+        const int z0 = std::clamp(int(base_coordinate.z), 0, depth - 1);
+        const int x1 = std::min(x0 + 1, width - 1);
+        const int y1 = std::min(y0 + 1, height - 1);
+        const int z1 = std::min(z0 + 1, depth - 1);
+
+        const auto fetch = [&](int x, int y, int z) {
+            const float* voxel = volume + 3 * (x + width * (y + std::size_t(height) * z));
+            return glm::vec3(voxel[0], voxel[1], voxel[2]);
+        };
+
+        const glm::vec3 sample_w00 = glm::mix(fetch(x0, y0, z0), fetch(x1, y0, z0), filter_weight.x);
+        const glm::vec3 sample_w10 = glm::mix(fetch(x0, y1, z0), fetch(x1, y1, z0), filter_weight.x);
+        const glm::vec3 sample_ww0 = glm::mix(sample_w00, sample_w10, filter_weight.y);
+
+        const glm::vec3 sample_w01 = glm::mix(fetch(x0, y0, z1), fetch(x1, y0, z1), filter_weight.x);
+        const glm::vec3 sample_w11 = glm::mix(fetch(x0, y1, z1), fetch(x1, y1, z1), filter_weight.x);
+        const glm::vec3 sample_ww1 = glm::mix(sample_w01, sample_w11, filter_weight.y);
+
+        return glm::mix(sample_ww0, sample_ww1, filter_weight.z);
+    }
+
+  private:
+    // The volume whose time is closest to t. The stage times of a step are at least half a time step apart, so that the
+    // rounding of the stage times here and in get_stage_times() cannot select the volume of another stage.
+    const float* get_volume(float t) const {
+        unsigned closest = 0;
+        float closest_distance = std::numeric_limits<float>::infinity();
+        for (unsigned i = 0; i < BLENDED_VOLUME_COUNT; ++i) {
+            // Slots without volume have a NaN time, whose distance is never smaller
+            const float distance = std::abs(this->context.blended_times[i] - t);
+            if (distance < closest_distance) {
+                closest = i;
+                closest_distance = distance;
+            }
+        }
+
+        assert(closest_distance <= 0.25f * this->context.delta_time && "no blended volume for the stage time");
+        return this->context.blended_volumes[closest];
+    }
+
+    const CpuIntegrationContext& context;
+};
+
+// Newton Method
+struct EulerMethod {
+    static constexpr unsigned SAMPLES_PER_STEP = 1;
+
+    template <typename Sampler>
+    static glm::vec3 velocity(const Sampler& sampler, const glm::vec4& coordinates, float) {
+        return sampler.sample_dataset(coordinates);
+    }
+};
+
+// Newton Midpoint Method / Modified Euler Method
+struct MidpointMethod {
+    static constexpr unsigned SAMPLES_PER_STEP = 2;
+
+    template <typename Sampler>
+    static glm::vec3 velocity(const Sampler& sampler, const glm::vec4& coordinates, float dt) {
+        const glm::vec4 k1 = coordinates;
+        const glm::vec3 v1 = sampler.sample_dataset(k1);
+
+        const glm::vec4 k2 = coordinates + glm::vec4(v1 * 0.5f * dt, 0.5f * dt);
+        const glm::vec3 v2 = sampler.sample_dataset(k2);
+
+        return v2;
+    }
+};
+
+// Runge Kutta 4th Order Method
+struct RungeKutta4Method {
+    static constexpr unsigned SAMPLES_PER_STEP = 4;
+
+    template <typename Sampler>
+    static glm::vec3 velocity(const Sampler& sampler, const glm::vec4& coordinates, float dt) {
+        const glm::vec4 k1 = coordinates;
+        const glm::vec3 v1 = sampler.sample_dataset(k1);
+
+        const glm::vec4 k2 = coordinates + glm::vec4(v1 * 0.5f * dt, 0.5f * dt);
+        const glm::vec3 v2 = sampler.sample_dataset(k2);
+
+        const glm::vec4 k3 = coordinates + glm::vec4(v2 * 0.5f * dt, 0.5f * dt);
+        const glm::vec3 v3 = sampler.sample_dataset(k3);
+
+        const glm::vec4 k4 = coordinates + glm::vec4(v3 * dt, dt);
+        const glm::vec3 v4 = sampler.sample_dataset(k4);
+
+        return (v1 + 2.0f * v2 + 2.0f * v3 + v4) / 6.0f;
+    }
+};
+
+// Vertices of the path line of the seed in the line buffer
+inline glm::vec4* get_line(const CpuIntegrationContext& context, std::size_t seed_id) {
+    return reinterpret_cast<glm::vec4*>(context.line_buffer) + (seed_id - context.first_buffer_seed) * (context.integration_steps + 1);
+}
+
+// Seeding, see seeding.comp. Writes the seed position as first vertex of the path line.
+inline glm::vec3 seed_particle(const CpuIntegrationContext& context, std::size_t seed_id) {
+    const glm::vec3 dimensions = glm::vec3(context.dimensions[0], context.dimensions[1], context.dimensions[2]);
+    const glm::uvec3 seed_spawn = glm::uvec3(context.seed_spawn[0], context.seed_spawn[1], context.seed_spawn[2]);
+    const glm::uvec3 seed_index = glm::uvec3(
+        seed_id % seed_spawn.x,
+        (seed_id / seed_spawn.x) % seed_spawn.y,
+        seed_id / (seed_spawn.x * seed_spawn.y)
+    );
+    const std::size_t line_buffer_offset = (seed_id - context.first_buffer_seed) * (context.integration_steps + 1);
+
+    const glm::vec3 relative_seed_position = glm::vec3(seed_index) / glm::vec3(seed_spawn);
+    const glm::vec3 position = dimensions * relative_seed_position;
+    get_line(context, seed_id)[0] = glm::vec4(position, 0.0f);
+
+    VkDrawIndirectCommand& indirect_command = context.indirect_buffer[seed_id - context.first_buffer_seed];
+    indirect_command.vertexCount = 1;
+    indirect_command.instanceCount = 1;
+    indirect_command.firstVertex = line_buffer_offset;
+    indirect_command.firstInstance = 0;
+
+    return position;
+}
+
+// Advances the particle by one step at time t and writes the next vertex, returns false if the particle has left the
+// dataset before the step
+template <typename Sampler, typename Method>
+bool integrate_step(const Sampler& sampler, const CpuIntegrationContext& context, glm::vec3& position, float t, glm::vec4& next_vertex) {
+    const glm::vec4 dimensions = glm::vec4(context.dimensions[0], context.dimensions[1], context.dimensions[2], context.dimensions[3]);
+    const glm::vec4 sample_location = glm::vec4(position, t);
+
+    for (unsigned i = 0; i < 4; ++i) {
+        if (sample_location[i] < 0.0f || sample_location[i] > dimensions[i] - 1.0f) {
+            return false;
+        }
+    }
+
+    const glm::vec3 velocity = Method::velocity(sampler, sample_location, context.delta_time);
+    const float velocity_magnitude = glm::length(velocity);
+
+    const glm::vec3 next_position = position + context.delta_time * velocity;
+    next_vertex = glm::vec4(next_position, velocity_magnitude);
+    position = next_position;
+
+    return true;
+}
+
+template <typename Sampler, typename Method>
+void integrate_seed(const Sampler& sampler, const CpuIntegrationContext& context, std::size_t seed_id) {
+    glm::vec3 position = seed_particle(context, seed_id);
+    VkDrawIndirectCommand& indirect_command = context.indirect_buffer[seed_id - context.first_buffer_seed];
+    glm::vec4* line = get_line(context, seed_id);
+
+    // The time is reset at the beginning of every batch exactly like in the dispatches of the GPU integration.
+    // A particle that left the dataset fails the bounds check in every later batch, so it can stop right away.
+    for (unsigned first_step = 0; first_step < context.integration_steps; first_step += context.batch_size) {
+        const unsigned step_count = std::min(context.integration_steps - first_step, context.batch_size);
+        float t = first_step * context.delta_time;
+
+        for (unsigned s = 0; s < step_count; ++s) {
+            if (!integrate_step<Sampler, Method>(sampler, context, position, t, line[first_step + s + 1])) {
+                return;
+            }
+            t += context.delta_time;
+
+            indirect_command.vertexCount++;
+        }
+    }
+}
+
+template <typename Sampler, typename Method>
+void integrate_seeds(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count) {
+    const Sampler sampler(context);
+
+    for (std::size_t seed_id = first_seed; seed_id < first_seed + seed_count; ++seed_id) {
+        integrate_seed<Sampler, Method>(sampler, context, seed_id);
+    }
+}
+
+// Blends the z slices [z_begin, z_end) of the dataset at time t into a volume of 3 interleaved channels
+template <typename Sampler>
+void blend_time_slices(const CpuIntegrationContext& context, float t, float* volume, std::size_t z_begin, std::size_t z_end) {
+    const Sampler sampler(context);
+    const TimeSlices time_slices = select_time_slices(context, t);
+    std::size_t offset = 3 * std::size_t(context.dimensions[0]) * context.dimensions[1] * z_begin;
+
+    for (std::size_t z = z_begin; z < z_end; ++z) {
+        for (unsigned y = 0; y < context.dimensions[1]; ++y) {
+            for (unsigned x = 0; x < context.dimensions[0]; ++x, offset += 3) {
+                const glm::vec3 voxel = sampler.sample_voxel(time_slices, x, y, z);
+                volume[offset + 0] = voxel.x;
+                volume[offset + 1] = voxel.y;
+                volume[offset + 2] = voxel.z;
+            }
+        }
+    }
+}
+
+// Advances all seeds that are still inside the dataset by the steps [first_step, first_step + step_count), starting at
+// time t. Unlike integrate_seeds(), all particles take these steps before the next ones, so that the integration only
+// samples the dataset around the current time, e.g. the volumes blended at the stage times of a single step.
+// The time advances exactly like in integrate_seed(). Returns the number of seeds that have taken all steps.
+template <typename Sampler, typename Method>
+std::size_t advance_seeds(const CpuIntegrationContext& context, std::size_t first_seed, std::size_t seed_count, unsigned first_step, unsigned step_count, float t) {
+    const Sampler sampler(context);
+    std::size_t advanced_count = 0;
+
+    for (std::size_t seed_id = first_seed; seed_id < first_seed + seed_count; ++seed_id) {
+        VkDrawIndirectCommand& indirect_command = context.indirect_buffer[seed_id - context.first_buffer_seed];
+        if (indirect_command.vertexCount != first_step + 1) {
+            continue; // Left the dataset in an earlier step
+        }
+
+        glm::vec4* line = get_line(context, seed_id);
+        glm::vec3 position = glm::vec3(line[first_step].x, line[first_step].y, line[first_step].z);
+        float step_t = t;
+        unsigned s = 0;
+
+        for (; s < step_count; ++s) {
+            if (!integrate_step<Sampler, Method>(sampler, context, position, step_t, line[first_step + s + 1])) {
+                break;
+            }
+            step_t += context.delta_time;
+
+            indirect_command.vertexCount++;
+        }
+
+        if (s == step_count) {
+            advanced_count++;
+        }
+    }
+
+    return advanced_count;
+}
+
+// Calls function.template operator()<Sampler>() with the sampler policy of the dataset format, layout and
+// interpolation mode
+template <typename Function>
+decltype(auto) visit_cpu_sampler(const CpuKernelSpecialization& specialization, Function&& function) {
+    const bool bricked = specialization.layout == CpuLayout::Bricked;
+
+    // The cubic interpolation only fetches voxels, so that the interpolation mode of the wrapped sampler does not matter
+    if (specialization.cubic_interpolation && specialization.sampler != CpuSampler::Analytic) {
+        switch (specialization.sampler) {
+            case CpuSampler::Float16:
+                return bricked ? function.template operator()<CatmullRomSampler<BrickedSampler<Float16Texels, true>>>() : function.template operator()<CatmullRomSampler<PlanarSampler<Float16Texels, true>>>();
+            case CpuSampler::BC6H:
+                return function.template operator()<CatmullRomSampler<Bc6hSampler<true>>>();
+            default:
+                return bricked ? function.template operator()<CatmullRomSampler<BrickedSampler<Float32Texels, true>>>() : function.template operator()<CatmullRomSampler<PlanarSampler<Float32Texels, true>>>();
+        }
+    }
+
+    switch (specialization.sampler) {
+        case CpuSampler::Float16:
+            if (bricked) {
+                return specialization.explicit_interpolation ? function.template operator()<BrickedSampler<Float16Texels, true>>() : function.template operator()<BrickedSampler<Float16Texels, false>>();
+            }
+            return specialization.explicit_interpolation ? function.template operator()<PlanarSampler<Float16Texels, true>>() : function.template operator()<PlanarSampler<Float16Texels, false>>();
+        case CpuSampler::BC6H:
+            return specialization.explicit_interpolation ? function.template operator()<Bc6hSampler<true>>() : function.template operator()<Bc6hSampler<false>>();
+        case CpuSampler::Analytic:
+            return function.template operator()<AnalyticSampler>();
+        default:
+            if (bricked) {
+                return specialization.explicit_interpolation ? function.template operator()<BrickedSampler<Float32Texels, true>>() : function.template operator()<BrickedSampler<Float32Texels, false>>();
+            }
+            return specialization.explicit_interpolation ? function.template operator()<PlanarSampler<Float32Texels, true>>() : function.template operator()<PlanarSampler<Float32Texels, false>>();
+    }
+}
+
+// Calls function.template operator()<Sampler>() with the sampler policy of the blended volumes of the dataset format
+template <typename Function>
+decltype(auto) visit_blended_sampler(const CpuKernelSpecialization& specialization, Function&& function) {
+    if (specialization.sampler == CpuSampler::BC6H) {
+        return specialization.explicit_interpolation ? function.template operator()<BlendedSampler<true, true>>() : function.template operator()<BlendedSampler<false, true>>();
+    }
+    return specialization.explicit_interpolation ? function.template operator()<BlendedSampler<true, false>>() : function.template operator()<BlendedSampler<false, false>>();
+}
+
+// Calls function.template operator()<Method>() with the integration method
+template <typename Function>
+decltype(auto) visit_integration_method(IntegrationMethod method, Function&& function) {
+    switch (method) {
+        case IntegrationMethod::Euler:
+            return function.template operator()<EulerMethod>();
+        case IntegrationMethod::Midpoint:
+            return function.template operator()<MidpointMethod>();
+        default:
+            return function.template operator()<RungeKutta4Method>();
+    }
+}
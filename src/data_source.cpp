@@ -162,6 +162,17 @@ std::shared_ptr<DataSource> DataSource::open_ktx_file(const std::filesystem::pat
     return dataset;
 }
 
+std::shared_ptr<DataSource> DataSource::open_file(const std::filesystem::path& path) {
+    if (path.extension() == ".raw") {
+        return DataSource::open_raw_file(path);
+    } else if (path.extension() == ".ktx") {
+        return DataSource::open_ktx_file(path);
+    }
+
+    lava::log()->warn("Unknown extension: {}", path.extension().string());
+    return nullptr;
+}
+
 void DataSource::imgui() {
     ImGui::InputText("Filename", this->filename.data(), this->filename.length(), ImGuiInputTextFlags_ReadOnly);
     ImGui::InputInt4("Dimensions", reinterpret_cast<int*>(glm::value_ptr(this->dimensions)), ImGuiInputTextFlags_ReadOnly);
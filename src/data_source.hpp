@@ -19,6 +19,8 @@ struct DataSource {
 
     static Ptr open_raw_file(const std::filesystem::path& path);
     static Ptr open_ktx_file(const std::filesystem::path& path);
+    // Selects open_raw_file() or open_ktx_file() based on the extension of the file
+    static Ptr open_file(const std::filesystem::path& path);
 
     // std::streampos get_offset(int z, int t);
     void read(void* buffer);
@@ -167,7 +167,9 @@ bool Dataset::create(lava::device_p device) {
 }
 
 void Dataset::destroy() {
-    this->loading_thread.join();
+    if (this->loading_thread.joinable()) {
+        this->loading_thread.join();
+    }
     if (this->sampler != VK_NULL_HANDLE) {
         assert(this->device);
         this->device->vkDestroySampler(this->sampler);
@@ -190,6 +192,13 @@ bool Dataset::loaded() {
     return this->loading_state.read()->step == LoadingState::Step::FINISHED;
 }
 
+bool Dataset::wait_for_loading() {
+    if (this->loading_thread.joinable()) {
+        this->loading_thread.join();
+    }
+    return this->loaded();
+}
+
 void Dataset::imgui() {
     this->data->imgui();
     auto loading_state = this->loading_state.read();
@@ -548,7 +557,7 @@ void Dataset::load(std::size_t staging_buffer_count) {
     this->loading_state.write()->set_step(LoadingState::Step::FINISHED);
 }
 
-void Dataset::transition_images(VkCommandBuffer command_buffer) {
+void Dataset::transition_images(VkCommandBuffer command_buffer, VkPipelineStageFlags dst_stage_mask) {
     auto graphics_queue = this->device->queues()[queue_indices::GRAPHICS];
     auto transfer_queue = this->device->queues()[queue_indices::TRANSFER];
 
@@ -570,7 +579,7 @@ void Dataset::transition_images(VkCommandBuffer command_buffer) {
                 .layerCount = data->format == DataSource::Format::BC6H ? data->dimensions.z : 1,
             },
         };
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage_mask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     }
 
     this->transitioned = true;
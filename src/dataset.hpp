@@ -83,9 +83,13 @@ struct Dataset {
     void load(std::size_t staging_buffer_count);
 
     bool transitioned = false;
-    void transition_images(VkCommandBuffer command_buffer);
+    // The images are transitioned for the graphics queue in the frame loop, without a frame loop they are only read by
+    // the compute shaders
+    void transition_images(VkCommandBuffer command_buffer, VkPipelineStageFlags dst_stage_mask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT);
 
     bool is_loading();
     bool loaded();
+    // Blocks until the loading thread has finished, returns whether the dataset has been loaded
+    bool wait_for_loading();
     void imgui();
 };
@@ -0,0 +1,132 @@
+#include "host_dataset.hpp"
+#include <algorithm>
+#include <cstring>
+#include <liblava/core/time.hpp>
+#include <liblava/util/log.hpp>
+
+bool HostDataset::load() {
+    const std::size_t slice_count = std::size_t(this->data->dimensions.w) * this->data->channel_count;
+
+    lava::timer sw;
+    this->replicas.clear();
+    std::vector<HostBuffer>& slices = this->replicas.emplace_back(slice_count);
+
+    for (std::size_t i = 0; i < slice_count; ++i) {
+        const int channel_index = i / this->data->dimensions.w;
+        const int time_slice_index = i % this->data->dimensions.w;
+        HostBuffer& slice = slices[i];
+
+        // Page aligned and therefore suitably aligned for floats
+        slice = HostBuffer(this->data->time_slice_size);
+        this->data->read_time_slice(channel_index, time_slice_index, slice.data());
+
+        if (!this->data->file) {
+            lava::log()->error("host dataset: failed to read slice {} of channel {}", time_slice_index, channel_index);
+            return false;
+        }
+    }
+
+    lava::log()->info("host dataset loaded ({} MB, {} ms)", static_cast<double>(slice_count * this->data->time_slice_size) / 1024.0 / 1024.0, sw.elapsed().count());
+
+    return true;
+}
+
+bool HostDataset::map() {
+    this->replicas.clear();
+    this->mapping = MappedFile::make(this->data->filename);
+    if (!this->mapping) {
+        return false;
+    }
+
+    const std::size_t value_size = this->data->format == DataSource::Format::Float32 ? sizeof(float) : this->data->format == DataSource::Format::Float16 ? sizeof(std::uint16_t) : 1;
+    if (std::size_t(this->data->data_offset) % value_size != 0) {
+        lava::log()->error("host dataset: the data of '{}' is not aligned to its values and cannot be mapped", this->data->filename);
+        this->mapping = nullptr;
+        return false;
+    }
+
+    if (this->mapping->size() < std::size_t(this->data->data_offset) + std::size_t(this->data->data_size)) {
+        lava::log()->error("host dataset: '{}' is smaller than its data", this->data->filename);
+        this->mapping = nullptr;
+        return false;
+    }
+
+    lava::log()->info("host dataset mapped ({} MB)", static_cast<double>(this->data->data_size) / 1024.0 / 1024.0);
+
+    return true;
+}
+
+bool HostDataset::make_bricked(unsigned brick_size, ThreadPool& thread_pool) {
+    if (this->data->format != DataSource::Format::Float32 && this->data->format != DataSource::Format::Float16) {
+        lava::log()->error("host dataset: only Float32 and Float16 datasets can be bricked, BC6H slices already consist of blocks");
+        return false;
+    }
+
+    if (!BrickLayout::is_valid_brick_size(brick_size)) {
+        lava::log()->error("host dataset: invalid brick size {}", brick_size);
+        return false;
+    }
+
+    lava::timer sw;
+    BrickLayout layout(glm::uvec3(this->data->dimensions), brick_size);
+    const std::size_t value_size = this->data->format == DataSource::Format::Float32 ? sizeof(float) : sizeof(std::uint16_t);
+    std::vector<HostBuffer> bricked_slices(this->data->dimensions.w);
+
+    for (unsigned t = 0; t < this->data->dimensions.w; ++t) {
+        bricked_slices[t] = HostBuffer(3 * layout.get_texel_count() * value_size);
+        layout.relayout({this->get_slice(0, t), this->get_slice(1, t), this->get_slice(2, t)}, value_size, bricked_slices[t].data(), thread_pool);
+    }
+
+    this->replicas.clear();
+    this->replicas.push_back(std::move(bricked_slices));
+    this->brick_layout = std::move(layout);
+
+    const std::size_t voxel_count = std::size_t(this->data->dimensions.x) * this->data->dimensions.y * this->data->dimensions.z;
+    lava::log()->info("host dataset bricked ({}^3 voxels per brick, {:.1f}% padding, {} ms)", brick_size, 100.0 * (double(this->brick_layout->get_texel_count()) / voxel_count - 1.0), sw.elapsed().count());
+
+    return true;
+}
+
+bool HostDataset::place(NumaPlacement placement, const NumaTopology& topology, unsigned node_count, ThreadPool& thread_pool) {
+    if (placement == NumaPlacement::Off) {
+        return true;
+    }
+
+    lava::timer sw;
+    node_count = std::clamp(node_count, 1u, topology.get_node_count());
+    const std::vector<HostBuffer>& slices = this->replicas.front();
+    const std::size_t slice_count = slices.size();
+    const unsigned replica_count = placement == NumaPlacement::Replicate ? node_count : 1;
+    std::vector<std::vector<HostBuffer>> placed_replicas(replica_count);
+
+    for (unsigned replica = 0; replica < replica_count; ++replica) {
+        for (const HostBuffer& slice : slices) {
+            HostBuffer& placed_slice = placed_replicas[replica].emplace_back(slice.size());
+            const bool bound = placement == NumaPlacement::Replicate ? placed_slice.bind(topology, replica) : placed_slice.interleave(topology, node_count);
+
+            if (!bound) {
+                lava::log()->error("host dataset: failed to bind slices to NUMA nodes");
+                return false;
+            }
+        }
+    }
+
+    // The pages have been bound before they are written, so it does not matter which thread copies a slice
+    thread_pool.parallel_for(replica_count * slice_count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            HostBuffer& placed_slice = placed_replicas[i / slice_count][i % slice_count];
+            std::memcpy(placed_slice.data(), slices[i % slice_count].data(), placed_slice.size());
+        }
+    });
+
+    this->replicas = std::move(placed_replicas);
+
+    std::size_t replica_size = 0;
+    for (const HostBuffer& slice : this->replicas.front()) {
+        replica_size += slice.size();
+    }
+    const HostBuffer::Pages pages = this->replicas.front().front().get_pages();
+    lava::log()->info("host dataset {} on {} NUMA nodes ({} MB per replica, {} pages, {} ms)", placement == NumaPlacement::Replicate ? "replicated" : "interleaved", node_count, static_cast<double>(replica_size) / 1024.0 / 1024.0, get_host_buffer_pages_name(pages), sw.elapsed().count());
+
+    return true;
+}
\ No newline at end of file
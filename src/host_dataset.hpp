@@ -0,0 +1,62 @@
+#pragma once
+
+#include "brick_layout.hpp"
+#include "data_source.hpp"
+#include "mapped_file.hpp"
+#include "numa.hpp"
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Copy of a dataset in host memory which is used for the integration on the CPU.
+// Every time slice of every channel is stored as in the file: Float32 and Float16 slices in the planar (x fastest)
+// layout of the raw files and BC6H slices as compressed blocks, which are decoded by the samplers of the integration.
+// Float32 and Float16 slices can be converted into the bricked layout, after which there is a single slice per time
+// step that contains all 3 channels.
+// On NUMA machines, the slices can be interleaved over the nodes or replicated on every node afterwards, in which case
+// every replica holds all slices.
+// Datasets that do not fit into memory can be mapped instead of loaded, then the slices point into the mapping of the
+// file and are neither bricked nor placed.
+struct HostDataset {
+    using Ptr = std::shared_ptr<HostDataset>;
+
+    HostDataset(DataSource::Ptr data) : data(std::move(data)) {}
+
+    static Ptr make(DataSource::Ptr data, bool mapped = false) {
+        auto dataset = std::make_shared<HostDataset>(data);
+
+        if (!(mapped ? dataset->map() : dataset->load())) {
+            return nullptr;
+        }
+        return dataset;
+    }
+
+    bool load();
+    bool map();
+    bool make_bricked(unsigned brick_size, ThreadPool& thread_pool);
+    // Moves the slices to the first node_count nodes of the topology
+    bool place(NumaPlacement placement, const NumaTopology& topology, unsigned node_count, ThreadPool& thread_pool);
+
+    DataSource::Ptr data;
+    std::vector<std::vector<HostBuffer>> replicas; // A single one unless the slices are replicated
+    std::optional<BrickLayout> brick_layout;
+    MappedFile::Ptr mapping; // Only if the dataset is mapped
+    unsigned get_slice_channel_count() const {
+        return this->brick_layout.has_value() ? 1 : this->data->channel_count;
+    }
+    unsigned get_replica_count() const {
+        return this->mapping ? 1 : static_cast<unsigned>(this->replicas.size());
+    }
+    // Offset of a slice in the file
+    std::size_t get_slice_offset(unsigned channel, unsigned t) const {
+        return std::size_t(this->data->data_offset) + channel * std::size_t(this->data->channel_size) + t * std::size_t(this->data->time_slice_size);
+    }
+    const void* get_slice(unsigned channel, unsigned t, unsigned replica = 0) const {
+        if (this->mapping) {
+            return this->mapping->data() + this->get_slice_offset(channel, t);
+        }
+        return this->replicas[replica][channel * this->data->dimensions.w + t].data();
+    }
+};
@@ -1,3 +1,7 @@
+#ifdef SUBGROUP_ARITHMETIC
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
+
 layout(push_constant) uniform Constants {
     vec4 dataset_dimensions;
     uvec3 seed_dimensions;
@@ -5,15 +9,47 @@ layout(push_constant) uniform Constants {
     uint total_step_count;
     uint first_step;
     uint step_count;
+    float absolute_tolerance; // Of the adaptive method in voxels
+    float relative_tolerance;
 }
 constants;
 
+// Kernels that are specialized at runtime (--specialize_kernels) replace the push constants that are the same for all
+// batches of a run with literals, so that the compiler can fold them
+#ifdef SPECIALIZED_DATASET_DIMENSIONS
+#define DATASET_DIMENSIONS SPECIALIZED_DATASET_DIMENSIONS
+#else
+#define DATASET_DIMENSIONS constants.dataset_dimensions
+#endif
+
+#ifdef SPECIALIZED_DT
+#define DT SPECIALIZED_DT
+#else
+#define DT constants.dt
+#endif
+
+#ifdef SPECIALIZED_TOTAL_STEP_COUNT
+#define TOTAL_STEP_COUNT SPECIALIZED_TOTAL_STEP_COUNT
+#else
+#define TOTAL_STEP_COUNT constants.total_step_count
+#endif
+
+// Only defined if all batches of the run have the same number of steps
+#ifdef SPECIALIZED_STEP_COUNT
+#define STEP_COUNT SPECIALIZED_STEP_COUNT
+#else
+#define STEP_COUNT constants.step_count
+#endif
+
 layout(std140, set = 0, binding = 0) buffer line_buffer {
     vec4 vertices[];
 };
 
 layout(std140, set = 0, binding = 1) buffer max_velocity_magnitude_buffer {
     uint max_velocity_magnitude;
+    uint active_particle_count; // Particles that are still inside the dataset after the batch, reset by the host
+    uint sample_count_low;      // Velocity samples of the batch as a 64 bit counter, reset by the host
+    uint sample_count_high;
 };
 
 struct DrawIndirectCommand {
@@ -27,6 +63,24 @@ layout(std140, set = 0, binding = 2) buffer indirect_buffer {
     DrawIndirectCommand indirect_draw[];
 };
 
+// The state of the methods that continue a path line from more than its last vertex between two batches. The adaptive
+// method only uses position and velocity, since its steps do not end at the times of the vertices, the multistep method
+// only uses the velocities.
+struct ParticleState {
+    vec4 position;   // xyz: position, w: time of the last accepted step (adaptive)
+    vec4 velocity;   // xyz: velocity at the position, w: size of the next step or 0 if the particle left the dataset
+                     // (adaptive) or the number of known velocities (multistep)
+    vec4 history[3]; // xyz: velocities of the previous steps, the latest first (multistep)
+};
+
+layout(std140, set = 0, binding = 6) buffer particle_state_buffer {
+    ParticleState particle_states[];
+};
+
+layout(std140, set = 0, binding = 7) buffer work_queue_buffer {
+    uint next_work_item; // Reset by the host before every batch
+};
+
 layout(local_size_x_id = 0) in;
 layout(local_size_y_id = 1) in;
 layout(local_size_z_id = 2) in;
@@ -35,6 +89,118 @@ layout(constant_id = 3) const uint TIME_STEPS = 400;
 
 layout(constant_id = 4) const bool EXPLICIT_INTERPOLATION = false;
 
+// The values of IntegrationMethod in integration_method.hpp
+#define INTEGRATION_METHOD_EULER 0
+#define INTEGRATION_METHOD_MIDPOINT 1
+#define INTEGRATION_METHOD_RUNGE_KUTTA_4 2
+#define INTEGRATION_METHOD_DORMAND_PRINCE 3
+#define INTEGRATION_METHOD_ADAMS_BASHFORTH_MOULTON 4
+
+layout(constant_id = 5) const uint INTEGRATION_METHOD = INTEGRATION_METHOD_RUNGE_KUTTA_4;
+
+// Interpolates the voxels of a time slice with a Catmull-Rom spline instead of linearly. The time slices are still
+// interpolated linearly.
+layout(constant_id = 6) const bool CUBIC_INTERPOLATION = false;
+
+// Seeds that every invocation integrates. The particle i of an invocation is i grid widths further along the x axis, so
+// that the invocations of a work group integrate neighboring seeds in every round.
+layout(constant_id = 7) const uint PARTICLES_PER_INVOCATION = 1;
+
+// Keeps the vertex counts of the particles and the statistics of the batch in registers instead of updating the buffers
+// with an atomic in every step. The vertex counts are written once per batch, the maximum velocity magnitude is reduced
+// across the subgroups into shared memory and committed with one atomic per work group, and the sample and particle
+// counts with one atomic per subgroup. The subgroup operations are only compiled into the kernels that define
+// SUBGROUP_ARITHMETIC, which require Vulkan 1.1.
+layout(constant_id = 8) const bool SUBGROUP_COUNTERS = true;
+
+// Persistent invocations: only a few work groups are dispatched, whose invocations take work items of
+// PARTICLES_PER_INVOCATION consecutive seeds from a queue until every seed of the batch is integrated. An invocation whose
+// particles leave the dataset early takes the next item instead of idling until the rest of its work group is done.
+layout(constant_id = 9) const bool WORK_QUEUE = false;
+
+uint work_item = 0; // The work item of the invocation if WORK_QUEUE is set
+
+float invocation_max_velocity_magnitude = 0.0f;
+uint invocation_sample_count = 0;
+uint invocation_active_particle_count = 0;
+
+shared uint work_group_max_velocity_magnitude;
+
+// The samples of all batches of a single submission exceed 32 bits for large seed grids, the carry of the low word is
+// added to the high word by the invocation whose addition overflowed it
+void add_sample_count(uint count) {
+    const uint previous_sample_count = atomicAdd(sample_count_low, count);
+    if (previous_sample_count + count < previous_sample_count) {
+        atomicAdd(sample_count_high, 1);
+    }
+}
+
+void count_velocity_magnitude(float velocity_magnitude) {
+    if (SUBGROUP_COUNTERS) {
+        invocation_max_velocity_magnitude = max(invocation_max_velocity_magnitude, velocity_magnitude);
+    } else {
+        atomicMax(max_velocity_magnitude, floatBitsToUint(velocity_magnitude));
+    }
+}
+
+void count_samples(uint count) {
+    if (SUBGROUP_COUNTERS) {
+        invocation_sample_count += count;
+    } else {
+        add_sample_count(count);
+    }
+}
+
+void count_active_particle() {
+    if (SUBGROUP_COUNTERS) {
+        invocation_active_particle_count++;
+    } else {
+        atomicAdd(active_particle_count, 1);
+    }
+}
+
+// Has to be called by all invocations of the work group. The velocity magnitudes are positive, so that their bits are
+// ordered like the floats.
+void commit_counters() {
+    if (!SUBGROUP_COUNTERS) {
+        return;
+    }
+
+    if (gl_LocalInvocationIndex == 0) {
+        work_group_max_velocity_magnitude = 0;
+    }
+    barrier();
+
+#ifdef SUBGROUP_ARITHMETIC
+    const float subgroup_max_velocity_magnitude = subgroupMax(invocation_max_velocity_magnitude);
+    const uint subgroup_sample_count = subgroupAdd(invocation_sample_count);
+    const uint subgroup_active_particle_count = subgroupAdd(invocation_active_particle_count);
+    if (subgroupElect()) {
+        atomicMax(work_group_max_velocity_magnitude, floatBitsToUint(subgroup_max_velocity_magnitude));
+        if (subgroup_sample_count > 0) {
+            add_sample_count(subgroup_sample_count);
+        }
+        if (subgroup_active_particle_count > 0) {
+            atomicAdd(active_particle_count, subgroup_active_particle_count);
+        }
+    }
+#else
+    // Kernels for devices without subgroup operations commit the counters of every invocation
+    atomicMax(work_group_max_velocity_magnitude, floatBitsToUint(invocation_max_velocity_magnitude));
+    if (invocation_sample_count > 0) {
+        add_sample_count(invocation_sample_count);
+    }
+    if (invocation_active_particle_count > 0) {
+        atomicAdd(active_particle_count, invocation_active_particle_count);
+    }
+#endif
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0 && work_group_max_velocity_magnitude > 0) {
+        atomicMax(max_velocity_magnitude, work_group_max_velocity_magnitude);
+    }
+}
+
 #if defined(DATA_RAW_TEXTURES)
 layout(set = 0, binding = 3) uniform sampler3D dataset_x[TIME_STEPS];
 layout(set = 0, binding = 4) uniform sampler3D dataset_y[TIME_STEPS];
@@ -47,6 +213,36 @@ layout(set = 0, binding = 3) uniform sampler2DArray dataset[TIME_STEPS];
 #error "define something"
 #endif
 
+#if defined(DATA_RAW_TEXTURES) || defined(DATA_BC6H_TEXTURE)
+// Catmull-Rom weights of the four voxels around the coordinates along every axis, the first at floor(coordinates) - 1
+void get_catmull_rom_weights(vec3 coordinates, out vec3 weights[4]) {
+    const vec3 f = fract(coordinates);
+
+    weights[0] = f * (-0.5f + f * (1.0f - 0.5f * f));
+    weights[1] = 1.0f + f * f * (-2.5f + 1.5f * f);
+    weights[2] = f * (0.5f + f * (2.0f - 1.5f * f));
+    weights[3] = f * f * (-0.5f + 0.5f * f);
+}
+
+// The Catmull-Rom filter as three linearly filtered taps per axis instead of four voxels. The weights of the two inner
+// voxels are positive, so that they are combined into a single tap between them. The weights of the outer voxels are
+// negative and cannot be combined with their neighbors, their taps lie on the voxel centers, where the linear filter
+// returns the voxel unchanged. Unlike the B-spline with its positive weights, which needs 8 taps, the filter needs 27.
+void get_catmull_rom_taps(vec3 coordinates, out vec3 tap_coordinates[3], out vec3 tap_weights[3]) {
+    vec3 weights[4];
+    get_catmull_rom_weights(coordinates, weights);
+    const vec3 base_coordinate = floor(coordinates);
+
+    tap_weights[0] = weights[0];
+    tap_weights[1] = weights[1] + weights[2];
+    tap_weights[2] = weights[3];
+
+    tap_coordinates[0] = base_coordinate - vec3(1.0f);
+    tap_coordinates[1] = base_coordinate + weights[2] / tap_weights[1];
+    tap_coordinates[2] = base_coordinate + vec3(2.0f);
+}
+#endif
+
 #if defined(DATA_RAW_TEXTURES)
 float sample_explicit(sampler3D dataset_sampler, vec3 coordinates) {
     ivec3 base_coordinate = ivec3(floor(coordinates));
@@ -75,11 +271,67 @@ float sample_explicit(sampler3D dataset_sampler, vec3 coordinates) {
     return sample_www;
 }
 
+// Catmull-Rom interpolation of the 64 voxels around the coordinates, which are clamped to the dataset like the taps of the
+// implicit interpolation
+float sample_cubic_explicit(sampler3D dataset_sampler, vec3 coordinates) {
+    vec3 weights[4];
+    get_catmull_rom_weights(coordinates, weights);
+    const ivec3 base_coordinate = ivec3(floor(coordinates)) - ivec3(1);
+    const ivec3 max_coordinate = ivec3(DATASET_DIMENSIONS.xyz) - ivec3(1);
+
+    float interpolated = 0.0f;
+    for (int z = 0; z < 4; ++z) {
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                const ivec3 voxel_coordinate = clamp(base_coordinate + ivec3(x, y, z), ivec3(0), max_coordinate);
+                interpolated += weights[x].x * weights[y].y * weights[z].z * texelFetch(dataset_sampler, voxel_coordinate, 0).x;
+            }
+        }
+    }
+
+    return interpolated;
+}
+
+vec3 sample_cubic(int sampler_index, vec3 coordinates) {
+    if (EXPLICIT_INTERPOLATION) {
+        return vec3(
+            sample_cubic_explicit(dataset_x[sampler_index], coordinates),
+            sample_cubic_explicit(dataset_y[sampler_index], coordinates),
+            sample_cubic_explicit(dataset_z[sampler_index], coordinates)
+        );
+    }
+
+    vec3 tap_coordinates[3];
+    vec3 tap_weights[3];
+    get_catmull_rom_taps(coordinates, tap_coordinates, tap_weights);
+
+    vec3 interpolated = vec3(0.0f);
+    for (int z = 0; z < 3; ++z) {
+        for (int y = 0; y < 3; ++y) {
+            for (int x = 0; x < 3; ++x) {
+                const vec3 texture_coordinates = (vec3(tap_coordinates[x].x, tap_coordinates[y].y, tap_coordinates[z].z) + vec3(0.5)) / DATASET_DIMENSIONS.xyz;
+                const vec3 tap = vec3(
+                    texture(dataset_x[sampler_index], texture_coordinates).r,
+                    texture(dataset_y[sampler_index], texture_coordinates).r,
+                    texture(dataset_z[sampler_index], texture_coordinates).r
+                );
+                interpolated += tap_weights[x].x * tap_weights[y].y * tap_weights[z].z * tap;
+            }
+        }
+    }
+
+    return interpolated;
+}
+
 vec3 sample_dataset(vec4 coordinates) {
-    const float sampler_index = min(coordinates.w, constants.dataset_dimensions.w - 1.0);
+    const float sampler_index = min(coordinates.w, DATASET_DIMENSIONS.w - 1.0);
     const int sampler_index_floored = int(floor(sampler_index));
     const int sampler_index_ceiled = int(ceil(sampler_index));
 
+    if (CUBIC_INTERPOLATION) {
+        return mix(sample_cubic(sampler_index_floored, coordinates.xyz), sample_cubic(sampler_index_ceiled, coordinates.xyz), fract(coordinates.w));
+    }
+
     if (EXPLICIT_INTERPOLATION) {
         vec3 sample_www0 = vec3(0.0);
         sample_www0.x = sample_explicit(dataset_x[sampler_index_floored], coordinates.xyz);
@@ -93,7 +345,7 @@ vec3 sample_dataset(vec4 coordinates) {
 
         return mix(sample_www0, sample_www1, fract(coordinates.w));
     } else {
-        const vec3 texture_coordinates = (coordinates.xyz + vec3(0.5)) / constants.dataset_dimensions.xyz;
+        const vec3 texture_coordinates = (coordinates.xyz + vec3(0.5)) / DATASET_DIMENSIONS.xyz;
         const vec3 sample_www0 = vec3(
             texture(dataset_x[sampler_index_floored], texture_coordinates).r,
             texture(dataset_y[sampler_index_floored], texture_coordinates).r,
@@ -136,11 +388,65 @@ vec3 sample_explicit(sampler2DArray dataset_sampler, vec3 coordinates) {
     return sample_www;
 }
 
+// Catmull-Rom interpolation of the 64 voxels around the coordinates, which are clamped to the dataset like the taps of the
+// implicit interpolation
+vec3 sample_cubic_explicit(sampler2DArray dataset_sampler, vec3 coordinates) {
+    vec3 weights[4];
+    get_catmull_rom_weights(coordinates, weights);
+    const ivec3 base_coordinate = ivec3(floor(coordinates)) - ivec3(1);
+    const ivec3 max_coordinate = ivec3(DATASET_DIMENSIONS.xyz) - ivec3(1);
+
+    vec3 interpolated = vec3(0.0f);
+    for (int z = 0; z < 4; ++z) {
+        for (int y = 0; y < 4; ++y) {
+            for (int x = 0; x < 4; ++x) {
+                const ivec3 voxel_coordinate = clamp(base_coordinate + ivec3(x, y, z), ivec3(0), max_coordinate);
+                interpolated += weights[x].x * weights[y].y * weights[z].z * texelFetch(dataset_sampler, voxel_coordinate, 0).xyz;
+            }
+        }
+    }
+
+    return interpolated;
+}
+
+// The layers of the array are not filtered, so that only the x and y axes use the taps and the four layers are fetched
+// with 9 bilinear taps each
+vec3 sample_cubic(int sampler_index, vec3 coordinates) {
+    if (EXPLICIT_INTERPOLATION) {
+        return sample_cubic_explicit(dataset[sampler_index], coordinates);
+    }
+
+    vec3 tap_coordinates[3];
+    vec3 tap_weights[3];
+    get_catmull_rom_taps(coordinates, tap_coordinates, tap_weights);
+    vec3 weights[4];
+    get_catmull_rom_weights(coordinates, weights);
+    const float base_layer = floor(coordinates.z) - 1.0f;
+
+    vec3 interpolated = vec3(0.0f);
+    for (int z = 0; z < 4; ++z) {
+        const float layer = clamp(base_layer + float(z), 0.0f, DATASET_DIMENSIONS.z - 1.0f);
+
+        for (int y = 0; y < 3; ++y) {
+            for (int x = 0; x < 3; ++x) {
+                const vec2 texture_coordinates_xy = (vec2(tap_coordinates[x].x, tap_coordinates[y].y) + vec2(0.5)) / DATASET_DIMENSIONS.xy;
+                interpolated += tap_weights[x].x * tap_weights[y].y * weights[z].z * texture(dataset[sampler_index], vec3(texture_coordinates_xy, layer)).xyz;
+            }
+        }
+    }
+
+    return interpolated;
+}
+
 vec3 sample_dataset(vec4 coordinates) {
-    const float sampler_index = min(coordinates.w, constants.dataset_dimensions.w - 1.0);
+    const float sampler_index = min(coordinates.w, DATASET_DIMENSIONS.w - 1.0);
     const int sampler_index_floored = int(floor(sampler_index));
     const int sampler_index_ceiled = int(ceil(sampler_index));
 
+    if (CUBIC_INTERPOLATION) {
+        return mix(sample_cubic(sampler_index_floored, coordinates.xyz), sample_cubic(sampler_index_ceiled, coordinates.xyz), fract(coordinates.w));
+    }
+
     if (EXPLICIT_INTERPOLATION) {
         vec3 sample_www0 = sample_explicit(dataset[sampler_index_floored], coordinates.xyz);
         vec3 sample_www1 = sample_explicit(dataset[sampler_index_ceiled], coordinates.xyz);
@@ -152,7 +458,7 @@ vec3 sample_dataset(vec4 coordinates) {
         const float z_floored = floor(coordinates.z);
         const float z_ceiled = ceil(coordinates.z);
 
-        const vec2 texture_coordinates_xy = (coordinates.xy + vec2(0.5)) / constants.dataset_dimensions.xy;
+        const vec2 texture_coordinates_xy = (coordinates.xy + vec2(0.5)) / DATASET_DIMENSIONS.xy;
 
         vec3 sample_ww00 = texture(dataset[sampler_index_floored], vec3(texture_coordinates_xy, z_floored)).xyz;
         vec3 sample_ww10 = texture(dataset[sampler_index_floored], vec3(texture_coordinates_xy, z_ceiled)).xyz;
@@ -173,71 +479,422 @@ vec3 sample_dataset(vec4 coordinates) {
 #error "define something"
 #endif
 
-// Runge Kutta 4th Order Method
-vec3 rungekutta4(vec4 coordinates) {
-    vec4 k1 = coordinates;
-    vec3 v1 = sample_dataset(k1);
-
-    vec4 k2 = coordinates + vec4(v1 * 0.5f * constants.dt, 0.5f * constants.dt);
+// Runge Kutta 4th Order Method with the velocity at the coordinates already sampled, which starts the multistep method.
+// The methods with a fixed step interleave the stages of the particles of an invocation in integrate_fixed() instead.
+vec3 rungekutta4(vec4 coordinates, vec3 v1) {
+    vec4 k2 = coordinates + vec4(v1 * 0.5f * DT, 0.5f * DT);
     vec3 v2 = sample_dataset(k2);
 
-    vec4 k3 = coordinates + vec4(v2 * 0.5f * constants.dt, 0.5f * constants.dt);
+    vec4 k3 = coordinates + vec4(v2 * 0.5f * DT, 0.5f * DT);
     vec3 v3 = sample_dataset(k3);
 
-    vec4 k4 = coordinates + vec4(v3 * constants.dt, constants.dt);
+    vec4 k4 = coordinates + vec4(v3 * DT, DT);
     vec3 v4 = sample_dataset(k4);
 
     return (v1 + 2 * v2 + 2 * v3 + v4) / 6.0f;
 }
 
-// Newton Midpoint Method / Modified Euler Method
-vec3 newton_midpoint(vec4 coordinates) {
-    vec4 k1 = coordinates;
-    vec3 v1 = sample_dataset(k1);
+// Adams-Bashforth-Moulton 4th Order Method in PEC mode: predicts the position with Adams-Bashforth from the velocities
+// v0 at the coordinates and v1 to v3 of the previous steps, evaluates the velocity at the prediction and corrects with
+// Adams-Moulton. The velocity at the prediction is not evaluated again at the corrected position but becomes v0 of the
+// next step, so that a step takes a single sample.
+vec3 adams_bashforth_moulton(vec4 coordinates, vec3 v0, vec3 v1, vec3 v2, vec3 v3, out vec3 next_velocity) {
+    const vec3 predicted_position = coordinates.xyz + DT * (55.0f * v0 - 59.0f * v1 + 37.0f * v2 - 9.0f * v3) / 24.0f;
+    next_velocity = sample_dataset(vec4(predicted_position, coordinates.w + DT));
 
-    vec4 k2 = coordinates + vec4(v1 * 0.5f * constants.dt, 0.5f * constants.dt);
-    vec3 v2 = sample_dataset(k2);
+    return (9.0f * next_velocity + 19.0f * v0 - 5.0f * v1 + v2) / 24.0f;
+}
 
-    return v2;
+// Dormand-Prince 5(4) step of size h from the velocity v1 at the coordinates. Returns the position of the 5th order
+// solution, the velocity there, which is the first stage of the next step, and the error of the embedded 4th order
+// solution relative to the tolerances.
+vec3 dormand_prince(vec4 coordinates, vec3 v1, float h, out vec3 v7, out float error) {
+    vec3 v2 = sample_dataset(coordinates + h * vec4(v1 * (1.0f / 5.0f), 1.0f / 5.0f));
+    vec3 v3 = sample_dataset(coordinates + h * vec4(v1 * (3.0f / 40.0f) + v2 * (9.0f / 40.0f), 3.0f / 10.0f));
+    vec3 v4 = sample_dataset(coordinates + h * vec4(v1 * (44.0f / 45.0f) - v2 * (56.0f / 15.0f) + v3 * (32.0f / 9.0f), 4.0f / 5.0f));
+    vec3 v5 = sample_dataset(coordinates + h * vec4(v1 * (19372.0f / 6561.0f) - v2 * (25360.0f / 2187.0f) + v3 * (64448.0f / 6561.0f) - v4 * (212.0f / 729.0f), 8.0f / 9.0f));
+    vec3 v6 = sample_dataset(coordinates + h * vec4(v1 * (9017.0f / 3168.0f) - v2 * (355.0f / 33.0f) + v3 * (46732.0f / 5247.0f) + v4 * (49.0f / 176.0f) - v5 * (5103.0f / 18656.0f), 1.0f));
+
+    const vec3 position = coordinates.xyz + h * (v1 * (35.0f / 384.0f) + v3 * (500.0f / 1113.0f) + v4 * (125.0f / 192.0f) - v5 * (2187.0f / 6784.0f) + v6 * (11.0f / 84.0f));
+    v7 = sample_dataset(vec4(position, coordinates.w + h));
+
+    // Difference between the 5th and the 4th order solution
+    const vec3 difference = h * (v1 * (71.0f / 57600.0f) - v3 * (71.0f / 16695.0f) + v4 * (71.0f / 1920.0f) - v5 * (17253.0f / 339200.0f) + v6 * (22.0f / 525.0f) - v7 * (1.0f / 40.0f));
+    const vec3 scale = vec3(constants.absolute_tolerance) + constants.relative_tolerance * max(abs(coordinates.xyz), abs(position));
+    const vec3 scaled_difference = abs(difference) / scale;
+    error = max(scaled_difference.x, max(scaled_difference.y, scaled_difference.z));
+
+    return position;
 }
 
-// Newton Method
-vec3 newton(vec4 coordinates) {
-    return sample_dataset(coordinates);
+// Cubic Hermite interpolation of a step of size h at theta in [0, 1], which is as accurate as the output needs
+vec3 interpolate_step(vec3 position, vec3 velocity, vec3 next_position, vec3 next_velocity, float h, float theta) {
+    const float theta2 = theta * theta;
+    const float theta3 = theta2 * theta;
+
+    return (2.0f * theta3 - 3.0f * theta2 + 1.0f) * position +
+           (theta3 - 2.0f * theta2 + theta) * h * velocity +
+           (-2.0f * theta3 + 3.0f * theta2) * next_position +
+           (theta3 - theta2) * h * next_velocity;
 }
 
-void main() {
-    if (any(greaterThanEqual(gl_GlobalInvocationID, constants.seed_dimensions))) {
-        return;
+// Samples of the dataset per step of the methods with a fixed time step
+uint get_samples_per_step() {
+    if (INTEGRATION_METHOD == INTEGRATION_METHOD_EULER) {
+        return 1u;
+    } else if (INTEGRATION_METHOD == INTEGRATION_METHOD_MIDPOINT) {
+        return 2u;
     }
+    return 4u;
+}
 
-    const uint seed_id =
-        gl_GlobalInvocationID.x +
-        gl_GlobalInvocationID.y * constants.seed_dimensions.x +
-        gl_GlobalInvocationID.z * constants.seed_dimensions.x * constants.seed_dimensions.y;
-    const uint line_buffer_offset = seed_id * (constants.total_step_count + 1) + constants.first_step;
+const float ADAPTIVE_SAFETY_FACTOR = 0.9f;
+const float ADAPTIVE_MIN_STEP_FACTOR = 0.2f; // Limits of the change of the step size after a step
+const float ADAPTIVE_MAX_STEP_FACTOR = 5.0f;
+const float ADAPTIVE_MIN_STEP = 1.0f / 1024.0f; // Relative to DT, a step of this size is accepted regardless of the error
+const uint ADAPTIVE_MAX_ATTEMPTS_PER_VERTEX = 64; // Bounds the duration of a batch, the particle continues in the next one
+
+// Integrates with the Adams-Bashforth-Moulton method, whose first three steps are Runge Kutta 4 steps, since the
+// multistep method needs the velocities of the three previous steps. The velocities are kept in registers during a
+// batch and in the particle state buffer between batches.
+void integrate_multistep(uint seed_id) {
+    const uint line_buffer_offset = seed_id * (TOTAL_STEP_COUNT + 1) + constants.first_step;
     const uint vertex_count = indirect_draw[seed_id].vertex_count;
 
-    vec3 position = vertices[seed_id * (constants.total_step_count + 1) + vertex_count - 1].xyz;
+    vec3 position = vertices[seed_id * (TOTAL_STEP_COUNT + 1) + vertex_count - 1].xyz;
+    float t = constants.first_step * DT;
+
+    // history[0] is the velocity at the position, history[i] the one i steps before, the first history_count are known
+    vec3 history[4];
+    uint history_count = 0;
+    uint sample_count_of_particle = 0;
+    if (constants.first_step > 0) {
+        const ParticleState state = particle_states[seed_id];
+        history[0] = state.velocity.xyz;
+        history[1] = state.history[0].xyz;
+        history[2] = state.history[1].xyz;
+        history[3] = state.history[2].xyz;
+        history_count = uint(state.velocity.w);
+    }
 
-    float t = constants.first_step * constants.dt;
-    for (uint s = 0; s < constants.step_count; ++s) {
+    uint s = 0;
+    for (; s < STEP_COUNT; ++s) {
         const vec4 sample_location = vec4(position, t);
 
-        if (any(lessThan(sample_location, vec4(0))) || any(greaterThan(sample_location, constants.dataset_dimensions - vec4(1.0)))) {
+        if (any(lessThan(sample_location, vec4(0))) || any(greaterThan(sample_location, DATASET_DIMENSIONS - vec4(1.0)))) {
             break;
         }
 
-        const vec3 velocity = rungekutta4(sample_location);
+        if (history_count == 0) {
+            history[0] = sample_dataset(sample_location);
+            history_count = 1;
+            sample_count_of_particle++;
+        }
+
+        vec3 velocity;
+        vec3 next_velocity;
+        if (history_count < 4) {
+            velocity = rungekutta4(sample_location, history[0]);
+            sample_count_of_particle += 3;
+        } else {
+            velocity = adams_bashforth_moulton(sample_location, history[0], history[1], history[2], history[3], next_velocity);
+            sample_count_of_particle++;
+        }
         const float velocity_magnitude = length(velocity);
 
-        atomicMax(max_velocity_magnitude, floatBitsToUint(velocity_magnitude));
+        count_velocity_magnitude(velocity_magnitude);
 
-        const vec3 next_position = position + constants.dt * velocity;
+        const vec3 next_position = position + DT * velocity;
         vertices[line_buffer_offset + s + 1] = vec4(next_position, velocity_magnitude);
         position = next_position;
-        t += constants.dt;
+        t += DT;
+
+        if (!SUBGROUP_COUNTERS) {
+            atomicAdd(indirect_draw[seed_id].vertex_count, 1);
+        }
+
+        // A Runge Kutta step does not sample the velocity at its end
+        if (history_count < 4) {
+            next_velocity = sample_dataset(vec4(position, t));
+            sample_count_of_particle++;
+        }
+        history[3] = history[2];
+        history[2] = history[1];
+        history[1] = history[0];
+        history[0] = next_velocity;
+        history_count = min(history_count + 1, 4u);
+    }
+
+    particle_states[seed_id].velocity = vec4(history[0], float(history_count));
+    particle_states[seed_id].history[0] = vec4(history[1], 0.0f);
+    particle_states[seed_id].history[1] = vec4(history[2], 0.0f);
+    particle_states[seed_id].history[2] = vec4(history[3], 0.0f);
+    if (SUBGROUP_COUNTERS) {
+        indirect_draw[seed_id].vertex_count = vertex_count + s;
+    }
+    count_samples(sample_count_of_particle);
+
+    if (s == STEP_COUNT) {
+        count_active_particle();
+    }
+}
+
+// Integrates with the adaptive Dormand-Prince method. The steps are independent of the vertices, which are resampled
+// from the steps at the times of the fixed method, so that vertex i is at time i * DT and the line buffer holds at most
+// TOTAL_STEP_COUNT + 1 vertices per particle. The state of the last accepted step is kept in the particle state buffer
+// between batches.
+void integrate_adaptive(uint seed_id) {
+    const uint line_buffer_offset = seed_id * (TOTAL_STEP_COUNT + 1);
+    const uint end_vertex = constants.first_step + STEP_COUNT + 1;
+    uint vertex_count = indirect_draw[seed_id].vertex_count;
+    uint sample_count_of_particle = 0;
+
+    vec3 position;
+    vec3 velocity;
+    float t;
+    float h;
+    if (constants.first_step == 0) {
+        position = vertices[line_buffer_offset].xyz;
+        t = 0.0f;
+        h = DT;
+        velocity = sample_dataset(vec4(position, t));
+        sample_count_of_particle++;
+    } else {
+        const ParticleState state = particle_states[seed_id];
+        position = state.position.xyz;
+        t = state.position.w;
+        velocity = state.velocity.xyz;
+        h = state.velocity.w;
+    }
+
+    // The last vertex of the batch, at which the state is stored for the next batch
+    const float batch_end_t = (end_vertex - 1) * DT;
+
+    for (uint attempt = 0; attempt < STEP_COUNT * ADAPTIVE_MAX_ATTEMPTS_PER_VERTEX && vertex_count < end_vertex && h > 0.0f; ++attempt) {
+        const vec4 sample_location = vec4(position, t);
+
+        // The last step ends at the last time slice of the dataset
+        float step_size = min(h, DATASET_DIMENSIONS.w - 1.0f - t);
+        if (step_size <= 0.0f || any(lessThan(sample_location, vec4(0))) || any(greaterThan(sample_location, DATASET_DIMENSIONS - vec4(1.0)))) {
+            h = 0.0f;
+            break;
+        }
+
+        // No step passes the last vertex of the batch, otherwise the vertices behind it would be skipped by the next
+        // batch. The proposed step size is kept, since the shortened step says nothing about it.
+        const bool reaches_batch_end = step_size >= batch_end_t - t;
+        if (reaches_batch_end) {
+            step_size = batch_end_t - t;
+        }
+
+        vec3 next_velocity;
+        float error;
+        const vec3 next_position = dormand_prince(sample_location, velocity, step_size, next_velocity, error);
+        sample_count_of_particle += 6;
+
+        const bool accepted = error <= 1.0f || step_size <= ADAPTIVE_MIN_STEP * DT;
+        if (accepted) {
+            // Every vertex whose time lies within the step is interpolated
+            const float next_t = reaches_batch_end ? batch_end_t : t + step_size;
+            while (vertex_count < end_vertex && vertex_count * DT <= next_t) {
+                const float theta = clamp((vertex_count * DT - t) / step_size, 0.0f, 1.0f);
+                const float velocity_magnitude = length(mix(velocity, next_velocity, theta));
+
+                count_velocity_magnitude(velocity_magnitude);
+                vertices[line_buffer_offset + vertex_count] = vec4(interpolate_step(position, velocity, next_position, next_velocity, step_size, theta), velocity_magnitude);
+                vertex_count++;
+            }
+
+            position = next_position;
+            velocity = next_velocity;
+            t = next_t;
+        }
+
+        const float factor = ADAPTIVE_SAFETY_FACTOR * pow(max(error, 1.0e-10f), -0.2f);
+        const float next_h = max(step_size * clamp(factor, ADAPTIVE_MIN_STEP_FACTOR, accepted ? ADAPTIVE_MAX_STEP_FACTOR : 1.0f), ADAPTIVE_MIN_STEP * DT);
+        h = accepted && reaches_batch_end ? max(next_h, h) : next_h;
+    }
+
+    particle_states[seed_id].position = vec4(position, t);
+    particle_states[seed_id].velocity = vec4(velocity, h);
+    indirect_draw[seed_id].vertex_count = vertex_count;
+    count_samples(sample_count_of_particle);
+
+    // A particle that ran out of attempts is still inside and continues in the next batch
+    if (h > 0.0f) {
+        count_active_particle();
+    }
+}
+
+uint get_seed_count() {
+    return constants.seed_dimensions.x * constants.seed_dimensions.y * constants.seed_dimensions.z;
+}
+
+// The seed of the particle of the invocation, valid is false if the grid of the invocations or the last work item
+// extends beyond the seeds
+uint get_seed_id(uint particle, out bool valid) {
+    if (WORK_QUEUE) {
+        const uint seed_id = work_item * PARTICLES_PER_INVOCATION + particle;
+        valid = seed_id < get_seed_count();
+        return seed_id;
+    }
+
+    uvec3 seed = gl_GlobalInvocationID;
+    seed.x += particle * gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+    valid = all(lessThan(seed, constants.seed_dimensions));
+
+    return seed.x + seed.y * constants.seed_dimensions.x + seed.z * constants.seed_dimensions.x * constants.seed_dimensions.y;
+}
+
+// Integrates the particles of the invocation with the Euler, midpoint or Runge Kutta 4 method. Every stage of a step is
+// evaluated for all particles before the next one, so that the texture fetches of the independent particles are in
+// flight together instead of forming a single dependent chain. All particles of a batch start at the same time.
+void integrate_fixed() {
+    uint seed_ids[PARTICLES_PER_INVOCATION];
+    bool valid[PARTICLES_PER_INVOCATION];
+    bool active[PARTICLES_PER_INVOCATION];
+    vec3 positions[PARTICLES_PER_INVOCATION];
+    uint vertex_counts[PARTICLES_PER_INVOCATION];
+    uint step_counts[PARTICLES_PER_INVOCATION];
+    for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+        seed_ids[p] = get_seed_id(p, valid[p]);
+        active[p] = valid[p];
+        positions[p] = vec3(0.0f);
+        vertex_counts[p] = 0;
+        step_counts[p] = 0;
+
+        if (valid[p]) {
+            vertex_counts[p] = indirect_draw[seed_ids[p]].vertex_count;
+            positions[p] = vertices[seed_ids[p] * (TOTAL_STEP_COUNT + 1) + vertex_counts[p] - 1].xyz;
+        }
+    }
+
+    float t = constants.first_step * DT;
+    for (uint s = 0; s < STEP_COUNT; ++s) {
+        bool any_active = false;
+        for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+            const vec4 sample_location = vec4(positions[p], t);
+            if (any(lessThan(sample_location, vec4(0))) || any(greaterThan(sample_location, DATASET_DIMENSIONS - vec4(1.0)))) {
+                active[p] = false;
+            }
+            any_active = any_active || active[p];
+        }
+        if (!any_active) {
+            break;
+        }
+
+        // Newton Method
+        vec3 v1[PARTICLES_PER_INVOCATION];
+        for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+            if (active[p]) {
+                v1[p] = sample_dataset(vec4(positions[p], t));
+            }
+        }
+
+        // Newton Midpoint Method / Modified Euler Method
+        vec3 v2[PARTICLES_PER_INVOCATION];
+        if (INTEGRATION_METHOD != INTEGRATION_METHOD_EULER) {
+            for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+                if (active[p]) {
+                    v2[p] = sample_dataset(vec4(positions[p], t) + vec4(v1[p] * 0.5f * DT, 0.5f * DT));
+                }
+            }
+        }
 
-        atomicAdd(indirect_draw[seed_id].vertex_count, 1);
+        // Runge Kutta 4th Order Method
+        vec3 v3[PARTICLES_PER_INVOCATION];
+        vec3 v4[PARTICLES_PER_INVOCATION];
+        if (INTEGRATION_METHOD == INTEGRATION_METHOD_RUNGE_KUTTA_4) {
+            for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+                if (active[p]) {
+                    v3[p] = sample_dataset(vec4(positions[p], t) + vec4(v2[p] * 0.5f * DT, 0.5f * DT));
+                }
+            }
+            for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+                if (active[p]) {
+                    v4[p] = sample_dataset(vec4(positions[p], t) + vec4(v3[p] * DT, DT));
+                }
+            }
+        }
+
+        for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+            if (!active[p]) {
+                continue;
+            }
+
+            vec3 velocity;
+            if (INTEGRATION_METHOD == INTEGRATION_METHOD_EULER) {
+                velocity = v1[p];
+            } else if (INTEGRATION_METHOD == INTEGRATION_METHOD_MIDPOINT) {
+                velocity = v2[p];
+            } else {
+                velocity = (v1[p] + 2 * v2[p] + 2 * v3[p] + v4[p]) / 6.0f;
+            }
+            const float velocity_magnitude = length(velocity);
+
+            count_velocity_magnitude(velocity_magnitude);
+
+            positions[p] += DT * velocity;
+            vertices[seed_ids[p] * (TOTAL_STEP_COUNT + 1) + constants.first_step + s + 1] = vec4(positions[p], velocity_magnitude);
+            step_counts[p]++;
+
+            if (!SUBGROUP_COUNTERS) {
+                atomicAdd(indirect_draw[seed_ids[p]].vertex_count, 1);
+            }
+        }
+        t += DT;
     }
+
+    for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+        if (!valid[p]) {
+            continue;
+        }
+
+        if (SUBGROUP_COUNTERS) {
+            indirect_draw[seed_ids[p]].vertex_count = vertex_counts[p] + step_counts[p];
+        }
+        count_samples(step_counts[p] * get_samples_per_step());
+
+        if (step_counts[p] == STEP_COUNT) {
+            count_active_particle();
+        }
+    }
+}
+
+// Integrates the particles of the invocation or of its current work item
+void integrate_particles() {
+    if (INTEGRATION_METHOD == INTEGRATION_METHOD_EULER || INTEGRATION_METHOD == INTEGRATION_METHOD_MIDPOINT || INTEGRATION_METHOD == INTEGRATION_METHOD_RUNGE_KUTTA_4) {
+        integrate_fixed();
+        return;
+    }
+
+    // The adaptive and the multistep method take different steps for every particle, so that the particles of the
+    // invocation are integrated one after another
+    for (uint p = 0; p < PARTICLES_PER_INVOCATION; ++p) {
+        bool valid;
+        const uint seed_id = get_seed_id(p, valid);
+        if (!valid) {
+            continue;
+        }
+
+        if (INTEGRATION_METHOD == INTEGRATION_METHOD_DORMAND_PRINCE) {
+            integrate_adaptive(seed_id);
+        } else {
+            integrate_multistep(seed_id);
+        }
+    }
+}
+
+void main() {
+    if (WORK_QUEUE) {
+        const uint work_item_count = (get_seed_count() + PARTICLES_PER_INVOCATION - 1) / PARTICLES_PER_INVOCATION;
+        for (work_item = atomicAdd(next_work_item, 1); work_item < work_item_count; work_item = atomicAdd(next_work_item, 1)) {
+            integrate_particles();
+        }
+    } else {
+        integrate_particles();
+    }
+
+    // No invocation returns early, since all of them take part in the reduction
+    commit_counters();
 }
\ No newline at end of file
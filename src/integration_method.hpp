@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Integration methods of integration.glsl
+enum class IntegrationMethod {
+    Euler,                 // integrate_fixed() with one stage
+    Midpoint,              // integrate_fixed() with two stages
+    RungeKutta4,           // integrate_fixed() with four stages
+    DormandPrince,         // dormand_prince() with an adaptive step size
+    AdamsBashforthMoulton, // adams_bashforth_moulton() after three rungekutta4() steps
+};
+
+inline const char* get_integration_method_name(IntegrationMethod method) {
+    switch (method) {
+        case IntegrationMethod::Euler:
+            return "euler";
+        case IntegrationMethod::Midpoint:
+            return "midpoint";
+        case IntegrationMethod::RungeKutta4:
+            return "rk4";
+        case IntegrationMethod::DormandPrince:
+            return "rk45";
+        case IntegrationMethod::AdamsBashforthMoulton:
+            return "abm4";
+    }
+    return "unknown";
+}
+
+// Velocity samples of a step of the methods that take a fixed number of them, like get_samples_per_step() in
+// integration.glsl
+inline std::optional<std::uint32_t> get_samples_per_step(IntegrationMethod method) {
+    switch (method) {
+        case IntegrationMethod::Euler:
+            return 1;
+        case IntegrationMethod::Midpoint:
+            return 2;
+        case IntegrationMethod::RungeKutta4:
+            return 4;
+        default:
+            return std::nullopt;
+    }
+}
+
+// The methods that keep a state between the steps besides the position are only implemented in integration.glsl
+inline bool is_gpu_only_integration_method(IntegrationMethod method) {
+    return method == IntegrationMethod::DormandPrince || method == IntegrationMethod::AdamsBashforthMoulton;
+}
+
+inline std::optional<IntegrationMethod> parse_integration_method(std::string_view name) {
+    for (IntegrationMethod method : {IntegrationMethod::Euler, IntegrationMethod::Midpoint, IntegrationMethod::RungeKutta4, IntegrationMethod::DormandPrince, IntegrationMethod::AdamsBashforthMoulton}) {
+        if (name == get_integration_method_name(method)) {
+            return method;
+        }
+    }
+    return std::nullopt;
+}
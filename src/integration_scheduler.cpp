@@ -0,0 +1,115 @@
+#include "integration_scheduler.hpp"
+#include "timeline_semaphore.hpp"
+#include <liblava/util/log.hpp>
+
+bool IntegrationScheduler::create(lava::device_p device, const lava::queue& queue) {
+    this->device = device;
+    this->queue = queue.vk_queue;
+    this->semaphore = create_timeline_semaphore(device, 0);
+    this->submitted_value = 0;
+    this->completed_value = 0;
+
+    return this->is_available();
+}
+
+void IntegrationScheduler::destroy() {
+    if (this->semaphore != VK_NULL_HANDLE) {
+        destroy_timeline_semaphore(this->device, this->semaphore);
+        this->semaphore = VK_NULL_HANDLE;
+    }
+}
+
+std::optional<std::uint64_t> IntegrationScheduler::submit(VkCommandBuffer command_buffer) {
+    const std::uint64_t signal_value = this->submitted_value + 1;
+
+    const VkTimelineSemaphoreSubmitInfoKHR timeline_info{
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = nullptr,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = nullptr,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signal_value,
+    };
+    const VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &command_buffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &this->semaphore,
+    };
+
+    if (vkQueueSubmit(this->queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        lava::log()->error("can't submit command buffer!");
+        return std::nullopt;
+    }
+    this->submitted_value = signal_value;
+
+    return signal_value;
+}
+
+bool IntegrationScheduler::wait(std::uint64_t value) {
+    while (this->completed_value < value) {
+        const std::optional<std::uint64_t> counter_value = wait_timeline_semaphore(this->device, this->semaphore, value, UINT64_MAX);
+        if (!counter_value.has_value()) {
+            return false;
+        }
+        this->completed_value = counter_value.value();
+    }
+
+    return true;
+}
+
+bool IntegrationScheduler::wait_idle() {
+    return this->wait(this->submitted_value);
+}
+
+bool IntegrationScheduler::continue_at_batch_boundary() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->state_changed.wait(lock, [this]() { return this->state != State::Paused || this->interrupted; });
+
+    return this->state != State::Cancelled && !this->interrupted;
+}
+
+void IntegrationScheduler::pause() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->state == State::Running) {
+        this->state = State::Paused;
+    }
+}
+
+void IntegrationScheduler::resume() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->state == State::Paused) {
+            this->state = State::Running;
+        }
+    }
+    this->state_changed.notify_all();
+}
+
+void IntegrationScheduler::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->state = State::Cancelled;
+    }
+    this->state_changed.notify_all();
+}
+
+void IntegrationScheduler::interrupt() {
+    this->interrupted = true;
+}
+
+void IntegrationScheduler::reset() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->state = State::Running;
+    this->interrupted = false;
+}
+
+IntegrationScheduler::State IntegrationScheduler::get_state() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->interrupted ? State::Cancelled : this->state;
+}
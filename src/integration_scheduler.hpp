@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <liblava/base/device.hpp>
+#include <mutex>
+#include <optional>
+#include <vulkan/vulkan_core.h>
+
+// Submits the command buffers of the integrations to the compute queue and tracks their completion with a timeline
+// semaphore, whose value counts the submissions. Waiting for a submission sleeps until the GPU signals it instead of
+// polling a fence. The integration thread asks the scheduler at every batch boundary whether it may continue, so that
+// another thread can pause or cancel a run without waiting for its remaining batches.
+class IntegrationScheduler {
+  public:
+    enum class State {
+        Running,
+        Paused,
+        Cancelled,
+    };
+
+    // Without timeline semaphores, submit() and wait() are not available, but a run can still be paused and cancelled
+    bool create(lava::device_p device, const lava::queue& queue);
+    void destroy();
+    bool is_available() const { return this->semaphore != VK_NULL_HANDLE; }
+
+    // Returns the value that the semaphore reaches once the command buffer has completed
+    std::optional<std::uint64_t> submit(VkCommandBuffer command_buffer);
+    bool wait(std::uint64_t value);
+    bool wait_idle();
+
+    // Blocks while the run is paused. Returns false if the run has been cancelled.
+    bool continue_at_batch_boundary();
+
+    void pause();
+    void resume();
+    void cancel();
+    // Only stores the cancellation, so that it can be called from a signal handler
+    void interrupt();
+    // Allows the next run after a cancellation
+    void reset();
+    State get_state() const;
+
+  private:
+    lava::device_p device;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    std::uint64_t submitted_value = 0;
+    std::uint64_t completed_value = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable state_changed;
+    State state = State::Running;
+    std::atomic<bool> interrupted = false;
+};
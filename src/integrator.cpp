@@ -2,13 +2,18 @@
 #include "queues.hpp"
 #include "shaders.hpp"
 #include "time_slices.hpp"
+#include "trajectory_file.hpp"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstddef>
+#include <cstring>
 #include <glm/gtx/string_cast.hpp>
 #include <imgui.h>
 #include <liblava/app.hpp>
 #include <spdlog/fmt/bundled/core.h>
 #include <spdlog/fmt/bundled/ostream.h>
+#include <vector>
 #include <vulkan/vulkan_core.h>
 
 struct Constants {
@@ -18,56 +23,232 @@ struct Constants {
     glm::uint total_step_count;
     glm::uint first_step;
     glm::uint step_count;
+    float absolute_tolerance;
+    float relative_tolerance;
+};
+
+// Host visible buffer that the integration shader reports to
+struct IntegrationStatistics {
+    float max_velocity_magnitude;
+    glm::uint active_particle_count; // Particles that are still inside the dataset after the last batch
+    glm::uint sample_count_low;      // Velocity samples of the last batch, of all batches with a single submission
+    glm::uint sample_count_high;
+
+    std::uint64_t get_sample_count() const {
+        return (std::uint64_t(this->sample_count_high) << 32) | this->sample_count_low;
+    }
+};
+
+// The state of a particle between the batches of the adaptive and the multistep method, see integration.glsl
+struct ParticleState {
+    glm::vec4 position;
+    glm::vec4 velocity;
+    std::array<glm::vec4, 3> history;
 };
 
 constexpr std::uint32_t LINE_BUFFER_BINDING = 0;
 constexpr std::uint32_t MAX_VELOCITY_MAGNITUDE_BUFFER_BINDING = 1;
 constexpr std::uint32_t INDIRECT_BUFFER_BINDING = 2;
 constexpr std::uint32_t DATASET_BINDING_BASE = 3;
+constexpr std::uint32_t PARTICLE_STATE_BUFFER_BINDING = 6; // After the dataset bindings of all formats
+constexpr std::uint32_t WORK_QUEUE_BUFFER_BINDING = 7;
 constexpr std::uint32_t WORK_GROUP_SIZE_X_CONSTANT_ID = 0;
 constexpr std::uint32_t WORK_GROUP_SIZE_Y_CONSTANT_ID = 1;
 constexpr std::uint32_t WORK_GROUP_SIZE_Z_CONSTANT_ID = 2;
 constexpr std::uint32_t TIME_STEPS_CONSTANT_ID = 3;
 constexpr std::uint32_t EXPLICIT_INTERPOLATION_ID = 4;
+constexpr std::uint32_t INTEGRATION_METHOD_ID = 5;
+constexpr std::uint32_t CUBIC_INTERPOLATION_ID = 6;
+constexpr std::uint32_t PARTICLES_PER_INVOCATION_ID = 7;
+constexpr std::uint32_t SUBGROUP_COUNTERS_ID = 8;
+constexpr std::uint32_t WORK_QUEUE_ID = 9;
+constexpr std::uint32_t DEFAULT_COMPUTE_UNIT_COUNT = 64; // If the device does not report its compute units
+constexpr double ADAPTIVE_BATCH_MAX_GROWTH = 4.0; // The timestamps of very short batches are dominated by the overhead
+constexpr std::uint32_t BATCHES_PER_COMMAND_BUFFER = 16; // The progress is signaled after every command buffer
+constexpr std::uint32_t MAX_SUBMISSIONS_IN_FLIGHT = 2;   // The next command buffer is queued behind the running one
+namespace {
+
+// The subgroup properties are core in Vulkan 1.1, nothing on older devices
+std::optional<VkPhysicalDeviceSubgroupProperties> get_subgroup_properties(lava::device_p device) {
+    if (device->get_properties().apiVersion < VK_API_VERSION_1_1 || vkGetPhysicalDeviceProperties2 == nullptr) {
+        return std::nullopt;
+    }
+
+    VkPhysicalDeviceSubgroupProperties subgroup_properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &subgroup_properties,
+    };
+    vkGetPhysicalDeviceProperties2(device->get_physical_device()->get(), &properties);
+
+    return subgroup_properties;
+}
+
+// The reduction of the statistics needs the arithmetic subgroup operations in compute shaders
+bool is_subgroup_arithmetic_supported(lava::device_p device) {
+    const std::optional<VkPhysicalDeviceSubgroupProperties> subgroup_properties = get_subgroup_properties(device);
+    if (!subgroup_properties.has_value()) {
+        return false;
+    }
+
+    const VkSubgroupFeatureFlags required_operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    return (subgroup_properties->supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0 && (subgroup_properties->supportedOperations & required_operations) == required_operations;
+}
+
+// The number of compute units (AMD) or streaming multiprocessors (NVIDIA), which only the extensions of the vendors report
+std::optional<std::uint32_t> get_compute_unit_count(lava::device_p device) {
+    if (device->get_properties().apiVersion < VK_API_VERSION_1_1 || vkGetPhysicalDeviceProperties2 == nullptr) {
+        return std::nullopt;
+    }
+
+    const VkPhysicalDevice physical_device = device->get_physical_device()->get();
+    std::uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+
+    const auto is_supported = [&](const char* name) {
+        return std::any_of(extensions.begin(), extensions.end(), [&](const VkExtensionProperties& extension) {
+            return std::strcmp(extension.extensionName, name) == 0;
+        });
+    };
+
+    if (is_supported(VK_AMD_SHADER_CORE_PROPERTIES_EXTENSION_NAME)) {
+        VkPhysicalDeviceShaderCorePropertiesAMD core_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CORE_PROPERTIES_AMD,
+        };
+        VkPhysicalDeviceProperties2 properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &core_properties,
+        };
+        vkGetPhysicalDeviceProperties2(physical_device, &properties);
+        return core_properties.shaderEngineCount * core_properties.shaderArraysPerEngineCount * core_properties.computeUnitsPerShaderArray;
+    }
+
+    if (is_supported(VK_NV_SHADER_SM_BUILTINS_EXTENSION_NAME)) {
+        VkPhysicalDeviceShaderSMBuiltinsPropertiesNV sm_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_SM_BUILTINS_PROPERTIES_NV,
+        };
+        VkPhysicalDeviceProperties2 properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &sm_properties,
+        };
+        vkGetPhysicalDeviceProperties2(physical_device, &properties);
+        return sm_properties.shaderSMCount;
+    }
+
+    return std::nullopt;
+}
+
+// Scales the next batch so that its dispatch takes target_duration ms. The duration of a step is proportional to the
+// number of particles that are still inside the dataset, so the cost of a single particle step is estimated from the
+// last batch with the mean of the active particles before and after it.
+unsigned int compute_adaptive_batch_size(double target_duration, double last_duration, unsigned int last_batch_size, unsigned int first_particle_count, unsigned int last_particle_count) {
+    const double mean_particle_count = 0.5 * (double(first_particle_count) + double(last_particle_count));
+    const double max_batch_size = ADAPTIVE_BATCH_MAX_GROWTH * last_batch_size;
+
+    if (last_duration <= 0.0 || mean_particle_count <= 0.0) {
+        return unsigned(max_batch_size);
+    }
+
+    const double step_cost = last_duration / (double(last_batch_size) * mean_particle_count);
+    const double batch_size = std::floor(target_duration / (step_cost * last_particle_count));
+
+    return unsigned(std::clamp(batch_size, 1.0, max_batch_size));
+}
+
+} // namespace
 
 Integrator::Integrator() {
     this->download_file_name.fill('\0');
 }
 
 bool Integrator::create(lava::app& app) {
-    if (!this->command_parser.parse_commands(app.get_cmd_line())) {
+    this->app = &app;
+    return this->create(app.device, app.get_cmd_line());
+}
+
+bool Integrator::create(lava::device_p device, const argh::parser& cmd_line) {
+    if (!this->command_parser.parse_commands(cmd_line)) {
         return false;
     }
 
     this->work_group_size.x = this->command_parser.get_work_group_size_x().value_or(this->work_group_size.x);
     this->work_group_size.y = this->command_parser.get_work_group_size_y().value_or(this->work_group_size.y);
     this->work_group_size.z = this->command_parser.get_work_group_size_z().value_or(this->work_group_size.z);
+    this->particles_per_invocation = this->command_parser.get_particles_per_invocation().value_or(this->particles_per_invocation);
     this->seed_spawn.x = this->command_parser.get_seed_dimensions_x().value_or(this->seed_spawn.x);
     this->seed_spawn.y = this->command_parser.get_seed_dimensions_y().value_or(this->seed_spawn.y);
     this->seed_spawn.z = this->command_parser.get_seed_dimensions_z().value_or(this->seed_spawn.z);
     this->integration_steps = this->command_parser.get_integration_steps().value_or(this->integration_steps);
     this->batch_size = this->command_parser.get_batch_size().value_or(this->batch_size);
+    this->adaptive_batch_size = this->command_parser.get_batch_duration().has_value();
+    this->batch_duration = this->command_parser.get_batch_duration().value_or(this->batch_duration);
+    this->single_submission = this->command_parser.use_single_submission().value_or(this->single_submission);
     this->delta_time = this->command_parser.get_delta_time().value_or(this->delta_time);
     this->explicit_interpolation = this->command_parser.use_explicit_interpolation().value_or(this->explicit_interpolation);
+    this->cubic_interpolation = this->command_parser.use_cubic_interpolation().value_or(this->cubic_interpolation);
+    this->integration_method = this->command_parser.get_integration_method().value_or(this->integration_method);
+    this->absolute_tolerance = this->command_parser.get_absolute_tolerance().value_or(this->absolute_tolerance);
+    this->relative_tolerance = this->command_parser.get_relative_tolerance().value_or(this->relative_tolerance);
+    this->specialized_kernel = this->command_parser.use_kernel_specialization().value_or(this->specialized_kernel);
     this->analytic_dataset = this->command_parser.use_analytic_dataset().value_or(this->analytic_dataset);
+    this->subgroup_counters = this->command_parser.use_subgroup_counters().value_or(this->subgroup_counters);
+    this->work_queue = this->command_parser.use_work_queue().value_or(this->work_queue);
     this->repetitions_remaining = this->command_parser.get_repetition_count().value_or(0);
 
-    const auto& queues = app.device->queues();
+    const auto& queues = device->queues();
     this->compute_queue = queues[queue_indices::COMPUTE];
-    this->device = app.device;
-    this->app = &app;
+    this->device = device;
+
+    this->subgroup_counters_supported = is_subgroup_arithmetic_supported(device);
+    if (this->subgroup_counters && !this->subgroup_counters_supported) {
+        if (this->command_parser.use_subgroup_counters().has_value()) {
+            lava::log()->warn("the device does not support subgroup arithmetic in compute shaders, the counters are updated with atomics");
+        }
+        this->subgroup_counters = false;
+    }
+
+    this->persistent_work_group_count = this->command_parser.get_persistent_work_groups().value_or(0);
+    this->compute_unit_count = get_compute_unit_count(device).value_or(0);
+    if (this->compute_unit_count == 0) {
+        this->compute_unit_count = DEFAULT_COMPUTE_UNIT_COUNT;
+    }
+    this->subgroup_size = std::max(get_subgroup_properties(device).value_or(VkPhysicalDeviceSubgroupProperties{}).subgroupSize, 1u);
+    lava::log()->debug("{} compute units with subgroups of {} invocations for the persistent work groups", this->compute_unit_count, this->subgroup_size);
+
+    if (!this->pipeline_cache.create(device, this->command_parser.get_pipeline_cache().value_or(PipelineCache::get_default_path(device)))) {
+        return false;
+    }
+
+    this->kernel_compiler.create(this->command_parser.get_kernel_cache().value_or(KernelCompiler::DEFAULT_DIRECTORY));
+
+    // The cached optima are applied when a dataset is set, since they depend on its format and dimensions
+    if (!this->autotune_cache.load(this->command_parser.get_autotune_cache().value_or(AutotuneCache::DEFAULT_PATH))) {
+        return false;
+    }
+
+    if (this->single_submission && this->adaptive_batch_size) {
+        lava::log()->warn("the batch size is not adaptive with a single submission, since all batches are recorded in advance");
+    }
+
+    if (!this->scheduler.create(device, this->compute_queue)) {
+        lava::log()->debug("timeline semaphores are not available, waiting for fences instead");
+    }
 
     return this->create_command_pool() &&
-           this->create_query_pool() &&
-           this->create_max_velocity_magnitude_buffer();
+           this->create_query_pool(2) &&
+           this->create_max_velocity_magnitude_buffer() &&
+           this->create_work_queue_buffer();
 
     return true;
 }
 
 void Integrator::destroy() {
-    if (this->integration_thread.joinable()) {
-        this->integration_thread.join();
-    }
+    this->cancel_integration_thread();
+    this->wait_for_pipeline_prewarm();
 
     this->destroy_integration();
     this->destroy_render_pipeline();
@@ -82,11 +263,18 @@ void Integrator::destroy() {
     if (this->query_pool) {
         this->device->call().vkDestroyQueryPool(this->device->get(), this->query_pool, nullptr);
         this->query_pool = VK_NULL_HANDLE;
+        this->query_count = 0;
     }
+    this->scheduler.destroy();
+    this->pipeline_cache.destroy();
     if (this->max_velocity_magnitude_buffer) {
         this->max_velocity_magnitude_buffer->destroy();
         this->max_velocity_magnitude_buffer = nullptr;
     }
+    if (this->work_queue_buffer) {
+        this->work_queue_buffer->destroy();
+        this->work_queue_buffer = nullptr;
+    }
 }
 
 void Integrator::render(VkCommandBuffer command_buffer) {
@@ -120,6 +308,9 @@ void Integrator::render(VkCommandBuffer command_buffer) {
 }
 
 void Integrator::set_dataset(Dataset::Ptr dataset) {
+    // The integration of the previous dataset is abandoned
+    this->cancel_integration_thread();
+    this->wait_for_pipeline_prewarm();
     this->log_file.close();
     this->run = 0;
     this->destroy_integration();
@@ -131,6 +322,7 @@ void Integrator::set_dataset(Dataset::Ptr dataset) {
 
     if (this->dataset) {
         this->create_descriptor();
+        this->write_dataset_to_descriptor();
 
         const auto dimensions = this->dataset->data->dimensions;
         this->scaling = 1.0f / std::max(dimensions.x, std::max(dimensions.y, dimensions.z));
@@ -142,6 +334,106 @@ void Integrator::set_dataset(Dataset::Ptr dataset) {
         else {
             this->delta_time = (float)this->dataset->data->dimensions.w / (float)this->integration_steps;
         }
+
+        this->apply_autotune_result();
+        this->prewarm_pipelines();
+    }
+}
+
+void Integrator::prewarm_pipelines() {
+    // The pipelines of the current work group size with both interpolations and the analytic dataset, as well as all
+    // pipelines of a parameter sweep
+    PipelineVariant dataset_variant = this->get_pipeline_variant();
+    dataset_variant.analytic_dataset = false;
+    std::vector<PipelineVariant> integration_variants = {dataset_variant};
+    dataset_variant.explicit_interpolation = !dataset_variant.explicit_interpolation;
+    integration_variants.push_back(dataset_variant);
+    if (this->command_parser.get_sweep_grid().has_value()) {
+        for (const IntegrationSettings& settings : this->command_parser.get_sweep_grid()->get_configurations(this->get_settings(), this->device->get_properties().limits)) {
+            integration_variants.push_back({
+                .work_group_size = settings.work_group_size,
+                .particles_per_invocation = settings.particles_per_invocation,
+                .explicit_interpolation = settings.explicit_interpolation,
+                .cubic_interpolation = settings.cubic_interpolation,
+                .integration_method = settings.integration_method,
+                .analytic_dataset = false,
+                .subgroup_counters = settings.subgroup_counters && this->subgroup_counters_supported,
+                .work_queue = settings.work_queue,
+            });
+        }
+    }
+
+    std::vector<glm::uvec3> seeding_variants;
+    std::vector<PipelineVariant> variants;
+    for (const PipelineVariant& variant : integration_variants) {
+        if (std::find(variants.begin(), variants.end(), variant) == variants.end()) {
+            variants.push_back(variant);
+        }
+        if (std::find(seeding_variants.begin(), seeding_variants.end(), variant.work_group_size) == seeding_variants.end()) {
+            seeding_variants.push_back(variant.work_group_size);
+        }
+    }
+    variants.push_back({
+        .work_group_size = this->work_group_size,
+        .particles_per_invocation = this->particles_per_invocation,
+        .explicit_interpolation = false,
+        .cubic_interpolation = false,
+        .integration_method = this->integration_method,
+        .analytic_dataset = true,
+        .subgroup_counters = this->subgroup_counters,
+        .work_queue = this->work_queue,
+    });
+
+    // The specialized kernel depends on the settings of the next run, only the one of the current settings is compiled
+    const std::optional<KernelSpecialization> specialization = this->get_kernel_specialization();
+
+    // The layouts of the pipelines only differ in their handles
+    this->prewarm_pipeline_layout = lava::pipeline_layout::make();
+    this->prewarm_pipeline_layout->add(this->descriptor);
+    this->prewarm_pipeline_layout->add_push_constant_range({VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants)});
+    if (!this->prewarm_pipeline_layout->create(this->device)) {
+        lava::log()->warn("failed to create pipeline layout for pre-warming");
+        this->prewarm_pipeline_layout = nullptr;
+        return;
+    }
+
+    const std::size_t pipeline_count = variants.size() + seeding_variants.size() + (specialization.has_value() ? 1 : 0);
+    if (!this->prewarm_pool) {
+        this->prewarm_pool = std::make_unique<ThreadPool>(std::max(std::thread::hardware_concurrency() / 2, 1u));
+    }
+    lava::log()->debug("pre-warm {} pipelines on {} threads", pipeline_count, this->prewarm_pool->get_thread_count());
+
+    // The pipelines are only created to fill the pipeline cache, which is internally synchronized
+    for (const PipelineVariant& variant : variants) {
+        this->prewarm_pool->submit([this, variant]() {
+            if (lava::compute_pipeline::ptr pipeline = this->make_integration_pipeline(this->prewarm_pipeline_layout, variant, std::nullopt)) {
+                pipeline->destroy();
+            }
+        });
+    }
+    if (specialization.has_value()) {
+        this->prewarm_pool->submit([this, variant = this->get_pipeline_variant(), specialization]() {
+            if (lava::compute_pipeline::ptr pipeline = this->make_integration_pipeline(this->prewarm_pipeline_layout, variant, specialization)) {
+                pipeline->destroy();
+            }
+        });
+    }
+    for (const glm::uvec3& work_group_size : seeding_variants) {
+        this->prewarm_pool->submit([this, work_group_size]() {
+            if (lava::compute_pipeline::ptr pipeline = this->make_seeding_pipeline(this->prewarm_pipeline_layout, work_group_size)) {
+                pipeline->destroy();
+            }
+        });
+    }
+}
+
+void Integrator::wait_for_pipeline_prewarm() {
+    if (this->prewarm_pool) {
+        this->prewarm_pool->wait();
+    }
+    if (this->prewarm_pipeline_layout) {
+        this->prewarm_pipeline_layout->destroy();
+        this->prewarm_pipeline_layout = nullptr;
     }
 }
 
@@ -178,10 +470,14 @@ bool Integrator::check_for_integration() {
             this->repetitions_remaining--;
         }
         
+        if (this->integration_thread.joinable()) {
+            this->integration_thread.join();
+        }
+
+        // A cancellation only applies to the run that was in progress
+        this->scheduler.reset();
+
         if (this->prepare_integration()) {
-            if (this->integration_thread.joinable()) {
-                this->integration_thread.join();
-            }
             this->integration_thread = std::thread(&Integrator::integrate, this);
         }
     }
@@ -189,11 +485,40 @@ bool Integrator::check_for_integration() {
     return true;
 }
 
+void Integrator::cancel_integration_thread() {
+    if (this->integration_thread.joinable()) {
+        this->scheduler.cancel();
+        this->integration_thread.join();
+        this->scheduler.reset();
+    }
+}
+
 void Integrator::imgui() {
     if (ImGui::DragInt3("Work Group Size", reinterpret_cast<int*>(glm::value_ptr(this->work_group_size)))) {
+        this->recreate_seeding_pipeline = true;
+        this->recreate_integration_pipeline = true;
+        this->log_file.close();
+    }
+    if (ImGui::SliderInt("Particles per Invocation", reinterpret_cast<int*>(&this->particles_per_invocation), 1, 8)) {
+        this->recreate_integration_pipeline = true;
+        this->log_file.close();
+    }
+    ImGui::BeginDisabled(!this->subgroup_counters_supported);
+    if (ImGui::Checkbox("Subgroup Counters", &this->subgroup_counters)) {
         this->recreate_integration_pipeline = true;
         this->log_file.close();
     }
+    ImGui::EndDisabled();
+    if (ImGui::Checkbox("Work Queue", &this->work_queue)) {
+        this->recreate_integration_pipeline = true;
+        this->log_file.close();
+    }
+    if (this->work_queue) {
+        // 0 selects at least a subgroup of invocations per compute unit
+        if (ImGui::DragInt("Persistent Work Groups", reinterpret_cast<int*>(&this->persistent_work_group_count), 1.0f, 0, 65535)) {
+            this->log_file.close();
+        }
+    }
     if (ImGui::DragInt3("Seed Dimensions", reinterpret_cast<int*>(glm::value_ptr(this->seed_spawn)))) {
         this->log_file.close();
     }
@@ -203,13 +528,47 @@ void Integrator::imgui() {
             this->delta_time = (float)this->dataset->data->dimensions.w / (float)this->integration_steps;
         }
     }
-    if (ImGui::DragInt("Batch Size", reinterpret_cast<int*>(&this->batch_size))) {
+    if (ImGui::DragInt(this->adaptive_batch_size ? "First Batch Size" : "Batch Size", reinterpret_cast<int*>(&this->batch_size))) {
         this->log_file.close();
     }
+    if (ImGui::Checkbox("Single Submission", &this->single_submission)) {
+        this->log_file.close();
+    }
+    ImGui::BeginDisabled(this->single_submission);
+    if (ImGui::Checkbox("Adaptive Batch Size", &this->adaptive_batch_size)) {
+        this->log_file.close();
+    }
+    if (this->adaptive_batch_size) {
+        if (ImGui::DragFloat("Batch Duration (ms)", &this->batch_duration, 1.0f, 1.0f, 1000.0f)) {
+            this->log_file.close();
+        }
+    }
+    ImGui::EndDisabled();
     if (ImGui::DragFloat("Delta Time", &this->delta_time, 0.001f, 0.0f)) {
         this->log_file.close();
     }
 
+    // The methods in the order of IntegrationMethod
+    const std::array<const char*, 5> integration_method_names = {"Euler", "Midpoint", "Runge-Kutta 4", "Dormand-Prince 5(4)", "Adams-Bashforth-Moulton 4"};
+    int integration_method = static_cast<int>(this->integration_method);
+    if (ImGui::Combo("Method", &integration_method, integration_method_names.data(), integration_method_names.size())) {
+        this->integration_method = static_cast<IntegrationMethod>(integration_method);
+        this->recreate_integration_pipeline = true;
+        this->log_file.close();
+    }
+    if (this->integration_method == IntegrationMethod::DormandPrince) {
+        if (ImGui::DragFloat("Tolerance", &this->absolute_tolerance, 1.0e-5f, 1.0e-7f, 1.0f, "%.2e")) {
+            this->log_file.close();
+        }
+        if (ImGui::DragFloat("Relative Tolerance", &this->relative_tolerance, 1.0e-6f, 0.0f, 1.0f, "%.2e")) {
+            this->log_file.close();
+        }
+    }
+
+    if (ImGui::Checkbox("Specialized Kernel", &this->specialized_kernel)) {
+        this->log_file.close();
+    }
+
     if (ImGui::Checkbox("Analytic Dataset", &this->analytic_dataset)) {
         this->recreate_integration_pipeline = true;
         this->log_file.close();
@@ -220,14 +579,41 @@ void Integrator::imgui() {
             this->recreate_integration_pipeline = true;
             this->log_file.close();
         }
+        if (ImGui::Checkbox("Cubic Interpolation", &this->cubic_interpolation)) {
+            this->recreate_integration_pipeline = true;
+            this->log_file.close();
+        }
     }
 
-    ImGui::BeginDisabled(!this->dataset || this->integration_in_progress());
-    if (ImGui::Button("Integrate")) {
+    // While an integration is in progress, the next one is queued and starts as soon as the current one is complete
+    ImGui::BeginDisabled(!this->dataset || this->should_integrate);
+    if (ImGui::Button(this->integration_in_progress() ? "Queue Integration" : "Integrate")) {
         this->should_integrate = true;
     }
     ImGui::EndDisabled();
 
+    if (this->integration_in_progress()) {
+        const IntegrationScheduler::State state = this->scheduler.get_state();
+
+        ImGui::SameLine();
+        ImGui::BeginDisabled(state == IntegrationScheduler::State::Cancelled);
+        if (state == IntegrationScheduler::State::Paused) {
+            if (ImGui::Button("Resume")) {
+                this->scheduler.resume();
+            }
+        } else if (ImGui::Button("Pause")) {
+            this->scheduler.pause();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            this->scheduler.cancel();
+        }
+        ImGui::EndDisabled();
+    }
+    if (this->should_integrate && this->integration_in_progress()) {
+        ImGui::Text("Next integration queued");
+    }
+
     ImGui::InputText("File Name", this->download_file_name.data(), this->download_file_name.size());
 
     ImGui::BeginDisabled(!this->integration.has_value() || this->download_file_name.empty());
@@ -280,13 +666,23 @@ void Integrator::imgui() {
 
 bool Integrator::create_max_velocity_magnitude_buffer() {
     this->max_velocity_magnitude_buffer = lava::buffer::make();
-    this->max_velocity_magnitude_buffer->create_mapped(this->device, nullptr, 4, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    this->max_velocity_magnitude_buffer->create_mapped(this->device, nullptr, sizeof(IntegrationStatistics), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
 
     if (this->max_velocity_magnitude_buffer->get_mapped_data() == nullptr) {
         lava::log()->error("failed to map data of progress buffer");
         return false;
     }
-    memset(this->max_velocity_magnitude_buffer->get_mapped_data(), 0, 4);
+    memset(this->max_velocity_magnitude_buffer->get_mapped_data(), 0, sizeof(IntegrationStatistics));
+
+    return true;
+}
+
+bool Integrator::create_work_queue_buffer() {
+    this->work_queue_buffer = lava::buffer::make();
+    if (!this->work_queue_buffer->create_mapped(this->device, nullptr, sizeof(glm::uint), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) {
+        lava::log()->error("failed to create work queue buffer");
+        return false;
+    }
 
     return true;
 }
@@ -304,17 +700,24 @@ bool Integrator::create_command_pool() {
     return true;
 }
 
-bool Integrator::create_query_pool() {
+bool Integrator::create_query_pool(std::uint32_t query_count) {
+    if (this->query_pool) {
+        this->device->call().vkDestroyQueryPool(this->device->get(), this->query_pool, nullptr);
+        this->query_pool = VK_NULL_HANDLE;
+        this->query_count = 0;
+    }
+
     VkQueryPoolCreateInfo query_pool_create{
         .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
         .queryType = VK_QUERY_TYPE_TIMESTAMP,
-        .queryCount = 2,
+        .queryCount = query_count,
 
     };
     if (this->device->call().vkCreateQueryPool(this->device->get(), &query_pool_create, nullptr, &this->query_pool) != VK_SUCCESS) {
         lava::log()->error("failed to create query pool");
         return false;
     }
+    this->query_count = query_count;
 
     return true;
 }
@@ -325,6 +728,8 @@ bool Integrator::create_descriptor() {
     this->descriptor->add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
     this->descriptor->add_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
     this->descriptor->add_binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    this->descriptor->add_binding(PARTICLE_STATE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+    this->descriptor->add_binding(WORK_QUEUE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
     for (int i = 0; i < this->dataset->data->channel_count; ++i) {
         lava::descriptor::binding::ptr dataset_binding = lava::descriptor::binding::make(3 + i);
         dataset_binding->set_type(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
@@ -340,7 +745,7 @@ bool Integrator::create_descriptor() {
     this->descriptor_pool = lava::descriptor::pool::make();
     if (!descriptor_pool->create(device, {
                                              {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TIME_SLICES * this->dataset->data->channel_count},
-                                             {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+                                             {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5},
                                          },
                                  1)) {
         lava::log()->error("failed to create descriptor pool for integration");
@@ -354,14 +759,29 @@ bool Integrator::create_descriptor() {
         .offset = 0,
         .range = VK_WHOLE_SIZE,
     };
-    this->device->vkUpdateDescriptorSets({{
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = this->descriptor_set,
-        .dstBinding = MAX_VELOCITY_MAGNITUDE_BUFFER_BINDING,
-        .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-        .pBufferInfo = &max_velocity_magnitude_buffer_info,
-    }});
+    const VkDescriptorBufferInfo work_queue_buffer_info{
+        .buffer = this->work_queue_buffer->get(),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+    this->device->vkUpdateDescriptorSets({
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = this->descriptor_set,
+            .dstBinding = MAX_VELOCITY_MAGNITUDE_BUFFER_BINDING,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &max_velocity_magnitude_buffer_info,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = this->descriptor_set,
+            .dstBinding = WORK_QUEUE_BUFFER_BINDING,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &work_queue_buffer_info,
+        },
+    });
 
     return true;
 }
@@ -390,7 +810,7 @@ bool Integrator::create_render_pipeline() {
         return false;
     }
 
-    this->render_pipeline = lava::render_pipeline::make(device, app->pipeline_cache);
+    this->render_pipeline = lava::render_pipeline::make(device, this->pipeline_cache.get());
     this->render_pipeline->set_rasterization_polygon_mode(VK_POLYGON_MODE_LINE);
     this->render_pipeline->set_input_topology(VK_PRIMITIVE_TOPOLOGY_LINE_STRIP);
     this->render_pipeline->add_dynamic_state(VK_DYNAMIC_STATE_LINE_WIDTH);
@@ -450,10 +870,16 @@ bool Integrator::create_seeding_pipeline() {
         return false;
     }
 
+    this->seeding_pipeline = this->make_seeding_pipeline(this->seeding_pipeline_layout, this->work_group_size);
+
+    return this->seeding_pipeline != nullptr;
+}
+
+lava::compute_pipeline::ptr Integrator::make_seeding_pipeline(lava::pipeline_layout::ptr layout, const glm::uvec3& work_group_size) const {
     std::array<uint32_t, 3> seeding_constants;
-    seeding_constants[0] = this->work_group_size.x;
-    seeding_constants[1] = this->work_group_size.y;
-    seeding_constants[2] = this->work_group_size.z;
+    seeding_constants[0] = work_group_size.x;
+    seeding_constants[1] = work_group_size.y;
+    seeding_constants[2] = work_group_size.z;
 
     VkSpecializationMapEntry workgroup_size_x;
     workgroup_size_x.constantID = WORK_GROUP_SIZE_X_CONSTANT_ID;
@@ -478,20 +904,20 @@ bool Integrator::create_seeding_pipeline() {
     if (!shader_stage->create(this->device, seeding_comp_cdata, lava::cdata(seeding_constants.data(), seeding_constants.size() * sizeof(uint32_t)))) {
         lava::log()->error("can't create seeding compute shader!");
 
-        return false;
+        return nullptr;
     }
 
-    this->seeding_pipeline = lava::compute_pipeline::make(this->device, this->app->pipeline_cache);
-    this->seeding_pipeline->set_layout(this->seeding_pipeline_layout);
-    this->seeding_pipeline->set(shader_stage);
+    lava::compute_pipeline::ptr pipeline = lava::compute_pipeline::make(this->device, this->pipeline_cache.get());
+    pipeline->set_layout(layout);
+    pipeline->set(shader_stage);
 
-    if (!this->seeding_pipeline->create()) {
+    if (!pipeline->create()) {
         lava::log()->error("can't create seeding pipeline!");
 
-        return false;
+        return nullptr;
     }
 
-    return true;
+    return pipeline;
 }
 
 void Integrator::destroy_seeding_pipeline() {
@@ -515,27 +941,115 @@ bool Integrator::create_integration_pipeline() {
         return false;
     }
 
-    this->integration_pipeline = lava::compute_pipeline::make(this->device, this->app->pipeline_cache);
-    this->integration_pipeline->set_layout(this->integration_pipeline_layout);
+    this->integration_specialization = this->get_kernel_specialization();
+    this->integration_pipeline = this->make_integration_pipeline(this->integration_pipeline_layout, this->get_pipeline_variant(), this->integration_specialization);
+
+    return this->integration_pipeline != nullptr;
+}
+
+Integrator::PipelineVariant Integrator::get_pipeline_variant() const {
+    return PipelineVariant{
+        .work_group_size = this->work_group_size,
+        .particles_per_invocation = this->particles_per_invocation,
+        .explicit_interpolation = this->explicit_interpolation,
+        .cubic_interpolation = this->cubic_interpolation,
+        .integration_method = this->integration_method,
+        .analytic_dataset = this->analytic_dataset,
+        .subgroup_counters = this->subgroup_counters,
+        .work_queue = this->work_queue,
+    };
+}
+
+glm::uvec3 Integrator::get_integration_work_group_count() const {
+    const glm::uvec3 invocation_count = {(this->seed_spawn.x + this->particles_per_invocation - 1) / this->particles_per_invocation, this->seed_spawn.y, this->seed_spawn.z};
+    const glm::uvec3 work_group_count = (invocation_count + this->work_group_size - 1u) / this->work_group_size;
+    if (this->work_queue) {
+        // Every compute unit gets at least a subgroup of invocations, unless the number of work groups is set. Work
+        // groups smaller than a subgroup would otherwise leave most of the compute unit idle.
+        glm::uint persistent_work_group_count = this->persistent_work_group_count;
+        if (persistent_work_group_count == 0) {
+            const glm::uint invocations_per_work_group = this->work_group_size.x * this->work_group_size.y * this->work_group_size.z;
+            const glm::uint work_groups_per_compute_unit = std::max((this->subgroup_size + invocations_per_work_group - 1) / invocations_per_work_group, 1u);
+            persistent_work_group_count = this->compute_unit_count * work_groups_per_compute_unit;
+        }
 
+        // More work groups than work items would only take an empty item
+        return {std::max(std::min(persistent_work_group_count, work_group_count.x * work_group_count.y * work_group_count.z), 1u), 1, 1};
+    }
+    return work_group_count;
+}
+
+void Integrator::record_work_queue_reset(VkCommandBuffer command_buffer) const {
+    if (!this->work_queue) {
+        return;
+    }
+
+    // The previous batch has to finish taking items before the queue is reset
+    const VkBufferMemoryBarrier reset_barrier{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = this->work_queue_buffer->get(),
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &reset_barrier, 0, nullptr);
+
+    vkCmdFillBuffer(command_buffer, this->work_queue_buffer->get(), 0, VK_WHOLE_SIZE, 0);
+
+    const VkBufferMemoryBarrier dispatch_barrier{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = this->work_queue_buffer->get(),
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &dispatch_barrier, 0, nullptr);
+}
+
+lava::compute_pipeline::ptr Integrator::make_integration_pipeline(lava::pipeline_layout::ptr layout, const PipelineVariant& variant, const std::optional<KernelSpecialization>& specialization) const {
+    lava::compute_pipeline::ptr pipeline = lava::compute_pipeline::make(this->device, this->pipeline_cache.get());
+    pipeline->set_layout(layout);
+
+    // The kernels with subgroup operations are only used if the device supports them, see integration.glsl
     const lava::cdata* shader;
-    if (this->analytic_dataset) {
+    if (variant.analytic_dataset) {
         lava::log()->debug("analytic dataset");
-        shader = &integrate_analytic_comp_cdata;
+        shader = variant.subgroup_counters ? &integrate_analytic_subgroup_comp_cdata : &integrate_analytic_comp_cdata;
     } else if (this->dataset->data->channel_count == 1) {
         lava::log()->debug("bc6h texture dataset");
-        shader = &integrate_bc6h_comp_cdata;
+        shader = variant.subgroup_counters ? &integrate_bc6h_subgroup_comp_cdata : &integrate_bc6h_comp_cdata;
     } else if (this->dataset->data->channel_count == 3) {
         lava::log()->debug("raw textures dataset");
-        shader = &integrate_raw_comp_cdata;
+        shader = variant.subgroup_counters ? &integrate_raw_subgroup_comp_cdata : &integrate_raw_comp_cdata;
     } else {
         lava::log()->error("cannot create integration pipeline: invalid dataset");
-        return false;
+        return nullptr;
     }
 
     if (!shader) {
         lava::log()->error("internal error");
-        return false;
+        return nullptr;
+    }
+
+    // A specialized kernel is compiled from the same source as the generic one
+    std::optional<std::vector<std::uint32_t>> specialized_kernel;
+    lava::cdata shader_data = *shader;
+    if (specialization.has_value()) {
+        lava::log()->debug("specialized kernel");
+        KernelSpecialization kernel_specialization = specialization.value();
+        kernel_specialization.subgroup_arithmetic = variant.subgroup_counters;
+        specialized_kernel = this->kernel_compiler.get_kernel(kernel_specialization);
+        if (!specialized_kernel.has_value()) {
+            lava::log()->error("cannot create integration pipeline: failed to compile specialized kernel");
+            return nullptr;
+        }
+        shader_data = lava::cdata(specialized_kernel->data(), specialized_kernel->size() * sizeof(std::uint32_t));
     }
 
     struct IntegrationConstants {
@@ -544,12 +1058,22 @@ bool Integrator::create_integration_pipeline() {
         glm::uint work_group_size_z;
         glm::uint time_steps;
         VkBool32 explicit_interpolation;
+        glm::uint integration_method;
+        VkBool32 cubic_interpolation;
+        glm::uint particles_per_invocation;
+        VkBool32 subgroup_counters;
+        VkBool32 work_queue;
     } const integration_constants = {
-        .work_group_size_x = this->work_group_size.x,
-        .work_group_size_y = this->work_group_size.y,
-        .work_group_size_z = this->work_group_size.z,
+        .work_group_size_x = variant.work_group_size.x,
+        .work_group_size_y = variant.work_group_size.y,
+        .work_group_size_z = variant.work_group_size.z,
         .time_steps = this->dataset->data->dimensions.w,
-        .explicit_interpolation = this->explicit_interpolation};
+        .explicit_interpolation = variant.explicit_interpolation,
+        .integration_method = static_cast<glm::uint>(variant.integration_method),
+        .cubic_interpolation = variant.cubic_interpolation,
+        .particles_per_invocation = variant.particles_per_invocation,
+        .subgroup_counters = variant.subgroup_counters,
+        .work_queue = variant.work_queue};
 
     lava::pipeline::shader_stage::ptr shader_stage = lava::pipeline::shader_stage::make(VK_SHADER_STAGE_COMPUTE_BIT);
     shader_stage->add_specialization_entry({
@@ -577,18 +1101,70 @@ bool Integrator::create_integration_pipeline() {
         .offset = offsetof(IntegrationConstants, explicit_interpolation),
         .size = sizeof(VkBool32),
     });
-    if (!shader_stage->create(this->device, *shader, lava::cdata(&integration_constants, sizeof(integration_constants)))) {
+    shader_stage->add_specialization_entry({
+        .constantID = INTEGRATION_METHOD_ID,
+        .offset = offsetof(IntegrationConstants, integration_method),
+        .size = sizeof(glm::uint),
+    });
+    shader_stage->add_specialization_entry({
+        .constantID = CUBIC_INTERPOLATION_ID,
+        .offset = offsetof(IntegrationConstants, cubic_interpolation),
+        .size = sizeof(VkBool32),
+    });
+    shader_stage->add_specialization_entry({
+        .constantID = PARTICLES_PER_INVOCATION_ID,
+        .offset = offsetof(IntegrationConstants, particles_per_invocation),
+        .size = sizeof(glm::uint),
+    });
+    shader_stage->add_specialization_entry({
+        .constantID = SUBGROUP_COUNTERS_ID,
+        .offset = offsetof(IntegrationConstants, subgroup_counters),
+        .size = sizeof(VkBool32),
+    });
+    shader_stage->add_specialization_entry({
+        .constantID = WORK_QUEUE_ID,
+        .offset = offsetof(IntegrationConstants, work_queue),
+        .size = sizeof(VkBool32),
+    });
+    if (!shader_stage->create(this->device, shader_data, lava::cdata(&integration_constants, sizeof(integration_constants)))) {
         lava::log()->error("failed to create integration shader stage");
-        return false;
+        return nullptr;
     }
-    this->integration_pipeline->set(shader_stage);
+    pipeline->set(shader_stage);
 
-    if (!this->integration_pipeline->create()) {
+    if (!pipeline->create()) {
         lava::log()->error("failed to create integration pipeline");
-        return false;
+        return nullptr;
     }
 
-    return true;
+    return pipeline;
+}
+
+std::optional<KernelSpecialization> Integrator::get_kernel_specialization() const {
+    if (!this->specialized_kernel) {
+        return std::nullopt;
+    }
+
+    KernelSpecialization specialization = {
+        .source = KernelSource::Analytic,
+        .dataset_dimensions = this->dataset->data->dimensions,
+        .delta_time = this->delta_time,
+        .total_step_count = this->integration_steps,
+        .step_count = 0,
+        .subgroup_arithmetic = this->subgroup_counters,
+    };
+    if (!this->analytic_dataset) {
+        specialization.source = this->dataset->data->channel_count == 1 ? KernelSource::BC6HTexture : KernelSource::RawTextures;
+    }
+
+    // The trip count of the loop over the steps is only fixed if every batch has the same number of steps
+    const unsigned int batch_size = std::min(std::max(this->batch_size, 1u), this->integration_steps);
+    const bool adaptive_batch_size = this->adaptive_batch_size && !this->single_submission;
+    if (!adaptive_batch_size && batch_size > 0 && this->integration_steps % batch_size == 0) {
+        specialization.step_count = batch_size;
+    }
+
+    return specialization;
 }
 
 void Integrator::destroy_integration_pipeline() {
@@ -625,11 +1201,47 @@ void Integrator::write_dataset_to_descriptor() {
 void Integrator::reset_dataset() {
 }
 
-bool Integrator::Integration::create_buffers(glm::uvec3 seed_spawn, std::uint32_t integration_steps, lava::device_p device, const lava::queue& compute_queue) {
+std::string Integrator::get_autotune_key() const {
+    return AutotuneCache::make_key(this->device, this->dataset->data->format, this->dataset->data->dimensions, this->analytic_dataset, this->explicit_interpolation, this->cubic_interpolation, this->integration_method);
+}
+
+void Integrator::apply_autotune_result() {
+    const std::optional<AutotuneResult> result = this->autotune_cache.find(this->get_autotune_key());
+    if (!result.has_value()) {
+        return;
+    }
+
+    // Parameters on the command line take precedence
+    const bool work_group_size_given = this->command_parser.get_work_group_size_x().has_value() || this->command_parser.get_work_group_size_y().has_value() || this->command_parser.get_work_group_size_z().has_value();
+    if (!work_group_size_given) {
+        this->work_group_size = result->work_group_size;
+        this->recreate_seeding_pipeline = true;
+        this->recreate_integration_pipeline = true;
+    }
+    if (!this->command_parser.get_particles_per_invocation().has_value()) {
+        this->particles_per_invocation = result->particles_per_invocation;
+        this->recreate_integration_pipeline = true;
+    }
+    if (!this->command_parser.get_batch_size().has_value()) {
+        this->batch_size = result->get_batch_size(this->seed_spawn.x * this->seed_spawn.y * this->seed_spawn.z, this->integration_steps, AUTOTUNE_BATCH_DURATION);
+    }
+
+    lava::log()->info("autotuned work group size {}x{}x{}, {} particles per invocation and batch size {}", this->work_group_size.x, this->work_group_size.y, this->work_group_size.z, this->particles_per_invocation, this->batch_size);
+}
+
+bool Integrator::Integration::reserve_buffers(glm::uvec3 seed_spawn, std::uint32_t integration_steps, lava::device_p device, const lava::queue& compute_queue) {
     this->integration_steps = integration_steps;
     this->seed_count = seed_spawn.x * seed_spawn.y * seed_spawn.z;
 
-    const std::size_t buffer_size = seed_count * (integration_steps + 1) * sizeof(glm::vec4); // Increase integration steps by one for seeding position
+    const std::size_t buffer_size = std::size_t(seed_count) * (integration_steps + 1) * sizeof(glm::vec4); // Increase integration steps by one for seeding position
+    const std::size_t indirect_buffer_size = sizeof(VkDrawIndirectCommand) * seed_count;
+    const std::size_t particle_state_buffer_size = sizeof(ParticleState) * seed_count;
+
+    // The shaders address the buffers with the seed count and the step count of the run, so larger buffers can be reused
+    if (buffer_size <= this->line_buffer_size && indirect_buffer_size <= this->indirect_buffer_size && particle_state_buffer_size <= this->particle_state_buffer_size) {
+        return true;
+    }
+    this->destroy(device);
 
     const std::array<std::uint32_t, 2> queue_family_indices = {
         device->get_queues()[queue_indices::GRAPHICS].family,
@@ -658,12 +1270,13 @@ bool Integrator::Integration::create_buffers(glm::uvec3 seed_spawn, std::uint32_
         lava::log()->error("failed to create line buffer");
         return false;
     }
+    this->line_buffer_size = buffer_size;
     lava::log()->debug("trajectory buffer size: {} MB", static_cast<double>(line_buffer_create_info.size) / 1024.0 / 1024.0);
     lava::log()->debug("trajectory buffer memory type: {}", allocation_info.memoryType);
 
     const VkBufferCreateInfo indirect_buffer_create_info{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = sizeof(VkDrawIndirectCommand) * seed_count,
+        .size = indirect_buffer_size,
         .usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         .sharingMode = VK_SHARING_MODE_CONCURRENT,
         .queueFamilyIndexCount = queue_family_indices.size(),
@@ -682,6 +1295,30 @@ bool Integrator::Integration::create_buffers(glm::uvec3 seed_spawn, std::uint32_
         lava::log()->error("failed to create indirect buffer");
         return false;
     }
+    this->indirect_buffer_size = indirect_buffer_size;
+
+    // Only read and written by the integration shader, the host never accesses it
+    const VkBufferCreateInfo particle_state_buffer_create_info{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = particle_state_buffer_size,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    const VmaAllocationCreateInfo particle_state_buffer_alloc_info{
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    };
+    if (vmaCreateBuffer(
+            device->alloc(),
+            &particle_state_buffer_create_info,
+            &particle_state_buffer_alloc_info,
+            &this->particle_state_buffer,
+            &this->particle_state_buffer_allocation,
+            nullptr) != VK_SUCCESS) {
+        lava::log()->error("failed to create particle state buffer");
+        return false;
+    }
+    this->particle_state_buffer_size = particle_state_buffer_size;
+    this->descriptor_outdated = true;
 
     return true;
 }
@@ -697,6 +1334,11 @@ void Integrator::Integration::update_descriptor_set(lava::device_p device, VkDes
         .offset = 0,
         .range = VK_WHOLE_SIZE,
     };
+    const VkDescriptorBufferInfo particle_state_buffer_info{
+        .buffer = this->particle_state_buffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
     device->vkUpdateDescriptorSets({
         {
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -714,24 +1356,48 @@ void Integrator::Integration::update_descriptor_set(lava::device_p device, VkDes
             .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
             .pBufferInfo = &indirect_buffer_info,
         },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptor_set,
+            .dstBinding = PARTICLE_STATE_BUFFER_BINDING,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &particle_state_buffer_info,
+        },
     });
 }
 
-void Integrator::Integration::destroy(lava::device_p device, VkCommandPool command_pool) {
+void Integrator::Integration::destroy(lava::device_p device) {
+    if (this->line_buffer_size == 0 && this->indirect_buffer_size == 0 && this->particle_state_buffer_size == 0) {
+        return;
+    }
+
     device->wait_for_idle();
-    vmaDestroyBuffer(device->alloc(), this->line_buffer, this->line_buffer_allocation);
-    vmaDestroyBuffer(device->alloc(), this->indirect_buffer, this->indirect_buffer_allocation);
+    if (this->line_buffer_size > 0) {
+        vmaDestroyBuffer(device->alloc(), this->line_buffer, this->line_buffer_allocation);
+        this->line_buffer_size = 0;
+    }
+    if (this->indirect_buffer_size > 0) {
+        vmaDestroyBuffer(device->alloc(), this->indirect_buffer, this->indirect_buffer_allocation);
+        this->indirect_buffer_size = 0;
+    }
+    if (this->particle_state_buffer_size > 0) {
+        vmaDestroyBuffer(device->alloc(), this->particle_state_buffer, this->particle_state_buffer_allocation);
+        this->particle_state_buffer_size = 0;
+    }
 }
 
 void Integrator::destroy_integration() {
     if (this->integration.has_value()) {
-        this->integration->destroy(this->device, this->command_pool);
+        this->integration->destroy(this->device);
         this->integration.reset();
     }
 }
 
 bool Integrator::prepare_integration() {
-    if (this->recreate_integration_pipeline || !this->seeding_pipeline || !this->integration_pipeline) {
+    lava::timer setup_timer;
+
+    if (this->recreate_seeding_pipeline || !this->seeding_pipeline) {
         if (this->seeding_pipeline) {
             this->destroy_seeding_pipeline();
         }
@@ -740,6 +1406,11 @@ bool Integrator::prepare_integration() {
             return false;
         }
 
+        this->recreate_seeding_pipeline = false;
+    }
+
+    // A specialized kernel is recompiled when the time step, the number of steps or the batch size change
+    if (this->recreate_integration_pipeline || !this->integration_pipeline || this->get_kernel_specialization() != this->integration_specialization) {
         if (this->integration_pipeline) {
             this->destroy_integration_pipeline();
         }
@@ -751,21 +1422,107 @@ bool Integrator::prepare_integration() {
         this->recreate_integration_pipeline = false;
     }
 
-    this->destroy_integration();
-    this->integration.emplace();
-    lava::log()->debug("create buffers");
-    lava::log()->flush();
-
-    lava::timer sw;
-    this->integration->create_buffers(this->seed_spawn, this->integration_steps, this->device, this->compute_queue);
-    lava::log()->debug("integration buffers created ({} ms)", sw.elapsed().count());
-    this->integration->update_descriptor_set(this->device, this->descriptor_set);
-    this->write_dataset_to_descriptor();
+    // The buffers of the previous run are kept unless they are too small, the dataset is already in the descriptor set
+    if (!this->integration.has_value()) {
+        this->integration.emplace();
+    }
+    this->integration->seeding_complete = false;
+    this->integration->integration_complete = false;
+    this->integration->cancelled = false;
+
+    if (!this->integration->reserve_buffers(this->seed_spawn, this->integration_steps, this->device, this->compute_queue)) {
+        this->destroy_integration();
+        return false;
+    }
+    if (this->integration->descriptor_outdated) {
+        this->integration->update_descriptor_set(this->device, this->descriptor_set);
+        this->integration->descriptor_outdated = false;
+    }
+
+    this->integration->run_times.setup_cpu = setup_timer.elapsed().count();
+    lava::log()->debug("integration prepared ({} ms)", this->integration->run_times.setup_cpu);
+
     return true;
 }
 
+bool Integrator::run_integration() {
+    if (!this->dataset || !this->dataset->loaded()) {
+        lava::log()->error("integration requires a loaded dataset");
+        return false;
+    }
+
+    return this->prepare_integration() && this->integrate();
+}
+
+std::optional<Integrator::RunTimes> Integrator::get_run_times() const {
+    if (!this->integration.has_value() || !this->integration->integration_complete || this->integration->cancelled) {
+        return std::nullopt;
+    }
+    return this->integration->run_times;
+}
+
+std::optional<std::uint64_t> Integrator::get_sample_count() const {
+    if (!this->integration.has_value() || !this->integration->integration_complete || this->integration->cancelled) {
+        return std::nullopt;
+    }
+    return this->integration->sample_count;
+}
+
+IntegrationSettings Integrator::get_settings() const {
+    return IntegrationSettings{
+        .work_group_size = this->work_group_size,
+        .particles_per_invocation = this->particles_per_invocation,
+        .seed_spawn = this->seed_spawn,
+        .integration_steps = this->integration_steps,
+        .batch_size = this->batch_size,
+        .explicit_interpolation = this->explicit_interpolation,
+        .cubic_interpolation = this->cubic_interpolation,
+        .integration_method = this->integration_method,
+        .specialized_kernel = this->specialized_kernel,
+        .subgroup_counters = this->subgroup_counters,
+        .work_queue = this->work_queue,
+    };
+}
+
+void Integrator::set_settings(const IntegrationSettings& settings) {
+    if (settings.work_group_size != this->work_group_size) {
+        this->recreate_seeding_pipeline = true;
+        this->recreate_integration_pipeline = true;
+    }
+    if (settings.particles_per_invocation != this->particles_per_invocation || settings.explicit_interpolation != this->explicit_interpolation || settings.cubic_interpolation != this->cubic_interpolation || settings.integration_method != this->integration_method || settings.subgroup_counters != this->subgroup_counters || settings.work_queue != this->work_queue) {
+        this->recreate_integration_pipeline = true;
+    }
+    // Like in the UI, the time step follows the number of steps unless it is given on the command line
+    if (settings.integration_steps != this->integration_steps && this->dataset && !this->command_parser.get_delta_time().has_value()) {
+        this->delta_time = (float)this->dataset->data->dimensions.w / (float)settings.integration_steps;
+    }
+
+    this->work_group_size = settings.work_group_size;
+    this->particles_per_invocation = settings.particles_per_invocation;
+    this->seed_spawn = settings.seed_spawn;
+    this->integration_steps = settings.integration_steps;
+    this->batch_size = settings.batch_size;
+    this->explicit_interpolation = settings.explicit_interpolation;
+    this->cubic_interpolation = settings.cubic_interpolation;
+    this->integration_method = settings.integration_method;
+    this->specialized_kernel = settings.specialized_kernel;
+    this->subgroup_counters = settings.subgroup_counters && this->subgroup_counters_supported;
+    this->work_queue = settings.work_queue;
+    this->log_file.close();
+}
+
+void Integrator::set_delta_time(float delta_time) {
+    this->delta_time = delta_time;
+    this->log_file.close();
+}
+
+void Integrator::set_run_log_enabled(bool enabled) {
+    this->run_log_enabled = enabled;
+    this->log_file.close();
+}
+
 bool Integrator::integrate() {
-    if (!this->log_file.is_open()) {
+    if (this->run_log_enabled && !this->log_file.is_open()) {
         const auto absolute_dataset_path = std::filesystem::absolute(this->dataset->data->filename);
         const auto dataset_filename = absolute_dataset_path.filename().string();
         std::time_t t = std::time(0); // get time now
@@ -781,28 +1538,39 @@ bool Integrator::integrate() {
             "Saturday",
         };
 
-        const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-{}-{}-({}-{}-{})-({}-{}-{})-{}-{}-{}-{}-{}-integration.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, weekdays[now->tm_wday], now->tm_hour, now->tm_min, now->tm_sec, dataset_filename,    
+        const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-{}-{}-({}-{}-{})-({}-{}-{})-{}-{}-{}-{}-{}-{}-integration.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, weekdays[now->tm_wday], now->tm_hour, now->tm_min, now->tm_sec, dataset_filename,    
             this->work_group_size.x, this->work_group_size.y, this->work_group_size.z,
             this->seed_spawn.x, this->seed_spawn.y, this->seed_spawn.z,
             this->integration_steps,
             this->batch_size,
             this->delta_time,
             (this->explicit_interpolation) ? "Explicit" : "Implicit",
+            (this->cubic_interpolation) ? "Cubic" : "Linear",
             (this->analytic_dataset) ? "Analytic" : "Dataset"
         );
         this->log_file = std::ofstream(filename);
-        fmt::print(this->log_file, "run,seeding_gpu,seeding_cpu,integration_gpu,integration_cpu,dataset_path,dataset_dimensions,work_group_size,seed_spawn,timestep,integration_steps,batch_size,explicit_interpolation,analytic\n");
+        fmt::print(this->log_file, "run,seeding_gpu,seeding_cpu,integration_gpu,integration_cpu,setup_cpu,batch_count,dataset_path,dataset_dimensions,work_group_size,particles_per_invocation,seed_spawn,timestep,integration_steps,batch_size,batch_duration,explicit_interpolation,cubic_interpolation,method,absolute_tolerance,relative_tolerance,specialized_kernel,analytic,subgroup_counters,work_queue,persistent_work_groups,samples\n");
         fmt::print(
-            this->log_file, ",,,,,{},{}x{}x{}x{},{}x{}x{},{}x{}x{},{},{},{},{},{}\n",
+            this->log_file, ",,,,,,,{},{}x{}x{}x{},{}x{}x{},{},{}x{}x{},{},{},{},{},{},{},{},{},{},{},{},{},{},{}\n",
             absolute_dataset_path,
             this->dataset->data->dimensions.x, this->dataset->data->dimensions.y, this->dataset->data->dimensions.z, this->dataset->data->dimensions.w,
             this->work_group_size.x, this->work_group_size.y, this->work_group_size.z,
+            this->particles_per_invocation,
             this->seed_spawn.x, this->seed_spawn.y, this->seed_spawn.z,
             this->delta_time,
             this->integration_steps,
             this->batch_size,
+            this->adaptive_batch_size ? fmt::format("{}", this->batch_duration) : "",
             this->explicit_interpolation,
-            this->analytic_dataset);
+            this->cubic_interpolation,
+            get_integration_method_name(this->integration_method),
+            this->integration_method == IntegrationMethod::DormandPrince ? fmt::format("{}", this->absolute_tolerance) : "",
+            this->integration_method == IntegrationMethod::DormandPrince ? fmt::format("{}", this->relative_tolerance) : "",
+            this->specialized_kernel,
+            this->analytic_dataset,
+            this->subgroup_counters,
+            this->work_queue,
+            this->work_queue ? fmt::format("{}", this->get_integration_work_group_count().x) : "");
     }
 
     VkCommandBufferAllocateInfo command_buffer_info;
@@ -840,6 +1608,8 @@ bool Integrator::integrate() {
     constants.total_step_count = this->integration->integration_steps;
     constants.first_step = 0;
     constants.step_count = this->integration_steps;
+    constants.absolute_tolerance = this->absolute_tolerance;
+    constants.relative_tolerance = this->relative_tolerance;
 
     this->integration->cpu_time = 0.0;
     this->integration->gpu_time = 0.0;
@@ -847,27 +1617,34 @@ bool Integrator::integrate() {
     this->integration->integration_complete = false;
     this->integration->batch_count = (this->integration_steps + this->batch_size - 1) / this->batch_size;
     this->integration->current_batch = 0;
+    this->integration->sample_count = 0;
 
-    memset(this->max_velocity_magnitude_buffer->get_mapped_data(), 0, 4);
+    memset(this->max_velocity_magnitude_buffer->get_mapped_data(), 0, sizeof(IntegrationStatistics));
 
     lava::timer timer;
 
-    fmt::print(this->log_file, "{},", this->run);
-
     lava::timer seeding_timer;
     if (!this->perform_seeding(command_buffer, fence, timer, constants)) {
-        return false;
+        return this->abort_integration(command_buffer, fence);
     }
-    fmt::print(this->log_file, "{},{},", this->integration->gpu_time, seeding_timer.elapsed().count());
+    this->integration->run_times.seeding_gpu = this->integration->gpu_time;
+    this->integration->run_times.seeding_cpu = seeding_timer.elapsed().count();
 
     this->integration->gpu_time = 0.0;
     this->integration->seeding_complete = true;
 
     lava::timer integration_timer;
     if (!this->perform_integration(command_buffer, fence, timer, constants)) {
-        return false;
+        return this->abort_integration(command_buffer, fence);
+    }
+    this->integration->run_times.integration_gpu = this->integration->gpu_time;
+    this->integration->run_times.integration_cpu = integration_timer.elapsed().count();
+
+    if (this->log_file.is_open()) {
+        const RunTimes& run_times = this->integration->run_times;
+        fmt::print(this->log_file, "{},{},{},{},{},{},{},,,,,,,,,,,,,,,,,,,,{}\n", this->run, run_times.seeding_gpu, run_times.seeding_cpu, run_times.integration_gpu, run_times.integration_cpu, run_times.setup_cpu, this->integration->current_batch, this->integration->sample_count);
+        this->log_file.flush();
     }
-    fmt::print(this->log_file, "{},{}\n", this->integration->gpu_time, integration_timer.elapsed().count());
 
     this->integration->cpu_time = timer.elapsed().count();
     this->integration->integration_complete = true;
@@ -875,16 +1652,36 @@ bool Integrator::integrate() {
     vkFreeCommandBuffers(this->device->get(), this->command_pool, 1, &command_buffer);
     vkDestroyFence(this->device->get(), fence, lava::memory::instance().alloc());
 
-    this->log_file.flush();
     this->run++;
 
     return true;
 }
 
+bool Integrator::abort_integration(VkCommandBuffer command_buffer, VkFence fence) {
+    if (this->scheduler.get_state() != IntegrationScheduler::State::Cancelled) {
+        return false;
+    }
+
+    // No batch is in flight anymore, the trajectories of the completed batches remain visible
+    lava::log()->info("integration cancelled after {} of {} batches", this->integration->current_batch, this->integration->batch_count);
+    this->integration->cancelled = true;
+    this->integration->integration_complete = true;
+
+    vkFreeCommandBuffers(this->device->get(), this->command_pool, 1, &command_buffer);
+    vkDestroyFence(this->device->get(), fence, lava::memory::instance().alloc());
+
+    return false;
+}
+
 bool Integrator::perform_seeding(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, Constants& constants) {
     lava::log()->debug("start seeding");
 
     bool result = this->submit_and_measure_command(command_buffer, fence, timer, [=, this]() {
+        // Without a frame loop, nothing has transitioned the images after loading yet
+        if (!this->dataset->transitioned) {
+            this->dataset->transition_images(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
         this->seeding_pipeline->bind(command_buffer);
         this->seeding_pipeline_layout->bind(command_buffer, this->descriptor_set, 0, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
 
@@ -898,12 +1695,29 @@ bool Integrator::perform_seeding(VkCommandBuffer command_buffer, VkFence fence,
 }
 
 bool Integrator::perform_integration(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, Constants& constants) {
+    if (this->single_submission) {
+        if (this->scheduler.is_available()) {
+            return this->perform_recorded_integration(timer, constants);
+        }
+        lava::log()->warn("single submission is not available, the batches are submitted one after another");
+        this->single_submission = false;
+    }
+
     lava::log()->debug("start integration");
 
+    IntegrationStatistics* statistics = reinterpret_cast<IntegrationStatistics*>(this->max_velocity_magnitude_buffer->get_mapped_data());
+    unsigned int active_particle_count = this->integration->seed_count;
+    unsigned int batch_size = this->batch_size;
+
     unsigned int step_count = 0;
     while (step_count < this->integration_steps) {
         constants.first_step = step_count;
-        constants.step_count = std::min(this->integration_steps - step_count, this->batch_size);
+        constants.step_count = std::min(this->integration_steps - step_count, batch_size);
+
+        statistics->active_particle_count = 0;
+        statistics->sample_count_low = 0;
+        statistics->sample_count_high = 0;
+        const double previous_gpu_time = this->integration->gpu_time;
 
         lava::log()->debug("batch (first_step = {}, step_count = {})", constants.first_step, constants.step_count);
 
@@ -911,8 +1725,9 @@ bool Integrator::perform_integration(VkCommandBuffer command_buffer, VkFence fen
             this->integration_pipeline->bind(command_buffer);
             this->integration_pipeline_layout->bind(command_buffer, this->descriptor_set, 0, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
 
-            glm::uvec3 work_group_count = (this->seed_spawn + this->work_group_size - 1u) / this->work_group_size;
+            const glm::uvec3 work_group_count = this->get_integration_work_group_count();
 
+            this->record_work_queue_reset(command_buffer);
             vkCmdPushConstants(command_buffer, this->seeding_pipeline_layout->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &constants);
             vkCmdDispatch(command_buffer, work_group_count.x, work_group_count.y, work_group_count.z);
         });
@@ -923,6 +1738,24 @@ bool Integrator::perform_integration(VkCommandBuffer command_buffer, VkFence fen
 
         step_count += constants.step_count;
         this->integration->current_batch += 1;
+        this->integration->sample_count += statistics->get_sample_count();
+
+        if (this->adaptive_batch_size) {
+            const unsigned int remaining_particle_count = statistics->active_particle_count;
+
+            // The remaining batches would not write any vertex
+            if (remaining_particle_count == 0) {
+                lava::log()->debug("all particles left the dataset after {} steps", step_count);
+                this->integration->current_batch = this->integration->batch_count;
+                break;
+            }
+
+            batch_size = compute_adaptive_batch_size(this->batch_duration, this->integration->gpu_time - previous_gpu_time, constants.step_count, active_particle_count, remaining_particle_count);
+            active_particle_count = remaining_particle_count;
+
+            const unsigned int remaining_step_count = this->integration_steps - step_count;
+            this->integration->batch_count = this->integration->current_batch + (remaining_step_count + batch_size - 1) / batch_size;
+        }
     }
 
     lava::log()->debug("integration dispatched ({} ms)", timer.elapsed().count());
@@ -930,7 +1763,184 @@ bool Integrator::perform_integration(VkCommandBuffer command_buffer, VkFence fen
     return true;
 }
 
+bool Integrator::perform_recorded_integration(lava::timer& timer, Constants& constants) {
+    lava::log()->debug("start recorded integration");
+
+    const std::uint32_t batch_count = (this->integration_steps + this->batch_size - 1) / this->batch_size;
+    const std::uint32_t command_buffer_count = (batch_count + BATCHES_PER_COMMAND_BUFFER - 1) / BATCHES_PER_COMMAND_BUFFER;
+
+    // One timestamp before the first batch and one after every batch
+    if (this->query_count < batch_count + 1 && !this->create_query_pool(batch_count + 1)) {
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo command_buffer_info;
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_info.pNext = nullptr;
+    command_buffer_info.commandPool = this->command_pool;
+    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_info.commandBufferCount = command_buffer_count;
+
+    std::vector<VkCommandBuffer> command_buffers(command_buffer_count, VK_NULL_HANDLE);
+
+    if (vkAllocateCommandBuffers(this->device->get(), &command_buffer_info, command_buffers.data()) != VK_SUCCESS) {
+        lava::log()->error("can't create command buffers for recorded integration!");
+
+        return false;
+    }
+
+    // The values of the submitted command buffers. Those can only be freed once they have completed, also if a later
+    // submission failed.
+    std::vector<std::uint64_t> signal_values;
+    const auto free_command_buffers = [&]() {
+        if (!signal_values.empty() && !this->scheduler.wait_idle()) {
+            this->device->wait_for_idle();
+        }
+        vkFreeCommandBuffers(this->device->get(), this->command_pool, command_buffer_count, command_buffers.data());
+    };
+
+    // Every batch continues the trajectories that the previous batch has written
+    const VkMemoryBarrier batch_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+    const VkMemoryBarrier host_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+
+    const glm::uvec3 work_group_count = this->get_integration_work_group_count();
+
+    for (std::uint32_t command_buffer_index = 0; command_buffer_index < command_buffer_count; ++command_buffer_index) {
+        VkCommandBuffer command_buffer = command_buffers[command_buffer_index];
+        const std::uint32_t first_batch = command_buffer_index * BATCHES_PER_COMMAND_BUFFER;
+        const std::uint32_t last_batch = std::min(first_batch + BATCHES_PER_COMMAND_BUFFER, batch_count);
+
+        VkCommandBufferBeginInfo begin_info;
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.pNext = nullptr;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        begin_info.pInheritanceInfo = nullptr;
+
+        if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            lava::log()->error("can't begin command buffer!");
+            free_command_buffers();
+
+            return false;
+        }
+
+        if (command_buffer_index == 0) {
+            vkCmdResetQueryPool(command_buffer, this->query_pool, 0, batch_count + 1);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, this->query_pool, 0);
+        }
+
+        this->integration_pipeline->bind(command_buffer);
+        this->integration_pipeline_layout->bind(command_buffer, this->descriptor_set, 0, {}, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+        for (std::uint32_t batch = first_batch; batch < last_batch; ++batch) {
+            // The barrier also orders the batch after the command buffers that have been submitted before
+            if (batch > 0) {
+                vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &batch_barrier, 0, nullptr, 0, nullptr);
+            }
+
+            constants.first_step = batch * this->batch_size;
+            constants.step_count = std::min(this->integration_steps - constants.first_step, this->batch_size);
+
+            this->record_work_queue_reset(command_buffer);
+            vkCmdPushConstants(command_buffer, this->integration_pipeline_layout->get(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Constants), &constants);
+            vkCmdDispatch(command_buffer, work_group_count.x, work_group_count.y, work_group_count.z);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, this->query_pool, batch + 1);
+        }
+
+        if (last_batch == batch_count) {
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
+        }
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+            lava::log()->error("can't end command buffer!");
+            free_command_buffers();
+
+            return false;
+        }
+    }
+
+    lava::log()->debug("recorded {} batches into {} command buffers ({} ms)", batch_count, command_buffer_count, timer.elapsed().count());
+
+    // The next command buffer is queued behind the running one, so that the GPU does not idle between them, while a
+    // pause or a cancellation still takes effect after the command buffers in flight
+    std::uint32_t completed_count = 0;
+    bool cancelled = false;
+
+    while (completed_count < command_buffer_count) {
+        while (!cancelled && signal_values.size() < command_buffer_count && signal_values.size() - completed_count < MAX_SUBMISSIONS_IN_FLIGHT) {
+            if (!this->scheduler.continue_at_batch_boundary()) {
+                cancelled = true;
+                break;
+            }
+
+            const std::optional<std::uint64_t> signal_value = this->scheduler.submit(command_buffers[signal_values.size()]);
+            if (!signal_value.has_value()) {
+                free_command_buffers();
+                return false;
+            }
+            signal_values.push_back(signal_value.value());
+        }
+
+        if (completed_count == signal_values.size()) {
+            break;
+        }
+
+        // Sleeps until the command buffer completes instead of polling a fence
+        if (!this->scheduler.wait(signal_values[completed_count])) {
+            free_command_buffers();
+            return false;
+        }
+
+        completed_count++;
+        this->integration->current_batch = std::min(completed_count * BATCHES_PER_COMMAND_BUFFER, batch_count);
+        this->integration->cpu_time = timer.elapsed().count();
+    }
+
+    free_command_buffers();
+
+    if (cancelled) {
+        return false;
+    }
+
+    std::vector<std::uint64_t> timestamps(batch_count + 1);
+
+    if (vkGetQueryPoolResults(this->device->get(), this->query_pool, 0, batch_count + 1, timestamps.size() * sizeof(timestamps[0]), timestamps.data(), sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+        lava::log()->error("failed to receive gpu times!");
+
+        return false;
+    }
+
+    const float timestamp_period = this->device->get_properties().limits.timestampPeriod;
+    double longest_batch_ms = 0.0;
+    for (std::uint32_t batch = 0; batch < batch_count; ++batch) {
+        longest_batch_ms = std::max(longest_batch_ms, (timestamps[batch + 1] - timestamps[batch]) * (double)timestamp_period / 1000.0 / 1000.0);
+    }
+
+    this->integration->gpu_time += (timestamps[batch_count] - timestamps[0]) * (double)timestamp_period / 1000.0 / 1000.0;
+    const IntegrationStatistics* statistics = reinterpret_cast<const IntegrationStatistics*>(this->max_velocity_magnitude_buffer->get_mapped_data());
+    this->line_velocity_max = statistics->max_velocity_magnitude;
+    // Without a reset between the batches, the counter holds the samples of all batches
+    this->integration->sample_count = statistics->get_sample_count();
+
+    lava::log()->debug("integration dispatched ({} ms, longest batch {} ms on the GPU)", timer.elapsed().count(), longest_batch_ms);
+
+    return true;
+}
+
 bool Integrator::submit_and_measure_command(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, std::function<void()> function) {
+    if (!this->scheduler.continue_at_batch_boundary()) {
+        return false;
+    }
+
     VkCommandBufferBeginInfo begin_info;
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     begin_info.pNext = nullptr;
@@ -956,6 +1966,38 @@ bool Integrator::submit_and_measure_command(VkCommandBuffer command_buffer, VkFe
         return false;
     }
 
+    // Sleeps until the command buffer completes instead of polling the fence
+    if (this->scheduler.is_available()) {
+        const std::optional<std::uint64_t> signal_value = this->scheduler.submit(command_buffer);
+        if (!signal_value.has_value() || !this->scheduler.wait(signal_value.value())) {
+            return false;
+        }
+        this->integration->cpu_time = timer.elapsed().count();
+    }
+
+    else if (!this->submit_with_fence(command_buffer, fence, timer)) {
+        return false;
+    }
+
+    std::array<std::uint64_t, 2> timestamps;
+
+    if (vkGetQueryPoolResults(this->device->get(), this->query_pool, 0, 2, sizeof(timestamps), timestamps.data(), sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+        lava::log()->error("failed to receive gpu times!");
+
+        return false;
+    }
+
+    const float timestamp_period = this->device->get_properties().limits.timestampPeriod;
+    const double duration_ns = (timestamps[1] - timestamps[0]) * (double)timestamp_period;
+    const double duration_ms = duration_ns / 1000.0 / 1000.0;
+
+    this->integration->gpu_time += duration_ms;
+    this->line_velocity_max = reinterpret_cast<const IntegrationStatistics*>(this->max_velocity_magnitude_buffer->get_mapped_data())->max_velocity_magnitude;
+
+    return true;
+}
+
+bool Integrator::submit_with_fence(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer) {
     VkSubmitInfo submit_info;
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submit_info.pNext = nullptr;
@@ -1003,25 +2045,16 @@ bool Integrator::submit_and_measure_command(VkCommandBuffer command_buffer, VkFe
         return false;
     }
 
-    std::array<std::uint64_t, 2> timestamps;
-
-    if (vkGetQueryPoolResults(this->device->get(), this->query_pool, 0, 2, sizeof(timestamps), timestamps.data(), sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
-        lava::log()->error("failed to receive gpu times!");
-
-        return false;
-    }
-
-    const float timestamp_period = this->device->get_properties().limits.timestampPeriod;
-    const double duration_ns = (timestamps[1] - timestamps[0]) * (double)timestamp_period;
-    const double duration_ms = duration_ns / 1000.0 / 1000.0;
-
-    this->integration->gpu_time += duration_ms;
-    this->line_velocity_max = *reinterpret_cast<const float*>(this->max_velocity_magnitude_buffer->get_mapped_data());
-
     return true;
 }
 
 bool Integrator::download_trajectories(const std::string& file_name) {
+    return this->read_trajectories([&](std::span<const glm::vec4> line_buffer, std::span<const VkDrawIndirectCommand> indirect_buffer) {
+        return write_trajectories(file_name, line_buffer, indirect_buffer);
+    });
+}
+
+bool Integrator::read_trajectories(const std::function<bool(std::span<const glm::vec4>, std::span<const VkDrawIndirectCommand>)>& function) {
     const std::size_t seed_count = this->integration.value().seed_count;
     const std::size_t integration_steps = this->integration.value().integration_steps;
 
@@ -1216,12 +2249,10 @@ bool Integrator::download_trajectories(const std::string& file_name) {
         return false;
     }
 
-    std::span<glm::vec4> line_buffer_span = std::span<glm::vec4>(line_buffer_pointer, line_buffer_pointer + seed_count * integration_steps);
+    std::span<glm::vec4> line_buffer_span = std::span<glm::vec4>(line_buffer_pointer, line_buffer_pointer + seed_count * (integration_steps + 1));
     std::span<VkDrawIndirectCommand> indirect_buffer_span = std::span<VkDrawIndirectCommand>(indirect_buffer_pointer, indirect_buffer_pointer + seed_count);
 
-    if (!this->write_trajectories(file_name, line_buffer_span, indirect_buffer_span)) {
-        return false;
-    }
+    const bool success = function(line_buffer_span, indirect_buffer_span);
 
     vmaUnmapMemory(this->device->alloc(), line_staging_buffer_allocation);
     vmaUnmapMemory(this->device->alloc(), indirect_staging_buffer_allocation);
@@ -1232,45 +2263,5 @@ bool Integrator::download_trajectories(const std::string& file_name) {
     vmaDestroyBuffer(this->device->alloc(), line_staging_buffer, line_staging_buffer_allocation);
     vmaDestroyBuffer(this->device->alloc(), indirect_staging_buffer, indirect_staging_buffer_allocation);
 
-    return true;
-}
-
-bool Integrator::write_trajectories(const std::string& file_name, std::span<glm::vec4> line_buffer, std::span<VkDrawIndirectCommand> indirect_buffer) {
-    if (file_name.empty()) {
-        lava::log()->error("File name empty!");
-
-        return false;
-    }
-
-    std::fstream length_file;
-    std::fstream trajectory_file;
-
-    length_file.open(file_name + "_length.bin", std::ios::out | std::ios::binary);
-
-    if (!length_file.good()) {
-        lava::log()->error("Can't open length file!");
-
-        return false;
-    }
-
-    trajectory_file.open(file_name + "_trajectory.bin", std::ios::out | std::ios::binary);
-
-    if (!trajectory_file.good()) {
-        lava::log()->error("Can't open trajectory file!");
-
-        return false;
-    }
-
-    for (VkDrawIndirectCommand& indirect_command : indirect_buffer) {
-        uint32_t offset = indirect_command.firstVertex;
-        uint32_t length = indirect_command.vertexCount;
-
-        length_file.write((const char*)&length, sizeof(length));
-        trajectory_file.write((const char*)(line_buffer.data() + offset), length * sizeof(glm::vec4));
-    }
-
-    length_file.close();
-    trajectory_file.close();
-
-    return true;
+    return success;
 }
@@ -1,8 +1,15 @@
 #pragma once
 
+#include "autotuner.hpp"
 #include "dataset.hpp"
+#include "integration_method.hpp"
+#include "integration_scheduler.hpp"
+#include "kernel_compiler.hpp"
+#include "pipeline_cache.hpp"
+#include "thread_pool.hpp"
 #include "liblava/resource/buffer.hpp"
 #include "command_parser.hpp"
+#include <functional>
 #include <iterator>
 #include <liblava/block/compute_pipeline.hpp>
 #include <liblava/block/render_pass.hpp>
@@ -12,10 +19,36 @@
 
 struct Constants;
 
+// The parameters of an integration that can be changed between runs
+struct IntegrationSettings {
+    glm::uvec3 work_group_size;
+    unsigned int particles_per_invocation;
+    glm::uvec3 seed_spawn;
+    unsigned int integration_steps;
+    unsigned int batch_size;
+    bool explicit_interpolation;
+    bool cubic_interpolation;
+    IntegrationMethod integration_method;
+    bool specialized_kernel;
+    bool subgroup_counters;
+    bool work_queue;
+
+    bool operator==(const IntegrationSettings& other) const = default;
+};
+
 class Integrator {
   public:
     using Ptr = std::shared_ptr<Integrator>;
 
+    // Durations of an integration in ms
+    struct RunTimes {
+        double seeding_gpu = 0.0;
+        double seeding_cpu = 0.0;
+        double integration_gpu = 0.0;
+        double integration_cpu = 0.0;
+        double setup_cpu = 0.0; // Pipelines, buffers and descriptors that are not reused from the previous run
+    };
+
     static Ptr make() { return std::make_shared<Integrator>(); }
 
     Integrator();
@@ -28,15 +61,53 @@ class Integrator {
     bool check_for_integration();
 
     bool create(lava::app& app);
+    // Creates the integrator without an app, so that there is no window, camera or render pass (--headless)
+    bool create(lava::device_p device, const argh::parser& cmd_line);
     void destroy();
 
+    // Integrates on the calling thread instead of the frame loop, the dataset has to be loaded
+    bool run_integration();
+    bool download_trajectories(const std::string& file_name);
+    // Copies the trajectories of the last run to the host and passes them to the function, which returns the result
+    bool read_trajectories(const std::function<bool(std::span<const glm::vec4>, std::span<const VkDrawIndirectCommand>)>& function);
+    std::optional<RunTimes> get_run_times() const;
+    // Velocity samples of all particles in the last run
+    std::optional<std::uint64_t> get_sample_count() const;
+
+    // The run stops at the next batch boundary, the batches in flight are completed
+    void cancel_integration() { this->scheduler.cancel(); }
+    // Like cancel_integration(), but safe to call from a signal handler
+    void interrupt_integration() { this->scheduler.interrupt(); }
+    bool is_integration_cancelled() const { return this->scheduler.get_state() == IntegrationScheduler::State::Cancelled; }
+
+    float get_delta_time() const { return this->delta_time; }
+    // Overrides the time step that set_settings() derives from the number of steps
+    void set_delta_time(float delta_time);
+    bool is_analytic_dataset() const { return this->analytic_dataset; }
+    Dataset::Ptr get_dataset() const { return this->dataset; }
+    IntegrationSettings get_settings() const;
+    // Only recreates the pipelines whose specialization constants change
+    void set_settings(const IntegrationSettings& settings);
+    // Every combination of settings and dataset is logged to its own csv file, unless it is disabled
+    void set_run_log_enabled(bool enabled);
+
+    // Identifies the device, the dataset, the interpolation and the method for the autotuner (--autotune)
+    std::string get_autotune_key() const;
+    AutotuneCache& get_autotune_cache() { return this->autotune_cache; }
+
+    std::optional<std::string> get_trajectory_file() const { return this->command_parser.get_trajectory_file(); }
+    uint32_t get_repetition_count() const { return this->command_parser.get_repetition_count().value_or(1); }
+    std::optional<float> get_repetition_delay() const { return this->command_parser.get_repetition_delay(); }
+    std::optional<SweepGrid> get_sweep_grid() const { return this->command_parser.get_sweep_grid(); }
+
     bool create_render_pipeline();
     void destroy_render_pipeline();
 
   private:
     bool create_max_velocity_magnitude_buffer();
+    bool create_work_queue_buffer();
     bool create_command_pool();
-    bool create_query_pool();
+    bool create_query_pool(std::uint32_t query_count);
 
     bool create_descriptor();
     void destroy_descriptor();
@@ -47,20 +118,60 @@ class Integrator {
     bool create_integration_pipeline();
     void destroy_integration_pipeline();
 
+    // The settings that are specialization constants of the integration pipeline
+    struct PipelineVariant {
+        glm::uvec3 work_group_size;
+        std::uint32_t particles_per_invocation;
+        bool explicit_interpolation;
+        bool cubic_interpolation;
+        IntegrationMethod integration_method;
+        bool analytic_dataset;
+        bool subgroup_counters;
+        bool work_queue;
+
+        bool operator==(const PipelineVariant& other) const = default;
+    };
+    PipelineVariant get_pipeline_variant() const;
+    // Every invocation of the integration kernel integrates particles_per_invocation seeds along the x axis, with a work
+    // queue only the persistent work groups are dispatched
+    glm::uvec3 get_integration_work_group_count() const;
+    // The persistent invocations take the work items of a batch from the start of the queue
+    void record_work_queue_reset(VkCommandBuffer command_buffer) const;
+
+    // Both are called from the threads that pre-warm the pipeline cache
+    lava::compute_pipeline::ptr make_seeding_pipeline(lava::pipeline_layout::ptr layout, const glm::uvec3& work_group_size) const;
+    // Without a specialization, the generic kernel that was compiled at build time is used
+    lava::compute_pipeline::ptr make_integration_pipeline(lava::pipeline_layout::ptr layout, const PipelineVariant& variant, const std::optional<KernelSpecialization>& specialization) const;
+    // The specialization of the integration kernel for the current settings, nothing if the generic kernel is used
+    std::optional<KernelSpecialization> get_kernel_specialization() const;
+    // Creates the pipeline variants that the next runs are likely to need on worker threads, so that the pipeline cache
+    // already contains them when they are created for an integration
+    void prewarm_pipelines();
+    void wait_for_pipeline_prewarm();
+
     void write_dataset_to_descriptor();
     void destroy_integration();
 
     void reset_dataset();
+    void apply_autotune_result();
     bool prepare_integration();
     bool integrate();
     bool perform_seeding(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, Constants& constants);
     bool perform_integration(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, Constants& constants);
+    // Records all batches in advance and submits them at once (--single_submission)
+    bool perform_recorded_integration(lava::timer& timer, Constants& constants);
     bool submit_and_measure_command(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer, std::function<void()> function);
-
-    bool download_trajectories(const std::string& file_name);
-    bool write_trajectories(const std::string& file_name, std::span<glm::vec4> line_buffer, std::span<VkDrawIndirectCommand> indirect_buffer);
-
-    lava::app* app;
+    // Without timeline semaphores, the completion of a command buffer is polled with a fence
+    bool submit_with_fence(VkCommandBuffer command_buffer, VkFence fence, lava::timer& timer);
+    // Releases the resources of a cancelled run, returns false in any case
+    bool abort_integration(VkCommandBuffer command_buffer, VkFence fence);
+    void cancel_integration_thread();
+
+    lava::app* app = nullptr; // Not set in headless mode
+    PipelineCache pipeline_cache;
+    mutable KernelCompiler kernel_compiler; // Internally synchronized, also used by the threads that pre-warm the pipelines
+    std::unique_ptr<ThreadPool> prewarm_pool;
+    lava::pipeline_layout::ptr prewarm_pipeline_layout;
     Dataset::Ptr dataset;
 
     struct Integration {
@@ -70,6 +181,14 @@ class Integrator {
         VkBuffer indirect_buffer;
         VmaAllocation indirect_buffer_allocation;
 
+        VkBuffer particle_state_buffer;
+        VmaAllocation particle_state_buffer_allocation;
+
+        std::size_t line_buffer_size = 0;
+        std::size_t indirect_buffer_size = 0;
+        std::size_t particle_state_buffer_size = 0;
+        bool descriptor_outdated = true;
+
         unsigned int seed_count;
         unsigned int integration_steps;
 
@@ -78,21 +197,27 @@ class Integrator {
 
         double gpu_time = 0.0;
         double cpu_time = 0.0;
+        RunTimes run_times;
+        std::uint64_t sample_count = 0;
 
         bool seeding_complete = false;
         bool integration_complete = false;
+        bool cancelled = false; // The trajectories end after the last completed batch
 
-        bool create_buffers(glm::uvec3 seed_spawn, std::uint32_t integration_steps, lava::device_p device, const lava::queue& compute_queue);
+        // Only recreates the buffers if they are too small for the seeds and steps
+        bool reserve_buffers(glm::uvec3 seed_spawn, std::uint32_t integration_steps, lava::device_p device, const lava::queue& compute_queue);
         void update_descriptor_set(lava::device_p device, VkDescriptorSet descriptor_set);
-        void destroy(lava::device_p device, VkCommandPool command_pool);
+        void destroy(lava::device_p device);
     };
     std::optional<Integration> integration;
 
     std::ofstream log_file;
+    bool run_log_enabled = true;
     unsigned int run;
 
     // Compute
     lava::buffer::ptr max_velocity_magnitude_buffer;
+    lava::buffer::ptr work_queue_buffer;
     lava::device_p device;
     lava::queue compute_queue;
 
@@ -101,13 +226,18 @@ class Integrator {
     VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
     VkCommandPool command_pool = VK_NULL_HANDLE;
     VkQueryPool query_pool = VK_NULL_HANDLE;
+    std::uint32_t query_count = 0;
+    IntegrationScheduler scheduler;
 
     lava::pipeline_layout::ptr seeding_pipeline_layout;
     lava::compute_pipeline::ptr seeding_pipeline;
 
     lava::pipeline_layout::ptr integration_pipeline_layout;
     lava::compute_pipeline::ptr integration_pipeline;
+    std::optional<KernelSpecialization> integration_specialization; // The specialization of the integration pipeline
+    bool recreate_seeding_pipeline = true;
     bool recreate_integration_pipeline = true;
+    AutotuneCache autotune_cache;
 
     // Rendering
     lava::pipeline_layout::ptr render_pipeline_layout;
@@ -123,12 +253,27 @@ class Integrator {
     // Integration settings
     CommandParser command_parser;
     glm::uvec3 work_group_size = {8, 1, 1};
+    unsigned int particles_per_invocation = 1;
     glm::uvec3 seed_spawn = {20, 20, 20};
     float delta_time = 0.1;
     unsigned int integration_steps = 10000;
-    unsigned int batch_size = 100;
+    unsigned int batch_size = 100; // The size of the first batch if the batch size is adaptive
+    bool adaptive_batch_size = false;
+    float batch_duration = 50.0f; // Target GPU time of a batch in ms if the batch size is adaptive
+    bool single_submission = false;
     bool explicit_interpolation = false;
+    bool cubic_interpolation = false; // Catmull-Rom instead of linear interpolation of the voxels
+    IntegrationMethod integration_method = IntegrationMethod::RungeKutta4;
+    float absolute_tolerance = 1.0e-3f; // Of the adaptive method in voxels
+    float relative_tolerance = 0.0f;
+    bool specialized_kernel = false;
     bool analytic_dataset = false;
+    bool subgroup_counters = true; // Reduces the statistics of a batch with subgroup operations, see integration.glsl
+    bool subgroup_counters_supported = false;
+    bool work_queue = false; // Persistent invocations take the seeds from a queue, see integration.glsl
+    unsigned int persistent_work_group_count = 0; // Dispatched with a work queue, 0 for a subgroup per compute unit
+    unsigned int compute_unit_count = 0;
+    unsigned int subgroup_size = 1;
     bool should_integrate = false;
     uint32_t repetitions_remaining = 0;
 
@@ -0,0 +1,221 @@
+#include "kernel_compiler.hpp"
+#include "shaders.hpp"
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <liblava/util/log.hpp>
+#include <memory>
+#include <shaderc/shaderc.hpp>
+#include <spdlog/fmt/bundled/core.h>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+constexpr std::uint32_t SPIRV_MAGIC = 0x07230203;
+constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+constexpr std::uint64_t FNV_PRIME = 0x100000001b3;
+
+struct ShaderSource {
+    std::string_view name;
+    std::string_view text;
+};
+
+// The sources of the integration kernels and the files they include, as they were embedded at build time
+std::array<ShaderSource, 5> get_shader_sources() {
+    return {{
+        {"integrate_raw.comp", integrate_raw_comp_source},
+        {"integrate_bc6h.comp", integrate_bc6h_comp_source},
+        {"integrate_analytic.comp", integrate_analytic_comp_source},
+        {"integration.glsl", integration_glsl_source},
+        {"analytic_vector_field.glsl", analytic_vector_field_glsl_source},
+    }};
+}
+
+ShaderSource get_kernel_source(KernelSource source) {
+    switch (source) {
+        case KernelSource::RawTextures:
+            return get_shader_sources()[0];
+        case KernelSource::BC6HTexture:
+            return get_shader_sources()[1];
+        case KernelSource::Analytic:
+            return get_shader_sources()[2];
+    }
+    return get_shader_sources()[0];
+}
+
+// The preprocessor definitions that replace the push constants in integration.glsl and select its optional features
+std::vector<std::pair<std::string, std::string>> get_definitions(const KernelSpecialization& specialization) {
+    const glm::uvec4& dimensions = specialization.dataset_dimensions;
+
+    // fmt writes the shortest representation of the time step that is parsed as the same float
+    std::vector<std::pair<std::string, std::string>> definitions = {
+        {"SPECIALIZED_DATASET_DIMENSIONS", fmt::format("vec4({}, {}, {}, {})", dimensions.x, dimensions.y, dimensions.z, dimensions.w)},
+        {"SPECIALIZED_DT", fmt::format("float({})", specialization.delta_time)},
+        {"SPECIALIZED_TOTAL_STEP_COUNT", fmt::format("{}u", specialization.total_step_count)},
+    };
+    if (specialization.step_count > 0) {
+        definitions.emplace_back("SPECIALIZED_STEP_COUNT", fmt::format("{}u", specialization.step_count));
+    }
+    if (specialization.subgroup_arithmetic) {
+        definitions.emplace_back("SUBGROUP_ARITHMETIC", "1");
+    }
+
+    return definitions;
+}
+
+// FNV-1a, which unlike std::hash is the same for every build
+std::uint64_t hash(std::uint64_t value, std::string_view data) {
+    for (char byte : data) {
+        value = (value ^ std::uint8_t(byte)) * FNV_PRIME;
+    }
+    // Separates consecutive strings, so that moving characters between them changes the hash
+    return (value ^ 0xff) * FNV_PRIME;
+}
+
+// Resolves the includes of the kernels with the embedded sources instead of the file system
+class EmbeddedSourceIncluder : public shaderc::CompileOptions::IncluderInterface {
+  public:
+    shaderc_include_result* GetInclude(const char* requested_source, shaderc_include_type type, const char* requesting_source, std::size_t include_depth) override {
+        shaderc_include_result* result = new shaderc_include_result{};
+
+        for (const ShaderSource& source : get_shader_sources()) {
+            if (source.name == requested_source) {
+                result->source_name = source.name.data();
+                result->source_name_length = source.name.size();
+                result->content = source.text.data();
+                result->content_length = source.text.size();
+                return result;
+            }
+        }
+
+        // An empty source name reports an error with the content as message
+        static constexpr std::string_view UNKNOWN_INCLUDE = "the file is not embedded into the application";
+        result->content = UNKNOWN_INCLUDE.data();
+        result->content_length = UNKNOWN_INCLUDE.size();
+
+        return result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* data) override {
+        delete data;
+    }
+};
+
+} // namespace
+
+void KernelCompiler::create(const std::filesystem::path& directory) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->directory = directory;
+    this->kernels.clear();
+}
+
+std::optional<std::vector<std::uint32_t>> KernelCompiler::get_kernel(const KernelSpecialization& specialization) {
+    const ShaderSource kernel_source = get_kernel_source(specialization.source);
+    const std::vector<std::pair<std::string, std::string>> definitions = get_definitions(specialization);
+
+    std::uint64_t key = hash(FNV_OFFSET_BASIS, std::to_string(KernelCompiler::FILE_VERSION));
+    for (const ShaderSource& source : get_shader_sources()) {
+        key = hash(hash(key, source.name), source.text);
+    }
+    key = hash(key, kernel_source.name);
+    for (const auto& [name, value] : definitions) {
+        key = hash(hash(key, name), value);
+    }
+
+    const std::string_view kernel_name = kernel_source.name.substr(0, kernel_source.name.find('.'));
+    const std::string file_name = fmt::format("{}-{:016x}.spv", kernel_name, key);
+
+    // Kernels are rarely compiled, so the lock is held during the compilation, which also prevents that two threads
+    // compile the same kernel
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    const auto iterator = this->kernels.find(file_name);
+    if (iterator != this->kernels.end()) {
+        return iterator->second;
+    }
+
+    const std::filesystem::path path = this->directory / file_name;
+    if (std::optional<std::vector<std::uint32_t>> kernel = this->load_kernel(path)) {
+        lava::log()->debug("specialized kernel '{}' loaded", path.string());
+        this->kernels[file_name] = kernel.value();
+        return kernel;
+    }
+
+    shaderc::CompileOptions options;
+    // Like the kernels compiled at build time, only the kernels with subgroup operations require Vulkan 1.1
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, specialization.subgroup_arithmetic ? shaderc_env_version_vulkan_1_1 : shaderc_env_version_vulkan_1_0);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.SetIncluder(std::make_unique<EmbeddedSourceIncluder>());
+    for (const auto& [name, value] : definitions) {
+        options.AddMacroDefinition(name, value);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    shaderc::Compiler compiler;
+    const shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(kernel_source.text.data(), kernel_source.text.size(), shaderc_compute_shader, kernel_source.name.data(), "main", options);
+
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+        lava::log()->error("failed to compile specialized kernel {}: {}", kernel_source.name, result.GetErrorMessage());
+        return std::nullopt;
+    }
+
+    std::vector<std::uint32_t> kernel(result.cbegin(), result.cend());
+    lava::log()->debug("specialized kernel {} compiled ({} ms)", file_name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    // A kernel that cannot be stored is only compiled again in the next launch
+    this->save_kernel(path, kernel);
+    this->kernels[file_name] = kernel;
+
+    return kernel;
+}
+
+std::optional<std::vector<std::uint32_t>> KernelCompiler::load_kernel(const std::filesystem::path& path) const {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    const std::streamsize size = file.tellg();
+    if (size <= 0 || size % sizeof(std::uint32_t) != 0) {
+        lava::log()->warn("specialized kernel '{}' is invalid, it is compiled again", path.string());
+        return std::nullopt;
+    }
+
+    std::vector<std::uint32_t> kernel(size / sizeof(std::uint32_t));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(kernel.data()), size) || kernel.front() != SPIRV_MAGIC) {
+        lava::log()->warn("specialized kernel '{}' is invalid, it is compiled again", path.string());
+        return std::nullopt;
+    }
+
+    return kernel;
+}
+
+bool KernelCompiler::save_kernel(const std::filesystem::path& path, const std::vector<std::uint32_t>& kernel) const {
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+    if (error) {
+        lava::log()->warn("failed to create directory '{}' for specialized kernels: {}", this->directory.string(), error.message());
+        return false;
+    }
+
+    // Written to a temporary file first, so that an interrupted write does not leave a truncated kernel behind
+    const std::filesystem::path temporary_path = std::filesystem::path(path).concat(".tmp");
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(kernel.data()), kernel.size() * sizeof(std::uint32_t))) {
+            lava::log()->warn("failed to write specialized kernel '{}'", temporary_path.string());
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        lava::log()->warn("failed to write specialized kernel '{}': {}", path.string(), error.message());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <glm/vec4.hpp>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// The compute shader that a kernel is compiled from, depending on the dataset
+enum class KernelSource {
+    RawTextures, // integrate_raw.comp
+    BC6HTexture, // integrate_bc6h.comp
+    Analytic,    // integrate_analytic.comp
+};
+
+// Values that a specialized kernel contains as literals instead of reading them from the push constants. They are the
+// same for every batch of a run, so that the compiler can fold the normalization of the texture coordinates, the bounds
+// checks and the trip count of the loop over the steps.
+struct KernelSpecialization {
+    KernelSource source;
+    glm::uvec4 dataset_dimensions;
+    float delta_time;
+    std::uint32_t total_step_count;
+    std::uint32_t step_count; // Steps of every batch, 0 if the batches of the run differ in size
+    bool subgroup_arithmetic; // Compiles the subgroup reduction of the counters, see integration.glsl
+
+    bool operator==(const KernelSpecialization& other) const = default;
+};
+
+// Compiles integration kernels for a specialization at runtime with shaderc (--specialize_kernels). The SPIR-V of every
+// kernel is stored in its own file in a directory, named after a hash of the embedded shader sources and the
+// specialization, so that a kernel is only compiled once. The kernels of the current launch are also kept in memory.
+class KernelCompiler {
+  public:
+    static constexpr const char* DEFAULT_DIRECTORY = "bc6h-integrator-kernels";
+    static constexpr std::uint32_t FILE_VERSION = 2; // Part of the hash, so that files of other versions are not used
+
+    void create(const std::filesystem::path& directory);
+
+    // Can be called from multiple threads, nothing if the kernel cannot be compiled
+    std::optional<std::vector<std::uint32_t>> get_kernel(const KernelSpecialization& specialization);
+
+  private:
+    std::optional<std::vector<std::uint32_t>> load_kernel(const std::filesystem::path& path) const;
+    bool save_kernel(const std::filesystem::path& path, const std::vector<std::uint32_t>& kernel) const;
+
+    std::filesystem::path directory;
+    std::mutex mutex;
+    std::map<std::string, std::vector<std::uint32_t>> kernels; // Kernels of this launch by file name
+};
@@ -1,6 +1,184 @@
 #include "application.hpp"
+#include "autotuner.hpp"
+#include "cpu_benchmark.hpp"
+#include "cpu_integrator.hpp"
+#include "method_benchmark.hpp"
+#include "parameter_sweep.hpp"
+#include "timeline_semaphore.hpp"
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+
+// Integration on the CPU (--cpu_integration) runs without any window or Vulkan device
+int run_cpu_integration(const argh::parser& cmd_line) {
+    // Usually the engine sets up the logger
+    lava::setup_log();
+
+    auto integrator = CpuIntegrator::make();
+    if (!integrator->create(cmd_line)) {
+        return lava::error::not_ready;
+    }
+
+    const auto& pos_args = cmd_line.pos_args();
+    if (pos_args.size() <= 1) {
+        lava::log()->error("cpu integration requires a dataset");
+        return lava::error::not_ready;
+    }
+
+    const std::filesystem::path dataset_path = pos_args.back();
+    lava::log()->debug("load dataset: {}", dataset_path.string());
+    if (!integrator->set_dataset(DataSource::open_file(dataset_path))) {
+        return lava::error::not_ready;
+    }
+
+    for (uint32_t run = 0; run < integrator->get_repetition_count(); ++run) {
+        if (!integrator->integrate()) {
+            return lava::error::not_ready;
+        }
+    }
+
+    if (integrator->get_trajectory_file().has_value()) {
+        if (!integrator->download_trajectories(integrator->get_trajectory_file().value())) {
+            return lava::error::not_ready;
+        }
+    }
+
+    return 0;
+}
+
+// Ctrl+C cancels the integration in headless mode at the next batch boundary, so that the batches in flight complete
+// and the device is destroyed properly
+class InterruptHandler {
+  public:
+    explicit InterruptHandler(Integrator* integrator) {
+        InterruptHandler::integrator = integrator;
+        std::signal(SIGINT, InterruptHandler::interrupt);
+    }
+    ~InterruptHandler() {
+        std::signal(SIGINT, SIG_DFL);
+        InterruptHandler::integrator = nullptr;
+    }
+
+  private:
+    static void interrupt(int) {
+        if (InterruptHandler::integrator != nullptr) {
+            InterruptHandler::integrator->interrupt_integration();
+        }
+    }
+
+    static inline Integrator* integrator = nullptr;
+};
+
+// Integration on the GPU without a window (--headless) only creates a Vulkan device, there is no swapchain, render pass,
+// UI or frame loop. The integrations run one after another on the main thread. A parameter sweep (--sweep) runs the same
+// way, but integrates every dataset on the command line with every configuration of the grid. The autotuner (--autotune)
+// searches the fastest work group size for the dataset instead and stores it for the following runs, and the method
+// benchmark (--method_benchmark) compares the speed and error of the integration methods.
+int run_headless_integration(const argh::parser& cmd_line) {
+#if defined(GLFW_PLATFORM_NULL)
+    // The frame initializes GLFW, which fails on machines without a display unless no window system is requested
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+
+    // Declared first, so that the integrator and the dataset release their resources before the device is destroyed
+    lava::frame frame(cmd_line);
+    if (!frame.ready()) {
+        return lava::error::not_ready;
+    }
+
+    // The queues have to match the indices in queues.hpp, presentation is not needed
+    frame.platform.on_create_param = [](lava::device::create_param& device_param) {
+        std::erase_if(device_param.extensions, [](lava::name extension) { return std::strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; });
+        device_param.add_queue(VK_QUEUE_COMPUTE_BIT, 1.0);
+        device_param.add_queue(VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT, 1.0);
+        enable_timeline_semaphore(device_param);
+    };
+
+    lava::device_p device = frame.platform.create_device();
+    if (!device) {
+        lava::log()->error("failed to create device for headless integration");
+        return lava::error::create_failed;
+    }
+
+    auto integrator = Integrator::make();
+    if (!integrator->create(device, cmd_line)) {
+        return lava::error::not_ready;
+    }
+    InterruptHandler interrupt_handler(integrator.get());
+
+    const auto& pos_args = cmd_line.pos_args();
+    if (pos_args.size() <= 1) {
+        lava::log()->error("headless integration requires a dataset");
+        return lava::error::not_ready;
+    }
+
+    if (cmd_line["sweep"]) {
+        const std::vector<std::filesystem::path> dataset_paths(pos_args.begin() + 1, pos_args.end());
+        const bool success = run_parameter_sweep(device, *integrator, integrator->get_sweep_grid().value_or(SweepGrid()), dataset_paths, integrator->get_repetition_count());
+        return success ? 0 : integrator->is_integration_cancelled() ? lava::error::aborted : lava::error::not_ready;
+    }
+
+    const std::filesystem::path dataset_path = pos_args.back();
+    lava::log()->debug("load dataset: {}", dataset_path.string());
+    DataSource::Ptr data = DataSource::open_file(dataset_path);
+    if (!data) {
+        return lava::error::not_ready;
+    }
+
+    Dataset::Ptr dataset = Dataset::make(device, data);
+    if (!dataset || !dataset->wait_for_loading()) {
+        lava::log()->error("failed to load dataset '{}'", dataset_path.string());
+        return lava::error::not_ready;
+    }
+    integrator->set_dataset(dataset);
+
+    if (cmd_line["autotune"]) {
+        return run_autotune(device, *integrator, integrator->get_autotune_cache()) ? 0 : lava::error::not_ready;
+    }
+
+    if (cmd_line["method_benchmark"]) {
+        return run_method_benchmark(*integrator) ? 0 : integrator->is_integration_cancelled() ? lava::error::aborted : lava::error::not_ready;
+    }
+
+    for (uint32_t run = 0; run < integrator->get_repetition_count(); ++run) {
+        if (run > 0 && integrator->get_repetition_delay().has_value()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds((uint32_t)integrator->get_repetition_delay().value()));
+        }
+
+        if (!integrator->run_integration()) {
+            return integrator->is_integration_cancelled() ? lava::error::aborted : lava::error::not_ready;
+        }
+
+        const Integrator::RunTimes run_times = integrator->get_run_times().value();
+        lava::log()->info("integration run {} ({}): setup {} ms (CPU), seeding {} ms (GPU), {} ms (CPU), integration {} ms (GPU), {} ms (CPU)", run, get_integration_method_name(integrator->get_settings().integration_method), run_times.setup_cpu, run_times.seeding_gpu, run_times.seeding_cpu, run_times.integration_gpu, run_times.integration_cpu);
+    }
+
+    if (integrator->get_trajectory_file().has_value()) {
+        if (!integrator->download_trajectories(integrator->get_trajectory_file().value())) {
+            return lava::error::not_ready;
+        }
+    }
+
+    return 0;
+}
 
 int main(int argc, char* argv[]) {
+    const argh::parser cmd_line(argc, argv);
+    if (cmd_line["cpu_benchmark"]) {
+        lava::setup_log();
+        return run_cpu_benchmark() ? 0 : lava::error::not_ready;
+    }
+
+    if (cmd_line["cpu_integration"]) {
+        return run_cpu_integration(cmd_line);
+    }
+
+    if (cmd_line["headless"] || cmd_line["sweep"] || cmd_line["autotune"] || cmd_line["method_benchmark"]) {
+        return run_headless_integration(cmd_line);
+    }
+
     Application app(argc, argv);
 
     if (!app.setup()) {
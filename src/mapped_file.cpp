@@ -0,0 +1,123 @@
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <liblava/util/log.hpp>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_POSIX
+#endif
+
+namespace {
+
+#if defined(MAPPED_FILE_POSIX)
+std::size_t get_page_size() {
+    static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return page_size;
+}
+#endif
+
+} // namespace
+
+MappedFile::~MappedFile() {
+#if defined(MAPPED_FILE_POSIX)
+    if (this->memory != nullptr) {
+        munmap(this->memory, this->mapped_size);
+    }
+    if (this->file_descriptor >= 0) {
+        close(this->file_descriptor);
+    }
+#endif
+}
+
+MappedFile::Ptr MappedFile::make(const std::string& path) {
+#if defined(MAPPED_FILE_POSIX)
+    const int file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        lava::log()->error("mapped file: failed to open '{}'", path);
+        return nullptr;
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size <= 0) {
+        lava::log()->error("mapped file: failed to determine the size of '{}'", path);
+        close(file_descriptor);
+        return nullptr;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(file_status.st_size);
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    if (memory == MAP_FAILED) {
+        lava::log()->error("mapped file: failed to map '{}'", path);
+        close(file_descriptor);
+        return nullptr;
+    }
+
+    // The accesses jump between slices, reading ahead within the file would only waste memory
+    madvise(memory, size, MADV_RANDOM);
+
+    return std::make_shared<MappedFile>(file_descriptor, static_cast<std::uint8_t*>(memory), size);
+#else
+    lava::log()->error("mapped file: memory mapped files are not supported on this platform ('{}')", path);
+    return nullptr;
+#endif
+}
+
+void MappedFile::will_need(std::size_t offset, std::size_t size) const {
+#if defined(MAPPED_FILE_POSIX)
+    const std::size_t begin = offset / get_page_size() * get_page_size();
+    const std::size_t end = std::min(offset + size, this->mapped_size);
+    if (begin < end) {
+        madvise(this->memory + begin, end - begin, MADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+void MappedFile::dont_need(std::size_t offset, std::size_t size) const {
+#if defined(MAPPED_FILE_POSIX)
+    // Pages that are shared with the neighbouring ranges are kept
+    const std::size_t begin = (offset + get_page_size() - 1) / get_page_size() * get_page_size();
+    const std::size_t end = std::min(offset + size, this->mapped_size) / get_page_size() * get_page_size();
+    if (begin < end) {
+        madvise(this->memory + begin, end - begin, MADV_DONTNEED);
+#if defined(POSIX_FADV_DONTNEED)
+        posix_fadvise(this->file_descriptor, static_cast<off_t>(begin), static_cast<off_t>(end - begin), POSIX_FADV_DONTNEED);
+#endif
+    }
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+std::size_t MappedFile::get_resident_size(std::size_t offset, std::size_t size) const {
+#if defined(MAPPED_FILE_POSIX)
+    const std::size_t begin = offset / get_page_size() * get_page_size();
+    const std::size_t end = std::min(offset + size, this->mapped_size);
+    if (begin >= end) {
+        return 0;
+    }
+
+#if defined(__APPLE__)
+    std::vector<char> pages((end - begin + get_page_size() - 1) / get_page_size());
+#else
+    std::vector<unsigned char> pages((end - begin + get_page_size() - 1) / get_page_size());
+#endif
+    if (mincore(this->memory + begin, end - begin, pages.data()) != 0) {
+        return 0;
+    }
+
+    const std::size_t resident_page_count = std::count_if(pages.begin(), pages.end(), [](auto page) { return (page & 1) != 0; });
+    return resident_page_count * get_page_size();
+#else
+    (void)offset;
+    (void)size;
+    return 0;
+#endif
+}
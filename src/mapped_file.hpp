@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only memory mapping of a whole file, which is used to integrate datasets that do not fit into memory.
+// The operating system reads the pages when they are first accessed. Since the pages stay in the page cache until they
+// are evicted, ranges that are not needed anymore have to be released explicitly with dont_need().
+// Only supported on POSIX systems.
+class MappedFile {
+  public:
+    using Ptr = std::shared_ptr<MappedFile>;
+
+    MappedFile(int file_descriptor, std::uint8_t* memory, std::size_t size) : file_descriptor(file_descriptor), memory(memory), mapped_size(size) {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    static Ptr make(const std::string& path);
+
+    const std::uint8_t* data() const { return this->memory; }
+    std::size_t size() const { return this->mapped_size; }
+
+    // Starts reading the pages of the range in the background
+    void will_need(std::size_t offset, std::size_t size) const;
+    // Unmaps the pages that lie completely inside of the range and drops them from the page cache, they are read from
+    // the file again when they are accessed
+    void dont_need(std::size_t offset, std::size_t size) const;
+    // Bytes of the range that are in memory, rounded to whole pages
+    std::size_t get_resident_size(std::size_t offset, std::size_t size) const;
+
+  private:
+    int file_descriptor = -1;
+    std::uint8_t* memory = nullptr;
+    std::size_t mapped_size = 0;
+};
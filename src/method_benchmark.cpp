@@ -0,0 +1,335 @@
+#include "method_benchmark.hpp"
+#include "cpu_sampling.hpp"
+#include "host_dataset.hpp"
+#include "integrator.hpp"
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <liblava/util/log.hpp>
+#include <map>
+#include <optional>
+#include <spdlog/fmt/bundled/core.h>
+#include <spdlog/fmt/bundled/ostream.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t ERROR_SEED_COUNT = 128;  // Path lines that are compared to the reference
+constexpr std::uint32_t REFERENCE_SUBSTEPS = 16; // Steps of the reference per step of the integration
+constexpr std::uint32_t STEP_FACTORS[] = {1, 2, 4}; // Multiples of the time step at which the interpolations are compared
+
+struct MethodResult {
+    double integration_gpu = 0.0;   // Median in ms
+    std::size_t step_count = 0;     // Vertices of all particles until they left the dataset, also for the adaptive method
+    std::uint64_t sample_count = 0; // Velocity samples of all particles, counted by the shader
+    std::optional<double> mean_error; // Distance to the reference in voxels, nothing without reference path lines
+    std::optional<double> max_error;
+};
+
+// The reference path lines of a subset of the seeds, at the times of the vertices of the integration with the original
+// time step. They are integrated in the analytic field, unless the slices of a dataset are loaded.
+struct References {
+    std::uint32_t seed_count = 0;
+    std::uint32_t error_seed_count = 0;
+    double delta_time = 0.0;
+    std::uint32_t integration_steps = 0;
+    std::vector<std::vector<glm::dvec3>> path_lines; // Integrated from the seeds of the first run
+
+    CpuKernelSpecialization specialization = {.sampler = CpuSampler::Analytic};
+    HostDataset::Ptr dataset;
+    std::vector<const void*> slices;
+    CpuIntegrationContext context = {};
+};
+
+// Loads the slices of the dataset, whose voxels are interpolated with Catmull-Rom splines for the reference path lines.
+// A loaded dataset has no known path lines, so the reference is the path line through the continuous field that both
+// interpolations approximate, with the time step of the reference.
+bool load_reference_dataset(References& references, DataSource::Ptr data) {
+    references.dataset = HostDataset::make(data);
+    if (!references.dataset) {
+        return false;
+    }
+
+    switch (data->format) {
+        case DataSource::Format::Float32:
+            references.specialization.sampler = CpuSampler::Float32;
+            break;
+        case DataSource::Format::Float16:
+            references.specialization.sampler = CpuSampler::Float16;
+            break;
+        case DataSource::Format::BC6H:
+            references.specialization.sampler = CpuSampler::BC6H;
+            break;
+    }
+    references.specialization.explicit_interpolation = true;
+    references.specialization.cubic_interpolation = true;
+
+    references.slices.clear();
+    for (unsigned c = 0; c < references.dataset->get_slice_channel_count(); ++c) {
+        for (unsigned t = 0; t < data->dimensions.w; ++t) {
+            references.slices.push_back(references.dataset->get_slice(c, t));
+        }
+    }
+
+    references.context = {};
+    references.context.slices = references.slices.data();
+    references.context.z_slice_size = std::size_t(data->z_slice_size);
+    for (unsigned axis = 0; axis < 4; ++axis) {
+        references.context.dimensions[axis] = data->dimensions[axis];
+    }
+    references.context.explicit_interpolation = true;
+
+    return true;
+}
+
+// RK4 step in double precision, so that the rounding of the many small steps does not add to the error of the reference
+template <typename Sampler>
+glm::dvec3 integrate_reference_step(const Sampler& field, const glm::dvec3& position, double t, double dt) {
+    const auto sample = [&](const glm::dvec3& coordinates, double time) {
+        return glm::dvec3(field.sample_dataset(glm::vec4(glm::vec3(coordinates), float(time))));
+    };
+
+    const glm::dvec3 v1 = sample(position, t);
+    const glm::dvec3 v2 = sample(position + 0.5 * dt * v1, t + 0.5 * dt);
+    const glm::dvec3 v3 = sample(position + 0.5 * dt * v2, t + 0.5 * dt);
+    const glm::dvec3 v4 = sample(position + dt * v3, t + dt);
+
+    return position + dt * (v1 + 2.0 * v2 + 2.0 * v3 + v4) / 6.0;
+}
+
+// The positions of the reference path line at the times of the vertices of the integration
+std::vector<glm::dvec3> integrate_reference(const References& references, const glm::dvec3& seed) {
+    return visit_cpu_sampler(references.specialization, [&]<typename Sampler>() {
+        const Sampler field(references.context);
+        const double reference_delta_time = references.delta_time / REFERENCE_SUBSTEPS;
+
+        std::vector<glm::dvec3> positions;
+        positions.reserve(references.integration_steps + 1);
+        positions.push_back(seed);
+
+        glm::dvec3 position = seed;
+        for (std::uint32_t step = 0; step < references.integration_steps; ++step) {
+            for (std::uint32_t substep = 0; substep < REFERENCE_SUBSTEPS; ++substep) {
+                position = integrate_reference_step(field, position, step * references.delta_time + substep * reference_delta_time, reference_delta_time);
+            }
+            positions.push_back(position);
+        }
+
+        return positions;
+    });
+}
+
+// Formats an error for the log file, which leaves the column empty if the error is unknown
+std::string format_error(const std::optional<double>& error) {
+    return error.has_value() ? fmt::format("{}", error.value()) : std::string();
+}
+
+// Integrates with the current settings of the integrator, nothing if a run failed. Vertex i of the path lines is
+// compared to vertex i * step_factor of the reference path lines, since the time step is step_factor times larger.
+// Without references only the duration and the samples are measured.
+std::optional<MethodResult> measure(Integrator& integrator, References* references, std::uint32_t step_factor) {
+    std::vector<double> durations;
+    for (std::uint32_t run = 0; run < integrator.get_repetition_count(); ++run) {
+        if (!integrator.run_integration()) {
+            return std::nullopt;
+        }
+        durations.push_back(integrator.get_run_times().value().integration_gpu);
+    }
+    std::sort(durations.begin(), durations.end());
+
+    MethodResult result;
+    result.integration_gpu = durations[durations.size() / 2];
+    result.sample_count = integrator.get_sample_count().value_or(0);
+
+    const bool success = integrator.read_trajectories([&](std::span<const glm::vec4> line_buffer, std::span<const VkDrawIndirectCommand> indirect_buffer) {
+        for (const VkDrawIndirectCommand& command : indirect_buffer) {
+            result.step_count += command.vertexCount - 1;
+        }
+
+        if (references == nullptr) {
+            return true;
+        }
+
+        if (references->path_lines.empty()) {
+            lava::log()->info("method benchmark: integrating {} reference path lines", references->error_seed_count);
+            for (std::uint32_t seed = 0; seed < references->error_seed_count; ++seed) {
+                const VkDrawIndirectCommand& command = indirect_buffer[std::size_t(seed) * references->seed_count / references->error_seed_count];
+                references->path_lines.push_back(integrate_reference(*references, glm::dvec3(line_buffer[command.firstVertex])));
+            }
+        }
+
+        double error_sum = 0.0;
+        double max_error = 0.0;
+        std::size_t vertex_count = 0;
+        for (std::uint32_t seed = 0; seed < references->error_seed_count; ++seed) {
+            const VkDrawIndirectCommand& command = indirect_buffer[std::size_t(seed) * references->seed_count / references->error_seed_count];
+
+            for (std::uint32_t vertex = 1; vertex < command.vertexCount && std::size_t(vertex) * step_factor < references->path_lines[seed].size(); ++vertex) {
+                const double error = glm::distance(glm::dvec3(line_buffer[command.firstVertex + vertex]), references->path_lines[seed][std::size_t(vertex) * step_factor]);
+                error_sum += error;
+                max_error = std::max(max_error, error);
+                ++vertex_count;
+            }
+        }
+        result.mean_error = vertex_count > 0 ? error_sum / vertex_count : 0.0;
+        result.max_error = max_error;
+
+        return true;
+    });
+    if (!success) {
+        lava::log()->error("method benchmark: failed to read the path lines");
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+} // namespace
+
+bool run_method_benchmark(Integrator& integrator) {
+    const IntegrationSettings original_settings = integrator.get_settings();
+    const double delta_time = integrator.get_delta_time();
+
+    References references;
+    references.seed_count = original_settings.seed_spawn.x * original_settings.seed_spawn.y * original_settings.seed_spawn.z;
+    references.error_seed_count = std::min(ERROR_SEED_COUNT, references.seed_count);
+    references.delta_time = delta_time;
+    references.integration_steps = original_settings.integration_steps;
+
+    std::time_t t = std::time(0); // get time now
+    std::tm* now = std::localtime(&t);
+    const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-method-benchmark.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
+    std::ofstream file(filename);
+    if (!file) {
+        lava::log()->error("method benchmark: failed to create '{}'", filename);
+        return false;
+    }
+    fmt::print(file, "method,interpolation,step_factor,samples_per_step,timestep,integration_steps,seeds,runs,integration_gpu,steps,samples,steps_per_second,samples_per_second,error_seeds,mean_error,max_error\n");
+
+    const auto restore_settings = [&]() {
+        integrator.set_settings(original_settings);
+        integrator.set_delta_time(float(delta_time));
+    };
+
+    // The path lines of the analytic dataset are known, the errors of the methods on other datasets would only measure
+    // how far the vector field of the dataset is from the analytic one
+    References* method_references = &references;
+    if (!integrator.is_analytic_dataset()) {
+        lava::log()->warn("method benchmark: the errors of the methods are only computed for the analytic dataset");
+        method_references = nullptr;
+    }
+
+    // Integrates with the settings, then logs and writes the result. The seeds are the same for every run, so the
+    // reference path lines are only integrated once.
+    const auto run = [&](const IntegrationSettings& settings, std::uint32_t step_factor, References* references) -> std::optional<MethodResult> {
+        integrator.set_settings(settings);
+        integrator.set_delta_time(float(delta_time * step_factor));
+
+        const char* method_name = get_integration_method_name(settings.integration_method);
+        const char* interpolation_name = settings.cubic_interpolation ? "cubic" : "linear";
+
+        const std::optional<MethodResult> result = measure(integrator, references, step_factor);
+        if (!result.has_value()) {
+            restore_settings();
+            if (integrator.is_integration_cancelled()) {
+                lava::log()->warn("method benchmark: cancelled, results written to {}", filename);
+            } else {
+                lava::log()->error("method benchmark: integration with {} and {} interpolation failed", method_name, interpolation_name);
+            }
+            return std::nullopt;
+        }
+
+        // The adaptive method takes a different number of samples for every vertex
+        const double samples_per_step = result->step_count > 0 ? double(result->sample_count) / result->step_count : 0.0;
+        const double steps_per_second = result->integration_gpu > 0.0 ? result->step_count / (result->integration_gpu / 1000.0) : 0.0;
+
+        std::string error_text;
+        if (result->mean_error.has_value()) {
+            error_text = fmt::format(", error {:.3e} voxels (mean), {:.3e} voxels (max)", result->mean_error.value(), result->max_error.value());
+        }
+        const std::string error_seed_count = references != nullptr ? std::to_string(references->error_seed_count) : std::string();
+
+        lava::log()->info("method benchmark: {:>8}, {:>6} interpolation, {}x time step: {} ms (GPU, median), {:.3e} steps/s, {:.3e} samples/s, {:.2f} samples/step{}", method_name, interpolation_name, step_factor, result->integration_gpu, steps_per_second, steps_per_second * samples_per_step, samples_per_step, error_text);
+        fmt::print(file, "{},{},{},{},{},{},{},{},{},{},{},{},{},{},{},{}\n", method_name, interpolation_name, step_factor, samples_per_step, delta_time * step_factor, settings.integration_steps, references.seed_count, integrator.get_repetition_count(), result->integration_gpu, result->step_count, result->sample_count, steps_per_second, steps_per_second * samples_per_step, error_seed_count, format_error(result->mean_error), format_error(result->max_error));
+        file.flush();
+
+        return result;
+    };
+
+    std::map<IntegrationMethod, MethodResult> results;
+    for (IntegrationMethod method : {IntegrationMethod::Euler, IntegrationMethod::Midpoint, IntegrationMethod::RungeKutta4, IntegrationMethod::DormandPrince, IntegrationMethod::AdamsBashforthMoulton}) {
+        IntegrationSettings settings = original_settings;
+        settings.integration_method = method;
+
+        const std::optional<MethodResult> result = run(settings, 1, method_references);
+        if (!result.has_value()) {
+            return false;
+        }
+        results[method] = result.value();
+    }
+
+    // The methods that are meant to replace RK4 with fewer samples
+    const MethodResult& reference = results[IntegrationMethod::RungeKutta4];
+    for (IntegrationMethod method : {IntegrationMethod::DormandPrince, IntegrationMethod::AdamsBashforthMoulton}) {
+        const MethodResult& result = results[method];
+        if (reference.sample_count == 0) {
+            continue;
+        }
+        if (result.mean_error.has_value() && reference.mean_error.has_value()) {
+            lava::log()->info("method benchmark: {} takes {:.1f}% of the samples of rk4, error {:.3e} voxels instead of {:.3e} voxels (mean)", get_integration_method_name(method), 100.0 * result.sample_count / reference.sample_count, result.mean_error.value(), reference.mean_error.value());
+        } else {
+            lava::log()->info("method benchmark: {} takes {:.1f}% of the samples of rk4", get_integration_method_name(method), 100.0 * result.sample_count / reference.sample_count);
+        }
+    }
+
+    // Cubic interpolation is meant to reach the error of linear interpolation with a larger time step, so both are
+    // compared with RK4 at multiples of the time step. The analytic dataset is not interpolated at all. The reference
+    // path lines are integrated in the dataset, since the error of the interpolation is measured.
+    if (integrator.is_analytic_dataset()) {
+        lava::log()->info("method benchmark: the interpolation modes are not compared for the analytic dataset");
+    } else {
+        References interpolation_references = references;
+        if (!load_reference_dataset(interpolation_references, integrator.get_dataset()->data)) {
+            restore_settings();
+            lava::log()->error("method benchmark: failed to load the dataset for the reference path lines");
+            return false;
+        }
+
+        std::map<std::pair<bool, std::uint32_t>, MethodResult> interpolation_results;
+
+        for (bool cubic_interpolation : {false, true}) {
+            for (std::uint32_t step_factor : STEP_FACTORS) {
+                IntegrationSettings settings = original_settings;
+                settings.integration_method = IntegrationMethod::RungeKutta4;
+                settings.cubic_interpolation = cubic_interpolation;
+                settings.integration_steps = original_settings.integration_steps / step_factor;
+                settings.batch_size = std::min(original_settings.batch_size, settings.integration_steps);
+                if (settings.integration_steps == 0) {
+                    continue;
+                }
+
+                const std::optional<MethodResult> result = run(settings, step_factor, &interpolation_references);
+                if (!result.has_value()) {
+                    return false;
+                }
+                interpolation_results[{cubic_interpolation, step_factor}] = result.value();
+            }
+        }
+
+        const MethodResult& linear = interpolation_results[{false, 1}];
+        for (std::uint32_t step_factor : STEP_FACTORS) {
+            const auto cubic = interpolation_results.find({true, step_factor});
+            if (cubic != interpolation_results.end() && linear.integration_gpu > 0.0) {
+                lava::log()->info("method benchmark: cubic interpolation with {}x time step takes {:.1f}% of the time of linear interpolation, error {:.3e} voxels instead of {:.3e} voxels (mean)", step_factor, 100.0 * cubic->second.integration_gpu / linear.integration_gpu, cubic->second.mean_error.value_or(0.0), linear.mean_error.value_or(0.0));
+            }
+        }
+    }
+
+    restore_settings();
+    lava::log()->info("method benchmark results written to {}", filename);
+
+    return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+class Integrator;
+
+// Integrates the loaded dataset on the GPU with every integration method (--method_benchmark) and reports the steps per
+// second and the error of the path lines against the analytic ABC field. The error is measured for a subset of the
+// seeds against reference path lines that are integrated on the CPU with RK4 and a much smaller time step, so it is
+// only meaningful for the analytic dataset (--analytic_dataset) or a dataset that contains the ABC field. The results
+// are logged and written to a *-method-benchmark.csv file.
+bool run_method_benchmark(Integrator& integrator);
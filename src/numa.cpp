@@ -0,0 +1,254 @@
+#include "numa.hpp"
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <new>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t PAGE_SIZE = 4096;
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+std::size_t round_up(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#if defined(__linux__)
+// Parses lists like "0-3,8-11" of /sys/devices/system/node/node*/cpulist
+std::vector<unsigned> parse_cpu_list(const std::string& list) {
+    std::vector<unsigned> cpus;
+    std::size_t position = 0;
+
+    while (position < list.size()) {
+        const std::size_t end = std::min(list.find(',', position), list.size());
+        const std::string range = list.substr(position, end - position);
+        const std::size_t dash = range.find('-');
+
+        try {
+            const unsigned first = std::stoul(range.substr(0, dash));
+            const unsigned last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (unsigned cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+        position = end + 1;
+    }
+
+    return cpus;
+}
+#endif
+
+} // namespace
+
+NumaTopology NumaTopology::detect() {
+    NumaTopology topology;
+
+#if defined(__linux__)
+    std::vector<std::pair<unsigned, std::vector<unsigned>>> nodes;
+    std::error_code error;
+
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        std::vector<unsigned> cpus = parse_cpu_list(list);
+        if (!cpus.empty()) {
+            nodes.emplace_back(std::stoul(name.substr(4)), std::move(cpus));
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+    for (auto& [id, cpus] : nodes) {
+        topology.node_ids.push_back(id);
+        topology.node_cpus.push_back(std::move(cpus));
+    }
+#endif
+
+    if (topology.node_ids.empty()) {
+        std::vector<unsigned> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+        for (unsigned cpu = 0; cpu < cpus.size(); ++cpu) {
+            cpus[cpu] = cpu;
+        }
+        topology.node_ids.push_back(0);
+        topology.node_cpus.push_back(std::move(cpus));
+    }
+
+    return topology;
+}
+
+std::vector<unsigned> NumaTopology::assign_workers(unsigned worker_count, unsigned node_count) const {
+    node_count = std::clamp(node_count, 1u, this->get_node_count());
+    std::vector<unsigned> worker_nodes(worker_count);
+
+    for (unsigned worker = 0; worker < worker_count; ++worker) {
+        worker_nodes[worker] = static_cast<unsigned>(std::size_t(worker) * node_count / worker_count);
+    }
+
+    return worker_nodes;
+}
+
+bool NumaTopology::pin_current_thread(unsigned node) const {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (unsigned cpu : this->node_cpus[node]) {
+        CPU_SET(cpu, &cpu_set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+HostBuffer::HostBuffer(std::size_t size) : buffer_size(size) {
+    if (size == 0) {
+        return;
+    }
+
+#if defined(__linux__)
+    if (size >= HUGE_PAGE_SIZE) {
+        this->mapped_size = round_up(size, HUGE_PAGE_SIZE);
+        void* memory = mmap(nullptr, this->mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (memory != MAP_FAILED) {
+            this->memory = static_cast<std::uint8_t*>(memory);
+            this->pages = Pages::Huge;
+            return;
+        }
+    }
+
+    this->mapped_size = round_up(size, PAGE_SIZE);
+    void* memory = mmap(nullptr, this->mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    this->memory = static_cast<std::uint8_t*>(memory);
+
+    if (size >= HUGE_PAGE_SIZE && madvise(memory, this->mapped_size, MADV_HUGEPAGE) == 0) {
+        this->pages = Pages::TransparentHuge;
+    }
+#else
+    this->mapped_size = round_up(size, PAGE_SIZE);
+    this->memory = static_cast<std::uint8_t*>(::operator new(this->mapped_size, std::align_val_t(PAGE_SIZE)));
+#endif
+}
+
+HostBuffer::~HostBuffer() {
+    this->release();
+}
+
+HostBuffer::HostBuffer(HostBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+HostBuffer& HostBuffer::operator=(HostBuffer&& other) noexcept {
+    if (this != &other) {
+        this->release();
+        this->memory = std::exchange(other.memory, nullptr);
+        this->buffer_size = std::exchange(other.buffer_size, 0);
+        this->mapped_size = std::exchange(other.mapped_size, 0);
+        this->pages = std::exchange(other.pages, Pages::Small);
+    }
+    return *this;
+}
+
+bool HostBuffer::bind(const NumaTopology& topology, unsigned node) {
+    // A single node needs no policy, which also covers kernels without NUMA support
+    if (topology.get_node_count() == 1) {
+        return true;
+    }
+
+#if defined(__linux__)
+    return this->set_policy(MPOL_BIND, {topology.get_node_id(node)});
+#else
+    return false;
+#endif
+}
+
+bool HostBuffer::interleave(const NumaTopology& topology, unsigned node_count) {
+    node_count = std::clamp(node_count, 1u, topology.get_node_count());
+    if (node_count == 1) {
+        return this->bind(topology, 0);
+    }
+
+#if defined(__linux__)
+    std::vector<unsigned> node_ids;
+    for (unsigned node = 0; node < node_count; ++node) {
+        node_ids.push_back(topology.get_node_id(node));
+    }
+    return this->set_policy(MPOL_INTERLEAVE, node_ids);
+#else
+    return false;
+#endif
+}
+
+bool HostBuffer::set_policy(int mode, const std::vector<unsigned>& node_ids) {
+#if defined(__linux__)
+    if (this->memory == nullptr) {
+        return true;
+    }
+
+    // The kernel reads maxnode - 1 bits, the additional word keeps the highest node inside of the mask
+    constexpr std::size_t WORD_BITS = 8 * sizeof(unsigned long);
+    std::vector<unsigned long> node_mask(*std::max_element(node_ids.begin(), node_ids.end()) / WORD_BITS + 2, 0);
+    for (unsigned id : node_ids) {
+        node_mask[id / WORD_BITS] |= 1ul << (id % WORD_BITS);
+    }
+
+    // Calls mbind() directly, so that there is no dependency on libnuma
+    return syscall(SYS_mbind, this->memory, this->mapped_size, mode, node_mask.data(), node_mask.size() * WORD_BITS, 0) == 0;
+#else
+    (void)mode;
+    (void)node_ids;
+    return false;
+#endif
+}
+
+void HostBuffer::release() {
+    if (this->memory == nullptr) {
+        return;
+    }
+
+#if defined(__linux__)
+    munmap(this->memory, this->mapped_size);
+#else
+    ::operator delete(this->memory, std::align_val_t(PAGE_SIZE));
+#endif
+    this->memory = nullptr;
+}
+
+const char* get_host_buffer_pages_name(HostBuffer::Pages pages) {
+    switch (pages) {
+        case HostBuffer::Pages::Small:
+            return "small";
+        case HostBuffer::Pages::TransparentHuge:
+            return "transparent huge";
+        case HostBuffer::Pages::Huge:
+            return "huge";
+    }
+    return "unknown";
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Placement of the host copy of a dataset on the NUMA nodes of a multi-socket machine, see HostDataset::place()
+enum class NumaPlacement {
+    Off,        // The pages end up on the node of the thread that loaded the dataset (first touch)
+    Interleave, // The pages are distributed round robin over the nodes
+    Replicate,  // Every node holds a copy, which is sampled by the threads pinned to the node
+};
+
+inline const char* get_numa_placement_name(NumaPlacement placement) {
+    switch (placement) {
+        case NumaPlacement::Off:
+            return "off";
+        case NumaPlacement::Interleave:
+            return "interleave";
+        case NumaPlacement::Replicate:
+            return "replicate";
+    }
+    return "unknown";
+}
+
+inline std::optional<NumaPlacement> parse_numa_placement(std::string_view name) {
+    for (NumaPlacement placement : {NumaPlacement::Off, NumaPlacement::Interleave, NumaPlacement::Replicate}) {
+        if (name == get_numa_placement_name(placement)) {
+            return placement;
+        }
+    }
+    return std::nullopt;
+}
+
+// NUMA nodes of the machine and their CPUs, read from /sys/devices/system/node on Linux. Nodes without CPUs are
+// ignored, since no thread can be pinned to them. On other platforms or without NUMA support in the kernel, the machine
+// consists of a single node with all CPUs.
+class NumaTopology {
+  public:
+    static NumaTopology detect();
+
+    unsigned get_node_count() const { return static_cast<unsigned>(this->node_ids.size()); }
+    // Number of the node in the kernel, nodes are indexed from 0 to get_node_count() - 1 everywhere else
+    unsigned get_node_id(unsigned node) const { return this->node_ids[node]; }
+    const std::vector<unsigned>& get_cpus(unsigned node) const { return this->node_cpus[node]; }
+
+    // Node of each of worker_count workers spread evenly over the first node_count nodes. Consecutive workers share a
+    // node, so that the contiguous shares of the work stealing scheduler stay on one node.
+    std::vector<unsigned> assign_workers(unsigned worker_count, unsigned node_count) const;
+    // Restricts the calling thread to the CPUs of the node, the operating system still balances within the node
+    bool pin_current_thread(unsigned node) const;
+
+  private:
+    std::vector<unsigned> node_ids;
+    std::vector<std::vector<unsigned>> node_cpus;
+};
+
+// Page aligned host memory that can be bound to NUMA nodes.
+// Buffers of at least one huge page are backed by reserved huge pages (MAP_HUGETLB) if the system provides them and
+// by transparent huge pages otherwise, which reduces the TLB misses of samples that are spread over the whole dataset.
+// Pages are placed when they are first written, so a buffer has to be bound before it is filled.
+class HostBuffer {
+  public:
+    enum class Pages {
+        Small,
+        TransparentHuge,
+        Huge,
+    };
+
+    HostBuffer() = default;
+    explicit HostBuffer(std::size_t size);
+    ~HostBuffer();
+
+    HostBuffer(HostBuffer&& other) noexcept;
+    HostBuffer& operator=(HostBuffer&& other) noexcept;
+    HostBuffer(const HostBuffer&) = delete;
+    HostBuffer& operator=(const HostBuffer&) = delete;
+
+    // Places all pages on the node
+    bool bind(const NumaTopology& topology, unsigned node);
+    // Distributes the pages round robin over the first node_count nodes
+    bool interleave(const NumaTopology& topology, unsigned node_count);
+
+    std::uint8_t* data() { return this->memory; }
+    const std::uint8_t* data() const { return this->memory; }
+    std::size_t size() const { return this->buffer_size; }
+    Pages get_pages() const { return this->pages; }
+
+  private:
+    bool set_policy(int mode, const std::vector<unsigned>& node_ids);
+    void release();
+
+    std::uint8_t* memory = nullptr;
+    std::size_t buffer_size = 0;
+    std::size_t mapped_size = 0;
+    Pages pages = Pages::Small;
+};
+
+const char* get_host_buffer_pages_name(HostBuffer::Pages pages);
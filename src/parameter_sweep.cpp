@@ -0,0 +1,384 @@
+#include "parameter_sweep.hpp"
+#include "dataset.hpp"
+#include "integrator.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <liblava/util/log.hpp>
+#include <optional>
+#include <spdlog/fmt/bundled/core.h>
+#include <spdlog/fmt/bundled/ostream.h>
+
+namespace {
+
+struct Statistics {
+    double mean = 0.0;
+    double median = 0.0;
+    double stddev = 0.0;
+};
+
+Statistics compute_statistics(std::vector<double> values) {
+    Statistics statistics;
+    if (values.empty()) {
+        return statistics;
+    }
+
+    for (double value : values) {
+        statistics.mean += value / values.size();
+    }
+
+    std::sort(values.begin(), values.end());
+    const std::size_t middle = values.size() / 2;
+    statistics.median = values.size() % 2 == 1 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+
+    if (values.size() > 1) {
+        double variance = 0.0;
+        for (double value : values) {
+            variance += (value - statistics.mean) * (value - statistics.mean) / (values.size() - 1);
+        }
+        statistics.stddev = std::sqrt(variance);
+    }
+
+    return statistics;
+}
+
+bool parse_list(const std::string& name, const std::string& values, std::vector<std::uint32_t>& list) {
+    list.clear();
+
+    std::size_t position = 0;
+    while (position <= values.size()) {
+        const std::size_t end = std::min(values.find(',', position), values.size());
+        const int32_t value = atoi(values.substr(position, end - position).c_str());
+
+        if (value <= 0) {
+            lava::log()->error("Parameter 'sweep_{}' must be a list of values greater than 0!", name);
+
+            return false;
+        }
+
+        list.push_back(value);
+        position = end + 1;
+    }
+
+    return true;
+}
+
+// A list of two choices, every value is true for the second one
+bool parse_choices(const std::string& name, const std::string& values, const std::array<std::string, 2>& choices, std::vector<bool>& list) {
+    list.clear();
+
+    std::size_t position = 0;
+    while (position <= values.size()) {
+        const std::size_t end = std::min(values.find(',', position), values.size());
+        const std::string value = values.substr(position, end - position);
+
+        if (value != choices[0] && value != choices[1]) {
+            lava::log()->error("Parameter 'sweep_{}' must be a list of '{}' and '{}'!", name, choices[0], choices[1]);
+
+            return false;
+        }
+
+        list.push_back(value == choices[1]);
+        position = end + 1;
+    }
+
+    return true;
+}
+
+// The parameter itself if the grid does not list any values
+template <typename T>
+std::vector<T> get_values(const std::vector<T>& values, T value) {
+    return values.empty() ? std::vector<T>{value} : values;
+}
+
+} // namespace
+
+bool SweepGrid::set(const std::string& name, const std::string& values) {
+    if (name == "work_group_size_x") {
+        return parse_list(name, values, this->work_group_size_x);
+    } else if (name == "work_group_size_y") {
+        return parse_list(name, values, this->work_group_size_y);
+    } else if (name == "work_group_size_z") {
+        return parse_list(name, values, this->work_group_size_z);
+    } else if (name == "particles_per_invocation") {
+        return parse_list(name, values, this->particles_per_invocation);
+    } else if (name == "seed_dimension_x") {
+        return parse_list(name, values, this->seed_dimension_x);
+    } else if (name == "seed_dimension_y") {
+        return parse_list(name, values, this->seed_dimension_y);
+    } else if (name == "seed_dimension_z") {
+        return parse_list(name, values, this->seed_dimension_z);
+    } else if (name == "integration_steps") {
+        return parse_list(name, values, this->integration_steps);
+    } else if (name == "batch_size") {
+        return parse_list(name, values, this->batch_size);
+    } else if (name == "max_work_group_invocations") {
+        const int32_t max_work_group_invocations = atoi(values.c_str());
+
+        if (max_work_group_invocations <= 0) {
+            lava::log()->error("Parameter 'sweep_max_work_group_invocations' smaller or equal to 0!");
+
+            return false;
+        }
+
+        this->max_work_group_invocations = max_work_group_invocations;
+        return true;
+    } else if (name == "interpolation") {
+        return parse_choices(name, values, {"implicit", "explicit"}, this->explicit_interpolation);
+    } else if (name == "filter") {
+        return parse_choices(name, values, {"linear", "cubic"}, this->cubic_interpolation);
+    } else if (name == "method") {
+        this->integration_method.clear();
+
+        std::size_t position = 0;
+        while (position <= values.size()) {
+            const std::size_t end = std::min(values.find(',', position), values.size());
+            const std::optional<IntegrationMethod> integration_method = parse_integration_method(values.substr(position, end - position));
+
+            if (!integration_method.has_value()) {
+                lava::log()->error("Parameter 'sweep_method' must be a list of 'euler', 'midpoint', 'rk4', 'rk45' and 'abm4'!");
+
+                return false;
+            }
+
+            this->integration_method.push_back(integration_method.value());
+            position = end + 1;
+        }
+
+        return true;
+    } else if (name == "kernel") {
+        return parse_choices(name, values, {"generic", "specialized"}, this->specialized_kernel);
+    } else if (name == "counters") {
+        return parse_choices(name, values, {"atomic", "subgroup"}, this->subgroup_counters);
+    } else if (name == "scheduling") {
+        return parse_choices(name, values, {"grid", "queue"}, this->work_queue);
+    }
+
+    lava::log()->warn("Unkown parameter 'sweep_" + name + "' !");
+
+    return false;
+}
+
+std::vector<IntegrationSettings> SweepGrid::get_configurations(const IntegrationSettings& defaults, const VkPhysicalDeviceLimits& limits) const {
+    std::vector<IntegrationSettings> configurations;
+
+    for (std::uint32_t work_group_size_x : get_values(this->work_group_size_x, defaults.work_group_size.x)) {
+        for (std::uint32_t work_group_size_y : get_values(this->work_group_size_y, defaults.work_group_size.y)) {
+            for (std::uint32_t work_group_size_z : get_values(this->work_group_size_z, defaults.work_group_size.z)) {
+                const glm::uvec3 work_group_size = {work_group_size_x, work_group_size_y, work_group_size_z};
+                const std::uint32_t invocations = work_group_size.x * work_group_size.y * work_group_size.z;
+
+                if (this->max_work_group_invocations > 0 && invocations > this->max_work_group_invocations) {
+                    continue;
+                }
+                if (invocations > limits.maxComputeWorkGroupInvocations || work_group_size.x > limits.maxComputeWorkGroupSize[0] || work_group_size.y > limits.maxComputeWorkGroupSize[1] || work_group_size.z > limits.maxComputeWorkGroupSize[2]) {
+                    lava::log()->warn("sweep: skipping work group size {}x{}x{}, which the device does not support", work_group_size.x, work_group_size.y, work_group_size.z);
+                    continue;
+                }
+
+                for (std::uint32_t particles_per_invocation : get_values(this->particles_per_invocation, std::uint32_t(defaults.particles_per_invocation))) {
+                    if (particles_per_invocation > 8) {
+                        lava::log()->warn("sweep: skipping {} particles per invocation, at most 8 are supported", particles_per_invocation);
+                        continue;
+                    }
+
+                    for (bool explicit_interpolation : get_values(this->explicit_interpolation, defaults.explicit_interpolation)) {
+                        for (bool cubic_interpolation : get_values(this->cubic_interpolation, defaults.cubic_interpolation)) {
+                            for (IntegrationMethod integration_method : get_values(this->integration_method, defaults.integration_method)) {
+                                for (bool specialized_kernel : get_values(this->specialized_kernel, defaults.specialized_kernel)) {
+                                    for (bool subgroup_counters : get_values(this->subgroup_counters, defaults.subgroup_counters)) {
+                                        for (bool work_queue : get_values(this->work_queue, defaults.work_queue)) {
+                                            for (std::uint32_t seed_dimension_x : get_values(this->seed_dimension_x, defaults.seed_spawn.x)) {
+                                                for (std::uint32_t seed_dimension_y : get_values(this->seed_dimension_y, defaults.seed_spawn.y)) {
+                                                    for (std::uint32_t seed_dimension_z : get_values(this->seed_dimension_z, defaults.seed_spawn.z)) {
+                                                        for (std::uint32_t integration_steps : get_values(this->integration_steps, defaults.integration_steps)) {
+                                                            for (std::uint32_t batch_size : get_values(this->batch_size, defaults.batch_size)) {
+                                                                configurations.push_back(IntegrationSettings{
+                                                                    .work_group_size = work_group_size,
+                                                                    .particles_per_invocation = particles_per_invocation,
+                                                                    .seed_spawn = {seed_dimension_x, seed_dimension_y, seed_dimension_z},
+                                                                    .integration_steps = integration_steps,
+                                                                    .batch_size = batch_size,
+                                                                    .explicit_interpolation = explicit_interpolation,
+                                                                    .cubic_interpolation = cubic_interpolation,
+                                                                    .integration_method = integration_method,
+                                                                    .specialized_kernel = specialized_kernel,
+                                                                    .subgroup_counters = subgroup_counters,
+                                                                    .work_queue = work_queue,
+                                                                });
+                                                            }
+                                                        }
+                                                    }
+                                                }
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return configurations;
+}
+
+bool run_parameter_sweep(lava::device_p device, Integrator& integrator, const SweepGrid& grid, const std::vector<std::filesystem::path>& dataset_paths, std::uint32_t repetition_count) {
+    const std::vector<IntegrationSettings> configurations = grid.get_configurations(integrator.get_settings(), device->get_properties().limits);
+    if (configurations.empty()) {
+        lava::log()->error("sweep: the grid does not contain any configuration that the device supports");
+        return false;
+    }
+    lava::log()->info("sweep: {} configurations of {} datasets with {} runs each", configurations.size(), dataset_paths.size(), repetition_count);
+
+    std::time_t t = std::time(0); // get time now
+    std::tm* now = std::localtime(&t);
+    const std::string filename = fmt::format("{}-{}-{}-{}-{}-{}-sweep.csv", now->tm_year + 1900, now->tm_mon, now->tm_mday, now->tm_hour, now->tm_min, now->tm_sec);
+    std::ofstream file(filename);
+    fmt::print(file, "dataset_path,dataset_dimensions,work_group_size,particles_per_invocation,seed_spawn,timestep,integration_steps,batch_size,explicit_interpolation,cubic_interpolation,method,specialized_kernel,subgroup_counters,work_queue,runs,samples");
+    for (const char* duration : {"seeding_gpu", "seeding_cpu", "integration_gpu", "integration_cpu", "setup_cpu"}) {
+        fmt::print(file, ",{0}_mean,{0}_median,{0}_stddev", duration);
+    }
+    fmt::print(file, "\n");
+
+    // The per run csv files of the integrator would create a file for every configuration
+    integrator.set_run_log_enabled(false);
+    bool success = true;
+
+    for (const std::filesystem::path& dataset_path : dataset_paths) {
+        // The previous dataset is released first, so that only one dataset occupies the memory of the device
+        integrator.set_dataset(nullptr);
+
+        lava::log()->info("sweep: load dataset {}", dataset_path.string());
+        DataSource::Ptr data = DataSource::open_file(dataset_path);
+        if (!data) {
+            return false;
+        }
+
+        Dataset::Ptr dataset = Dataset::make(device, data);
+        if (!dataset || !dataset->wait_for_loading()) {
+            lava::log()->error("sweep: failed to load dataset '{}'", dataset_path.string());
+            return false;
+        }
+        integrator.set_dataset(dataset);
+
+        const auto absolute_dataset_path = std::filesystem::absolute(dataset_path);
+        const glm::uvec4 dimensions = dataset->data->dimensions;
+
+        // The median GPU time of the integration with every configuration, to which the specialized kernels and the
+        // subgroup counters are compared
+        std::vector<std::pair<IntegrationSettings, double>> integration_durations;
+        const auto find_duration = [&](const IntegrationSettings& settings) -> std::optional<double> {
+            const auto entry = std::find_if(integration_durations.begin(), integration_durations.end(), [&](const auto& entry) { return entry.first == settings; });
+            return entry != integration_durations.end() ? std::optional<double>(entry->second) : std::nullopt;
+        };
+
+        for (std::size_t configuration_index = 0; configuration_index < configurations.size(); ++configuration_index) {
+            const IntegrationSettings& configuration = configurations[configuration_index];
+            integrator.set_settings(configuration);
+
+            std::array<std::vector<double>, 5> durations;
+            bool configuration_success = true;
+
+            for (std::uint32_t run = 0; run < repetition_count && configuration_success; ++run) {
+                configuration_success = integrator.run_integration();
+
+                if (configuration_success) {
+                    const Integrator::RunTimes run_times = integrator.get_run_times().value();
+                    durations[0].push_back(run_times.seeding_gpu);
+                    durations[1].push_back(run_times.seeding_cpu);
+                    durations[2].push_back(run_times.integration_gpu);
+                    durations[3].push_back(run_times.integration_cpu);
+                    durations[4].push_back(run_times.setup_cpu);
+                }
+            }
+
+            if (!configuration_success && integrator.is_integration_cancelled()) {
+                lava::log()->warn("sweep: cancelled, results written to {}", filename);
+                integrator.set_dataset(nullptr);
+                return false;
+            }
+            if (!configuration_success) {
+                lava::log()->error("sweep: integration with work group size {}x{}x{} and seeds {}x{}x{} failed", configuration.work_group_size.x, configuration.work_group_size.y, configuration.work_group_size.z, configuration.seed_spawn.x, configuration.seed_spawn.y, configuration.seed_spawn.z);
+                success = false;
+                continue;
+            }
+
+            // The same for every run, it shows how many steps the particles took before they left the dataset
+            const std::uint64_t sample_count = integrator.get_sample_count().value_or(0);
+
+            fmt::print(
+                file, "{},{}x{}x{}x{},{}x{}x{},{},{}x{}x{},{},{},{},{},{},{},{},{},{},{},{}",
+                absolute_dataset_path,
+                dimensions.x, dimensions.y, dimensions.z, dimensions.w,
+                configuration.work_group_size.x, configuration.work_group_size.y, configuration.work_group_size.z,
+                configuration.particles_per_invocation,
+                configuration.seed_spawn.x, configuration.seed_spawn.y, configuration.seed_spawn.z,
+                integrator.get_delta_time(),
+                configuration.integration_steps,
+                configuration.batch_size,
+                configuration.explicit_interpolation,
+                configuration.cubic_interpolation,
+                get_integration_method_name(configuration.integration_method),
+                configuration.specialized_kernel,
+                configuration.subgroup_counters,
+                configuration.work_queue,
+                repetition_count,
+                sample_count);
+
+            for (const std::vector<double>& values : durations) {
+                const Statistics statistics = compute_statistics(values);
+                fmt::print(file, ",{},{},{}", statistics.mean, statistics.median, statistics.stddev);
+            }
+            fmt::print(file, "\n");
+            file.flush();
+
+            const double integration_gpu = compute_statistics(durations[2]).median;
+            lava::log()->info("sweep: {}/{} work group size {}x{}x{}, {} particles per invocation, {} {} interpolation, {}, {} kernel, {} counters, {} scheduling, seeds {}x{}x{}, {} steps, batch size {}: {} ms (GPU, median)", configuration_index + 1, configurations.size(), configuration.work_group_size.x, configuration.work_group_size.y, configuration.work_group_size.z, configuration.particles_per_invocation, configuration.explicit_interpolation ? "explicit" : "implicit", configuration.cubic_interpolation ? "cubic" : "linear", get_integration_method_name(configuration.integration_method), configuration.specialized_kernel ? "specialized" : "generic", configuration.subgroup_counters ? "subgroup" : "atomic", configuration.work_queue ? "queue" : "grid", configuration.seed_spawn.x, configuration.seed_spawn.y, configuration.seed_spawn.z, configuration.integration_steps, configuration.batch_size, integration_gpu);
+
+            integration_durations.emplace_back(configuration, integration_gpu);
+
+            if (configuration.specialized_kernel && integration_gpu > 0.0) {
+                IntegrationSettings generic_configuration = configuration;
+                generic_configuration.specialized_kernel = false;
+
+                if (const std::optional<double> generic = find_duration(generic_configuration)) {
+                    lava::log()->info("sweep: the specialized kernel is {}x as fast as the generic kernel ({} ms, {} ms)", generic.value() / integration_gpu, integration_gpu, generic.value());
+                }
+            }
+            if (configuration.subgroup_counters && integration_gpu > 0.0) {
+                IntegrationSettings atomic_configuration = configuration;
+                atomic_configuration.subgroup_counters = false;
+
+                if (const std::optional<double> atomic = find_duration(atomic_configuration)) {
+                    lava::log()->info("sweep: the subgroup counters are {}x as fast as the atomic counters ({} ms, {} ms)", atomic.value() / integration_gpu, integration_gpu, atomic.value());
+                }
+            }
+            if (configuration.work_queue && integration_gpu > 0.0) {
+                IntegrationSettings grid_configuration = configuration;
+                grid_configuration.work_queue = false;
+
+                if (const std::optional<double> grid = find_duration(grid_configuration)) {
+                    // The gain of the queue grows with the share of the particles that leave the dataset early
+                    const std::optional<std::uint32_t> samples_per_step = get_samples_per_step(configuration.integration_method);
+                    const double seed_steps = double(configuration.seed_spawn.x) * configuration.seed_spawn.y * configuration.seed_spawn.z * configuration.integration_steps;
+                    if (samples_per_step.has_value() && seed_steps > 0.0) {
+                        lava::log()->info("sweep: the work queue is {}x as fast as the grid ({} ms, {} ms), {:.1f}% of the steps were integrated before the particles left the dataset", grid.value() / integration_gpu, integration_gpu, grid.value(), 100.0 * sample_count / (samples_per_step.value() * seed_steps));
+                    } else {
+                        lava::log()->info("sweep: the work queue is {}x as fast as the grid ({} ms, {} ms)", grid.value() / integration_gpu, integration_gpu, grid.value());
+                    }
+                }
+            }
+        }
+    }
+
+    integrator.set_dataset(nullptr);
+    lava::log()->info("sweep results written to {}", filename);
+
+    return success;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "integration_method.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <liblava/base/device.hpp>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+class Integrator;
+struct IntegrationSettings;
+
+// Grid of integration parameters that is swept with --sweep. Every parameter is given as a comma separated list of
+// values, e.g. --sweep_work_group_size_x=1,2,4,8, and all combinations are integrated. Parameters without a list keep
+// the value of the integrator, i.e. the value given on the command line or the default.
+struct SweepGrid {
+    std::vector<std::uint32_t> work_group_size_x;
+    std::vector<std::uint32_t> work_group_size_y;
+    std::vector<std::uint32_t> work_group_size_z;
+    std::uint32_t max_work_group_invocations = 0; // Work groups with more invocations are skipped, 0 for no limit
+    std::vector<std::uint32_t> particles_per_invocation;
+    std::vector<std::uint32_t> seed_dimension_x;
+    std::vector<std::uint32_t> seed_dimension_y;
+    std::vector<std::uint32_t> seed_dimension_z;
+    std::vector<std::uint32_t> integration_steps;
+    std::vector<std::uint32_t> batch_size;
+    std::vector<bool> explicit_interpolation;
+    std::vector<bool> cubic_interpolation;
+    std::vector<IntegrationMethod> integration_method;
+    std::vector<bool> specialized_kernel;
+    std::vector<bool> subgroup_counters;
+    std::vector<bool> work_queue;
+
+    // Sets the values of the parameter --sweep_<name>
+    bool set(const std::string& name, const std::string& values);
+
+    // All combinations that the device supports. The combinations with the same work group size, particles per
+    // invocation, interpolation, method and kernel are consecutive, so that the pipelines are only recreated when one of these changes. A specialized kernel is
+    // also recompiled when the number of steps or the batch size change.
+    std::vector<IntegrationSettings> get_configurations(const IntegrationSettings& defaults, const VkPhysicalDeviceLimits& limits) const;
+};
+
+// Integrates every dataset with every configuration of the grid repetition_count times and writes the mean, median and
+// standard deviation of the durations of every configuration to a single *-sweep.csv file. Each dataset is only loaded
+// once and the integrator keeps its device and pipelines between the configurations.
+bool run_parameter_sweep(lava::device_p device, Integrator& integrator, const SweepGrid& grid, const std::vector<std::filesystem::path>& dataset_paths, std::uint32_t repetition_count);
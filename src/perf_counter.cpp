@@ -0,0 +1,66 @@
+#include "perf_counter.hpp"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounter::PerfCounter(Event event) {
+#if defined(__linux__)
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    switch (event) {
+        case Event::L1DataCacheMisses:
+            attributes.type = PERF_TYPE_HW_CACHE;
+            attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        case Event::LastLevelCacheMisses:
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+    }
+
+    this->file_descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#else
+    (void)event;
+#endif
+}
+
+PerfCounter::~PerfCounter() {
+#if defined(__linux__)
+    if (this->file_descriptor >= 0) {
+        close(this->file_descriptor);
+    }
+#endif
+}
+
+void PerfCounter::start() {
+#if defined(__linux__)
+    if (this->file_descriptor >= 0) {
+        ioctl(this->file_descriptor, PERF_EVENT_IOC_RESET, 0);
+        ioctl(this->file_descriptor, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+std::optional<std::uint64_t> PerfCounter::stop() {
+#if defined(__linux__)
+    if (this->file_descriptor >= 0) {
+        ioctl(this->file_descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+        std::uint64_t count = 0;
+        if (read(this->file_descriptor, &count, sizeof(count)) == sizeof(count)) {
+            return count;
+        }
+    }
+#endif
+    return std::nullopt;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+// Hardware performance counter of the calling thread, based on perf_event_open() on Linux.
+// Not available on other platforms, in virtual machines without a virtualized PMU or if the kernel denies access
+// (see /proc/sys/kernel/perf_event_paranoid).
+class PerfCounter {
+  public:
+    enum class Event {
+        L1DataCacheMisses,
+        LastLevelCacheMisses,
+    };
+
+    explicit PerfCounter(Event event);
+    ~PerfCounter();
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    bool is_available() const { return this->file_descriptor >= 0; }
+
+    void start();
+    // Number of events since start(), std::nullopt if the counter is not available
+    std::optional<std::uint64_t> stop();
+
+  private:
+    int file_descriptor = -1;
+};
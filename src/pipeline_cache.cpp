@@ -0,0 +1,128 @@
+#include "pipeline_cache.hpp"
+#include <cstring>
+#include <fstream>
+#include <liblava/util/log.hpp>
+#include <spdlog/fmt/bundled/core.h>
+#include <vector>
+
+namespace {
+
+constexpr char PIPELINE_CACHE_MAGIC[8] = "BC6HPSO";
+
+} // namespace
+
+std::filesystem::path PipelineCache::get_default_path(lava::device_p device) {
+    const VkPhysicalDeviceProperties& properties = device->get_properties();
+
+    std::string uuid;
+    for (std::uint8_t byte : properties.pipelineCacheUUID) {
+        uuid += fmt::format("{:02x}", byte);
+    }
+
+    return fmt::format("bc6h-integrator-pipelines-{}.bin", uuid);
+}
+
+bool PipelineCache::create(lava::device_p device, const std::filesystem::path& path) {
+    this->device = device;
+    this->path = path;
+
+    std::vector<char> data;
+    std::ifstream file(path, std::ios::binary);
+
+    if (file) {
+        Header header;
+        const Header expected_header = this->make_header(0);
+
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+            std::memcmp(header.magic, expected_header.magic, sizeof(header.magic)) == 0 &&
+            header.version == expected_header.version &&
+            header.vendor_id == expected_header.vendor_id &&
+            header.device_id == expected_header.device_id &&
+            header.driver_version == expected_header.driver_version &&
+            std::memcmp(header.pipeline_cache_uuid, expected_header.pipeline_cache_uuid, VK_UUID_SIZE) == 0) {
+            data.resize(header.data_size);
+
+            if (!file.read(data.data(), data.size())) {
+                lava::log()->warn("pipeline cache '{}' is truncated, it is rebuilt", path.string());
+                data.clear();
+            }
+        } else {
+            lava::log()->info("pipeline cache '{}' belongs to another device or driver, it is rebuilt", path.string());
+        }
+    }
+
+    const VkPipelineCacheCreateInfo create_info{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data(),
+    };
+
+    if (device->call().vkCreatePipelineCache(device->get(), &create_info, lava::memory::instance().alloc(), &this->cache) != VK_SUCCESS) {
+        lava::log()->error("failed to create pipeline cache");
+        return false;
+    }
+    lava::log()->debug("pipeline cache '{}' loaded ({} KB)", path.string(), data.size() / 1024);
+
+    return true;
+}
+
+void PipelineCache::destroy() {
+    if (this->cache != VK_NULL_HANDLE) {
+        this->save();
+        this->device->call().vkDestroyPipelineCache(this->device->get(), this->cache, lava::memory::instance().alloc());
+        this->cache = VK_NULL_HANDLE;
+    }
+}
+
+bool PipelineCache::save() const {
+    std::size_t data_size = 0;
+    if (this->device->call().vkGetPipelineCacheData(this->device->get(), this->cache, &data_size, nullptr) != VK_SUCCESS) {
+        lava::log()->error("failed to get size of pipeline cache");
+        return false;
+    }
+
+    std::vector<char> data(data_size);
+    if (this->device->call().vkGetPipelineCacheData(this->device->get(), this->cache, &data_size, data.data()) != VK_SUCCESS) {
+        lava::log()->error("failed to get data of pipeline cache");
+        return false;
+    }
+
+    // Written to a temporary file first, so that an interrupted write does not leave a truncated cache behind
+    const std::filesystem::path temporary_path = std::filesystem::path(this->path).concat(".tmp");
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        const Header header = this->make_header(data_size);
+
+        if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(data.data(), data_size)) {
+            lava::log()->error("failed to write pipeline cache '{}'", temporary_path.string());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, this->path, error);
+    if (error) {
+        lava::log()->error("failed to write pipeline cache '{}': {}", this->path.string(), error.message());
+        return false;
+    }
+    lava::log()->debug("pipeline cache '{}' saved ({} KB)", this->path.string(), data_size / 1024);
+
+    return true;
+}
+
+PipelineCache::Header PipelineCache::make_header(std::uint64_t data_size) const {
+    const VkPhysicalDeviceProperties& properties = this->device->get_properties();
+
+    Header header = {};
+    std::memcpy(header.magic, PIPELINE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.vendor_id = properties.vendorID;
+    header.device_id = properties.deviceID;
+    header.driver_version = properties.driverVersion;
+    std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.data_size = data_size;
+
+    return header;
+}
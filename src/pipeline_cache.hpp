@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <liblava/base/device.hpp>
+#include <vulkan/vulkan_core.h>
+
+// Vulkan pipeline cache that is persisted between launches, so that the shaders are only compiled once per driver. The
+// file starts with a header that contains the version of the file format and the pipeline cache UUID, vendor, device
+// and driver version of the device. A file that does not match the device is ignored and replaced on save.
+class PipelineCache {
+  public:
+    static constexpr std::uint32_t FILE_VERSION = 1;
+
+    // bc6h-integrator-pipelines-<pipeline cache UUID>.bin in the working directory
+    static std::filesystem::path get_default_path(lava::device_p device);
+
+    bool create(lava::device_p device, const std::filesystem::path& path);
+    void destroy();
+
+    // Writes the data of the cache to the file
+    bool save() const;
+
+    VkPipelineCache get() const { return this->cache; }
+
+  private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t vendor_id;
+        std::uint32_t device_id;
+        std::uint32_t driver_version;
+        std::uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+        std::uint64_t data_size;
+    };
+
+    Header make_header(std::uint64_t data_size) const;
+
+    lava::device_p device;
+    std::filesystem::path path;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+};
@@ -0,0 +1,109 @@
+#include "slice_prefetcher.hpp"
+#include <algorithm>
+#include <cmath>
+
+SlicePrefetcher::SlicePrefetcher(HostDataset::Ptr dataset) : dataset(std::move(dataset)) {
+    this->thread = std::thread(&SlicePrefetcher::work, this);
+}
+
+SlicePrefetcher::~SlicePrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->request_available.notify_all();
+    this->thread.join();
+}
+
+void SlicePrefetcher::reset() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->pending_request = Request{.reset = true};
+    this->request_available.notify_all();
+    this->request_processed.wait(lock, [this]() { return !this->pending_request.has_value() && !this->processing; });
+}
+
+void SlicePrefetcher::advance(float begin, float end) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        // A request that has not been processed yet is outdated, the slices of the passed batch are released anyway
+        if (!this->pending_request.has_value() || !this->pending_request->reset) {
+            this->pending_request = Request{.reset = false, .begin = begin, .end = end};
+        }
+    }
+    this->request_available.notify_all();
+}
+
+std::size_t SlicePrefetcher::get_time_slice_size() const {
+    return std::size_t(this->dataset->data->channel_count) * std::size_t(this->dataset->data->time_slice_size);
+}
+
+void SlicePrefetcher::work() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->request_available.wait(lock, [this]() { return this->stopping || this->pending_request.has_value(); });
+
+            if (this->stopping) {
+                return;
+            }
+
+            request = this->pending_request.value();
+            this->pending_request.reset();
+            this->processing = true;
+        }
+
+        this->process(request);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->processing = false;
+        }
+        this->request_processed.notify_all();
+    }
+}
+
+void SlicePrefetcher::process(const Request& request) {
+    const unsigned last_slice = this->dataset->data->dimensions.w - 1;
+
+    if (request.reset) {
+        this->dont_need(0, last_slice);
+        this->released_slice_count = 0;
+        this->requested_slice_count = 0;
+        this->peak_resident_size = 0;
+        return;
+    }
+
+    // The next batch is assumed to be as long as the current one
+    const unsigned first_current_slice = std::min(unsigned(std::floor(request.begin)), last_slice);
+    const unsigned last_current_slice = std::min(unsigned(std::ceil(request.end)), last_slice);
+    const unsigned last_next_slice = std::min(unsigned(std::ceil(2.0f * request.end - request.begin)), last_slice);
+
+    if (this->requested_slice_count <= last_next_slice) {
+        this->will_need(std::max(first_current_slice, this->requested_slice_count), std::max(last_current_slice, last_next_slice));
+        this->requested_slice_count = last_next_slice + 1;
+    }
+
+    const std::size_t resident_size = this->dataset->mapping->get_resident_size(std::size_t(this->dataset->data->data_offset), std::size_t(this->dataset->data->data_size));
+    this->peak_resident_size = std::max(this->peak_resident_size.load(), resident_size);
+
+    if (this->released_slice_count < first_current_slice) {
+        this->dont_need(this->released_slice_count, first_current_slice - 1);
+        this->released_slice_count = first_current_slice;
+    }
+}
+
+void SlicePrefetcher::will_need(unsigned first_slice, unsigned last_slice) const {
+    for (unsigned c = 0; c < this->dataset->data->channel_count; ++c) {
+        const std::size_t offset = this->dataset->get_slice_offset(c, first_slice);
+        this->dataset->mapping->will_need(offset, (last_slice - first_slice + 1) * std::size_t(this->dataset->data->time_slice_size));
+    }
+}
+
+void SlicePrefetcher::dont_need(unsigned first_slice, unsigned last_slice) const {
+    for (unsigned c = 0; c < this->dataset->data->channel_count; ++c) {
+        const std::size_t offset = this->dataset->get_slice_offset(c, first_slice);
+        this->dataset->mapping->dont_need(offset, (last_slice - first_slice + 1) * std::size_t(this->dataset->data->time_slice_size));
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "host_dataset.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Keeps the time slices around the integration time of a mapped HostDataset in memory.
+// The integration reports the time range of every batch with advance(). The prefetch thread then asks the operating
+// system to read the slices of the current and the next batch and releases the slices that the integration has
+// passed, so that only the slices bracketing the current time are resident regardless of the length of the dataset.
+// This requires all particles to take each batch before the next one, see advance_seeds().
+class SlicePrefetcher {
+  public:
+    explicit SlicePrefetcher(HostDataset::Ptr dataset);
+    ~SlicePrefetcher();
+
+    SlicePrefetcher(const SlicePrefetcher&) = delete;
+    SlicePrefetcher& operator=(const SlicePrefetcher&) = delete;
+
+    // Releases all slices, so that the next integration starts at the first slice again
+    void reset();
+    // The integration samples the times [begin, end] next
+    void advance(float begin, float end);
+
+    // Largest amount of the dataset in memory since the last reset in bytes
+    std::size_t get_peak_resident_size() const { return this->peak_resident_size; }
+    std::size_t get_time_slice_size() const;
+
+  private:
+    struct Request {
+        bool reset = false;
+        float begin = 0.0f;
+        float end = 0.0f;
+    };
+
+    void work();
+    void process(const Request& request);
+    void will_need(unsigned first_slice, unsigned last_slice) const;
+    void dont_need(unsigned first_slice, unsigned last_slice) const;
+
+    HostDataset::Ptr dataset;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable request_available;
+    std::condition_variable request_processed;
+    std::optional<Request> pending_request;
+    bool processing = false;
+    bool stopping = false;
+
+    // Only accessed by the prefetch thread
+    unsigned released_slice_count = 0;  // Slices [0, released_slice_count) have been released
+    unsigned requested_slice_count = 0; // Slices [0, requested_slice_count) have been requested
+    std::atomic<std::size_t> peak_resident_size = 0;
+};
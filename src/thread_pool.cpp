@@ -0,0 +1,92 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+
+thread_local std::optional<unsigned> current_worker_index;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned thread_count, std::function<void(unsigned)> initialize_worker) {
+    thread_count = std::max(thread_count, 1u);
+    this->threads.reserve(thread_count);
+
+    // The initialization function is copied into every thread, since the pool does not keep it
+    for (unsigned i = 0; i < thread_count; ++i) {
+        this->threads.emplace_back(&ThreadPool::work, this, i, initialize_worker);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->task_available.notify_all();
+
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.push(std::move(task));
+    }
+    this->task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->tasks_finished.wait(lock, [this]() { return this->tasks.empty() && this->busy_count == 0; });
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t chunk_size, const std::function<void(std::size_t, std::size_t)>& function) {
+    chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+    for (std::size_t begin = 0; begin < count; begin += chunk_size) {
+        const std::size_t end = std::min(begin + chunk_size, count);
+        this->submit([&function, begin, end]() { function(begin, end); });
+    }
+
+    this->wait();
+}
+
+std::optional<unsigned> ThreadPool::get_worker_index() {
+    return current_worker_index;
+}
+
+void ThreadPool::work(unsigned worker, const std::function<void(unsigned)>& initialize_worker) {
+    current_worker_index = worker;
+    if (initialize_worker) {
+        initialize_worker(worker);
+    }
+
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->task_available.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+
+            if (this->tasks.empty()) {
+                return;
+            }
+
+            task = std::move(this->tasks.front());
+            this->tasks.pop();
+            this->busy_count++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->busy_count--;
+
+            if (this->tasks.empty() && this->busy_count == 0) {
+                this->tasks_finished.notify_all();
+            }
+        }
+    }
+}
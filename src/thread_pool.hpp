@@ -0,0 +1,43 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that execute submitted tasks in FIFO order.
+// Every worker calls initialize_worker(worker index) before it executes any task, e.g. to pin itself to a NUMA node.
+class ThreadPool {
+  public:
+    explicit ThreadPool(unsigned thread_count, std::function<void(unsigned)> initialize_worker = nullptr);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until the queue is empty and every worker is idle.
+    void wait();
+
+    // Splits [0, count) into chunks of at most chunk_size elements and calls function(begin, end) for each chunk.
+    void parallel_for(std::size_t count, std::size_t chunk_size, const std::function<void(std::size_t, std::size_t)>& function);
+
+    unsigned get_thread_count() const { return static_cast<unsigned>(this->threads.size()); }
+    // Index of the calling thread in its pool, std::nullopt if it is not a worker
+    static std::optional<unsigned> get_worker_index();
+
+  private:
+    void work(unsigned worker, const std::function<void(unsigned)>& initialize_worker);
+
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable tasks_finished;
+    unsigned busy_count = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,98 @@
+#include "time_blending.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Relative costs in fetches of 3 channels: sampling the dataset fetches 8 voxels in each of the two time slices,
+// sampling a blended volume fetches 8 voxels of one volume and blending a voxel fetches it from both time slices and
+// writes it, which is cheaper per fetch since the whole volume is streamed in order.
+constexpr double DATASET_SAMPLE_COST = 16.0;
+constexpr double BLENDED_SAMPLE_COST = 8.0;
+constexpr double VOXEL_BLEND_COST = 1.5;
+
+} // namespace
+
+unsigned get_stage_times(IntegrationMethod method, float t, float dt, std::array<float, BLENDED_VOLUME_COUNT>& stage_times) {
+    switch (method) {
+        case IntegrationMethod::Euler:
+            stage_times[0] = t;
+            return 1;
+        case IntegrationMethod::Midpoint:
+            stage_times[0] = t;
+            stage_times[1] = t + 0.5f * dt;
+            return 2;
+        case IntegrationMethod::RungeKutta4:
+            stage_times[0] = t;
+            stage_times[1] = t + 0.5f * dt;
+            stage_times[2] = t + dt;
+            return 3;
+        case IntegrationMethod::DormandPrince: // Not supported by the CPU integrator
+        case IntegrationMethod::AdamsBashforthMoulton:
+            break;
+    }
+    return 0;
+}
+
+bool is_time_blending_profitable(IntegrationMethod method, std::size_t seed_count, std::size_t voxel_count) {
+    unsigned samples_per_step = 0;
+    unsigned blends_per_step = 0;
+    switch (method) {
+        case IntegrationMethod::Euler:
+            samples_per_step = 1;
+            blends_per_step = 1;
+            break;
+        case IntegrationMethod::Midpoint:
+            samples_per_step = 2;
+            blends_per_step = 2;
+            break;
+        case IntegrationMethod::RungeKutta4:
+            samples_per_step = 4;
+            blends_per_step = 2;
+            break;
+        case IntegrationMethod::DormandPrince:
+        case IntegrationMethod::AdamsBashforthMoulton:
+            return false;
+    }
+
+    const double saved_cost = double(seed_count) * samples_per_step * (DATASET_SAMPLE_COST - BLENDED_SAMPLE_COST);
+    const double blend_cost = double(voxel_count) * blends_per_step * VOXEL_BLEND_COST;
+    return saved_cost > blend_cost;
+}
+
+BlendedVolumes::BlendedVolumes(std::size_t voxel_count) : voxel_count(voxel_count) {
+    this->times.fill(std::numeric_limits<float>::quiet_NaN());
+}
+
+void BlendedVolumes::prepare(const std::array<float, BLENDED_VOLUME_COUNT>& stage_times, unsigned stage_count, const std::function<void(float, float*)>& blend) {
+    std::array<bool, BLENDED_VOLUME_COUNT> needed = {};
+
+    for (unsigned s = 0; s < stage_count; ++s) {
+        const auto slot = std::find(this->times.begin(), this->times.end(), stage_times[s]);
+        if (slot != this->times.end()) {
+            needed[slot - this->times.begin()] = true;
+            this->reuse_count++;
+        }
+    }
+
+    for (unsigned s = 0; s < stage_count; ++s) {
+        if (std::find(this->times.begin(), this->times.end(), stage_times[s]) != this->times.end()) {
+            continue;
+        }
+
+        // Volumes are allocated when they are needed, Euler only uses one of them
+        const unsigned slot = std::find(needed.begin(), needed.end(), false) - needed.begin();
+        this->volumes[slot].resize(3 * this->voxel_count);
+        blend(stage_times[s], this->volumes[slot].data());
+        this->times[slot] = stage_times[s];
+        needed[slot] = true;
+        this->blend_count++;
+    }
+}
+
+void BlendedVolumes::apply(CpuIntegrationContext& context) const {
+    for (unsigned i = 0; i < BLENDED_VOLUME_COUNT; ++i) {
+        context.blended_volumes[i] = this->volumes[i].data();
+        context.blended_times[i] = this->times[i];
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "cpu_kernels.hpp"
+#include "integration_method.hpp"
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// All particles of an integration share the same time, so the temporal interpolation between the two enclosing time
+// slices is the same for every sample of the population at a stage time. With time blending, the CPU integration
+// advances all particles step by step instead of seed by seed and blends the dataset once per stage time (t, t + dt / 2
+// and t + dt) into a volume, which the particles then sample instead of both time slices. This halves the fetches of
+// every sample, but every step has to blend the whole dataset once (Euler) or twice (midpoint and RK4, whose volume at
+// t + dt is reused at t of the next step), so it only pays off for dense seedings.
+enum class TimeBlending {
+    Off,
+    On,
+    Auto, // Decided by is_time_blending_profitable()
+};
+
+inline const char* get_time_blending_name(TimeBlending time_blending) {
+    switch (time_blending) {
+        case TimeBlending::Off:
+            return "off";
+        case TimeBlending::On:
+            return "on";
+        case TimeBlending::Auto:
+            return "auto";
+    }
+    return "unknown";
+}
+
+inline std::optional<TimeBlending> parse_time_blending(std::string_view name) {
+    for (TimeBlending time_blending : {TimeBlending::Off, TimeBlending::On, TimeBlending::Auto}) {
+        if (name == get_time_blending_name(time_blending)) {
+            return time_blending;
+        }
+    }
+    return std::nullopt;
+}
+
+// Stage times at which the integration method samples the dataset in the step at time t, computed exactly like in the
+// integration methods of cpu_sampling.hpp. Returns the number of stage times.
+unsigned get_stage_times(IntegrationMethod method, float t, float dt, std::array<float, BLENDED_VOLUME_COUNT>& stage_times);
+
+// Break-even heuristic, compares the fetches saved by sampling blended volumes with the fetches needed to blend them
+bool is_time_blending_profitable(IntegrationMethod method, std::size_t seed_count, std::size_t voxel_count);
+
+// Blended volumes of the stage times of the current step. Volumes are kept until their slot is needed for another
+// stage time, so that the volume at t + dt is reused in the next step.
+class BlendedVolumes {
+  public:
+    explicit BlendedVolumes(std::size_t voxel_count);
+
+    // Makes sure that there is a volume for every stage time, blend(t, volume) has to fill the missing ones
+    void prepare(const std::array<float, BLENDED_VOLUME_COUNT>& stage_times, unsigned stage_count, const std::function<void(float, float*)>& blend);
+    // Sets blended_volumes and blended_times of the context
+    void apply(CpuIntegrationContext& context) const;
+
+    std::size_t get_blend_count() const { return this->blend_count; }
+    std::size_t get_reuse_count() const { return this->reuse_count; }
+
+  private:
+    std::size_t voxel_count;
+    std::array<std::vector<float>, BLENDED_VOLUME_COUNT> volumes;
+    std::array<float, BLENDED_VOLUME_COUNT> times; // NaN for slots without volume
+    std::size_t blend_count = 0;
+    std::size_t reuse_count = 0;
+};
@@ -0,0 +1,92 @@
+#include "timeline_semaphore.hpp"
+#include <algorithm>
+#include <cstring>
+#include <liblava/util/log.hpp>
+#include <vector>
+
+bool enable_timeline_semaphore(lava::device::create_param& device_param) {
+    std::uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(device_param.physical_device->get(), nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(device_param.physical_device->get(), nullptr, &extension_count, extensions.data());
+
+    const bool supported = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+        return std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+    });
+    if (!supported) {
+        lava::log()->warn("the device does not support timeline semaphores");
+        return false;
+    }
+
+    // Has to outlive the creation of the device, which only happens after the callback returns
+    static VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_semaphore_features{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .pNext = nullptr,
+        .timelineSemaphore = VK_TRUE,
+    };
+
+    timeline_semaphore_features.pNext = const_cast<void*>(device_param.next);
+    device_param.next = &timeline_semaphore_features;
+    device_param.extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+    return true;
+}
+
+VkSemaphore create_timeline_semaphore(lava::device_p device, std::uint64_t initial_value) {
+    // The functions are only loaded if the extension is enabled
+    if (device->call().vkWaitSemaphoresKHR == nullptr || device->call().vkGetSemaphoreCounterValueKHR == nullptr) {
+        lava::log()->error("timeline semaphores are not enabled on the device");
+        return VK_NULL_HANDLE;
+    }
+
+    const VkSemaphoreTypeCreateInfoKHR type_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+        .pNext = nullptr,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+        .initialValue = initial_value,
+    };
+    const VkSemaphoreCreateInfo semaphore_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+        .flags = 0,
+    };
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (device->call().vkCreateSemaphore(device->get(), &semaphore_info, lava::memory::instance().alloc(), &semaphore) != VK_SUCCESS) {
+        lava::log()->error("failed to create timeline semaphore");
+        return VK_NULL_HANDLE;
+    }
+
+    return semaphore;
+}
+
+void destroy_timeline_semaphore(lava::device_p device, VkSemaphore semaphore) {
+    if (semaphore != VK_NULL_HANDLE) {
+        device->call().vkDestroySemaphore(device->get(), semaphore, lava::memory::instance().alloc());
+    }
+}
+
+std::optional<std::uint64_t> wait_timeline_semaphore(lava::device_p device, VkSemaphore semaphore, std::uint64_t value, std::uint64_t timeout) {
+    const VkSemaphoreWaitInfoKHR wait_info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+        .pNext = nullptr,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphore,
+        .pValues = &value,
+    };
+
+    const VkResult result = device->call().vkWaitSemaphoresKHR(device->get(), &wait_info, timeout);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT) {
+        lava::log()->error("can't wait for timeline semaphore!");
+        return std::nullopt;
+    }
+
+    std::uint64_t counter_value = 0;
+    if (device->call().vkGetSemaphoreCounterValueKHR(device->get(), semaphore, &counter_value) != VK_SUCCESS) {
+        lava::log()->error("can't get value of timeline semaphore!");
+        return std::nullopt;
+    }
+
+    return counter_value;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <liblava/base/device.hpp>
+#include <optional>
+#include <vulkan/vulkan_core.h>
+
+// Adds VK_KHR_timeline_semaphore and its feature to the parameters of a device. The integrator signals a timeline
+// semaphore after recorded batches, so that the progress of an integration can be waited for instead of polled. Leaves
+// the parameters unchanged if the device does not support the extension.
+bool enable_timeline_semaphore(lava::device::create_param& device_param);
+
+VkSemaphore create_timeline_semaphore(lava::device_p device, std::uint64_t initial_value);
+void destroy_timeline_semaphore(lava::device_p device, VkSemaphore semaphore);
+
+// Blocks until the semaphore reaches value or the timeout in ns expires. Returns the counter value of the semaphore,
+// or nothing if waiting failed.
+std::optional<std::uint64_t> wait_timeline_semaphore(lava::device_p device, VkSemaphore semaphore, std::uint64_t value, std::uint64_t timeout);
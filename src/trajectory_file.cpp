@@ -0,0 +1,43 @@
+#include "trajectory_file.hpp"
+#include <fstream>
+#include <liblava/util/log.hpp>
+
+bool write_trajectories(const std::string& file_name, std::span<const glm::vec4> line_buffer, std::span<const VkDrawIndirectCommand> indirect_buffer) {
+    if (file_name.empty()) {
+        lava::log()->error("File name empty!");
+
+        return false;
+    }
+
+    std::fstream length_file;
+    std::fstream trajectory_file;
+
+    length_file.open(file_name + "_length.bin", std::ios::out | std::ios::binary);
+
+    if (!length_file.good()) {
+        lava::log()->error("Can't open length file!");
+
+        return false;
+    }
+
+    trajectory_file.open(file_name + "_trajectory.bin", std::ios::out | std::ios::binary);
+
+    if (!trajectory_file.good()) {
+        lava::log()->error("Can't open trajectory file!");
+
+        return false;
+    }
+
+    for (const VkDrawIndirectCommand& indirect_command : indirect_buffer) {
+        uint32_t offset = indirect_command.firstVertex;
+        uint32_t length = indirect_command.vertexCount;
+
+        length_file.write((const char*)&length, sizeof(length));
+        trajectory_file.write((const char*)(line_buffer.data() + offset), length * sizeof(glm::vec4));
+    }
+
+    length_file.close();
+    trajectory_file.close();
+
+    return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <glm/vec4.hpp>
+#include <span>
+#include <string>
+#include <vulkan/vulkan_core.h>
+
+// Writes `{file_name}_length.bin` and `{file_name}_trajectory.bin` (see README.md for the layout).
+// Every indirect command selects the vertices of one path line inside the line buffer.
+bool write_trajectories(const std::string& file_name, std::span<const glm::vec4> line_buffer, std::span<const VkDrawIndirectCommand> indirect_buffer);
@@ -0,0 +1,138 @@
+#include "work_stealing_scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+// Chunks per worker of an evenly distributed run, which bounds the imbalance at the end of a run to about one chunk
+constexpr std::size_t CHUNKS_PER_WORKER = 64;
+
+std::size_t round_up(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+WorkStealingScheduler::WorkStealingScheduler(ThreadPool& thread_pool) : thread_pool(thread_pool) {
+    for (unsigned i = 0; i < thread_pool.get_thread_count(); ++i) {
+        this->workers.push_back(std::make_unique<Worker>());
+    }
+    this->reset_statistics();
+}
+
+void WorkStealingScheduler::run(std::size_t count, std::size_t granularity, const std::function<void(std::size_t, std::size_t)>& function) {
+    const unsigned worker_count = static_cast<unsigned>(this->workers.size());
+    granularity = std::max<std::size_t>(granularity, 1);
+    const std::size_t chunk_size = std::max(round_up(count / (std::size_t(worker_count) * CHUNKS_PER_WORKER), granularity), granularity);
+
+    this->remaining_count = count;
+
+    for (unsigned i = 0; i < worker_count; ++i) {
+        const std::size_t begin = std::min(round_up(count * i / worker_count, granularity), count);
+        const std::size_t end = std::min(round_up(count * (i + 1) / worker_count, granularity), count);
+
+        this->workers[i]->ranges.clear();
+        if (begin < end) {
+            this->workers[i]->ranges.push_back({begin, end});
+        }
+        this->workers[i]->range_count = this->workers[i]->ranges.size();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < worker_count; ++i) {
+        this->thread_pool.submit([this, i, granularity, chunk_size, &function]() { this->work(i, granularity, chunk_size, function); });
+    }
+    this->thread_pool.wait();
+
+    this->duration += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void WorkStealingScheduler::reset_statistics() {
+    this->statistics.assign(this->workers.size(), WorkerStatistics());
+    this->duration = 0.0;
+}
+
+double WorkStealingScheduler::get_utilization(unsigned worker) const {
+    return this->duration > 0.0 ? this->statistics[worker].busy_time / this->duration : 0.0;
+}
+
+void WorkStealingScheduler::work(unsigned worker, std::size_t granularity, std::size_t chunk_size, const std::function<void(std::size_t, std::size_t)>& function) {
+    WorkerStatistics& statistics = this->statistics[worker];
+    Worker& own = *this->workers[worker];
+
+    while (this->remaining_count.load(std::memory_order_acquire) > 0) {
+        std::optional<Range> range = this->pop(worker);
+
+        if (!range.has_value()) {
+            range = this->steal(worker);
+
+            // The remaining chunks are being executed by other workers
+            if (!range.has_value()) {
+                std::this_thread::yield();
+                continue;
+            }
+            statistics.steal_count++;
+        }
+
+        std::size_t executed_count = 0;
+        while (range->begin < range->end) {
+            const std::size_t end = std::min(range->begin + chunk_size, range->end);
+
+            // Offers the upper half of the rest to the thieves, unless the deque still holds a range of this worker
+            if (range->end - end > chunk_size && own.range_count.load(std::memory_order_relaxed) == 0) {
+                const std::size_t middle = end + round_up((range->end - end) / 2, granularity);
+                if (middle < range->end) {
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    own.ranges.push_back({middle, range->end});
+                    own.range_count.store(own.ranges.size(), std::memory_order_relaxed);
+                    range->end = middle;
+                }
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            function(range->begin, end);
+            statistics.busy_time += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            statistics.item_count += end - range->begin;
+            statistics.chunk_count++;
+
+            executed_count += end - range->begin;
+            range->begin = end;
+        }
+
+        this->remaining_count.fetch_sub(executed_count, std::memory_order_release);
+    }
+}
+
+std::optional<WorkStealingScheduler::Range> WorkStealingScheduler::pop(unsigned worker) {
+    std::lock_guard<std::mutex> lock(this->workers[worker]->mutex);
+    std::deque<Range>& ranges = this->workers[worker]->ranges;
+
+    if (ranges.empty()) {
+        return std::nullopt;
+    }
+
+    const Range range = ranges.back();
+    ranges.pop_back();
+    this->workers[worker]->range_count.store(ranges.size(), std::memory_order_relaxed);
+    return range;
+}
+
+std::optional<WorkStealingScheduler::Range> WorkStealingScheduler::steal(unsigned thief) {
+    const unsigned worker_count = static_cast<unsigned>(this->workers.size());
+
+    for (unsigned i = 1; i < worker_count; ++i) {
+        Worker& victim = *this->workers[(thief + i) % worker_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.ranges.empty()) {
+            const Range range = victim.ranges.front();
+            victim.ranges.pop_front();
+            victim.range_count.store(victim.ranges.size(), std::memory_order_relaxed);
+            return range;
+        }
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "thread_pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Distributes the range [0, count) across the threads of a pool for work whose cost per element is very uneven, like
+// seeds that leave the dataset after a few steps next to seeds that are integrated for all steps.
+// Every worker starts with a contiguous share of the range in its own deque. A worker executes the range it has taken in
+// chunks of a fixed size, derived from the count and the number of workers. Splitting is lazy: only while its own deque
+// is empty, i.e. at the start or after a thief has taken from it, the worker pushes the upper half of the rest of its
+// range onto the back of the deque, so that there is always something to steal. Idle workers steal from the front of
+// the other deques, which holds the largest ranges, so that a few steals suffice to rebalance the work. A range is not
+// split below the chunk size.
+class WorkStealingScheduler {
+  public:
+    struct WorkerStatistics {
+        double busy_time = 0.0; // Time spent in the function in ms
+        std::size_t item_count = 0;
+        std::size_t chunk_count = 0;
+        std::size_t steal_count = 0;
+    };
+
+    explicit WorkStealingScheduler(ThreadPool& thread_pool);
+
+    // Calls function(begin, end) for chunks that cover [0, count). All chunk boundaries except count are multiples of
+    // granularity. Blocks until every chunk has been executed.
+    void run(std::size_t count, std::size_t granularity, const std::function<void(std::size_t, std::size_t)>& function);
+
+    // The statistics accumulate over all runs since the last reset
+    void reset_statistics();
+    // One entry per worker
+    const std::vector<WorkerStatistics>& get_statistics() const { return this->statistics; }
+    // Duration of the runs in ms
+    double get_duration() const { return this->duration; }
+    // Fraction of the duration of the runs in which the worker executed the function
+    double get_utilization(unsigned worker) const;
+
+  private:
+    struct Range {
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+        std::atomic<std::size_t> range_count = 0; // Size of ranges, read by the owner without the lock
+    };
+
+    void work(unsigned worker, std::size_t granularity, std::size_t chunk_size, const std::function<void(std::size_t, std::size_t)>& function);
+    std::optional<Range> pop(unsigned worker);
+    std::optional<Range> steal(unsigned thief);
+
+    ThreadPool& thread_pool;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<WorkerStatistics> statistics;
+    std::atomic<std::size_t> remaining_count = 0;
+    double duration = 0.0;
+};